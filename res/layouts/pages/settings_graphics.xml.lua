@@ -42,4 +42,5 @@ function on_open()
     create_setting("graphics.gamma", "Gamma", 0.05, "", "graphics.gamma.tooltip")
     create_checkbox("graphics.backlight", "Backlight", "graphics.backlight.tooltip")
     create_checkbox("graphics.dense-render", "Dense blocks render", "graphics.dense-render.tooltip")
+    create_checkbox("graphics.greedy-meshing", "Greedy meshing", "graphics.greedy-meshing.tooltip")
 end
@@ -6,12 +6,104 @@
 
 #include "rle.hpp"
 #include "gzip.hpp"
+#include "lz.hpp"
 #include "util/BufferPool.hpp"
 
 using namespace compression;
 
 inline constexpr float BUFFER_NOCROP_THRESOLD = 0.9;
 
+/// @brief LZ_BJSON preset dictionary: binary JSON of a block inventory and
+/// chunk entities having typical components.
+/// Must never be changed as it's required to decode saved data
+static const ubyte BJSON_DICTIONARY[] = {
+    0x01, 0xB8, 0x00, 0x00, 0x00, 0x73, 0x6C, 0x6F, 0x74, 0x73, 0x00, 0x02,
+    0x01, 0x0B, 0x00, 0x00, 0x00, 0x69, 0x64, 0x00, 0x03, 0x00, 0x00, 0x01,
+    0x0B, 0x00, 0x00, 0x00, 0x69, 0x64, 0x00, 0x03, 0x00, 0x00, 0x01, 0x0B,
+    0x00, 0x00, 0x00, 0x69, 0x64, 0x00, 0x03, 0x00, 0x00, 0x01, 0x0B, 0x00,
+    0x00, 0x00, 0x69, 0x64, 0x00, 0x03, 0x00, 0x00, 0x01, 0x0B, 0x00, 0x00,
+    0x00, 0x69, 0x64, 0x00, 0x03, 0x00, 0x00, 0x01, 0x0B, 0x00, 0x00, 0x00,
+    0x69, 0x64, 0x00, 0x03, 0x00, 0x00, 0x01, 0x0B, 0x00, 0x00, 0x00, 0x69,
+    0x64, 0x00, 0x03, 0x00, 0x00, 0x01, 0x0B, 0x00, 0x00, 0x00, 0x69, 0x64,
+    0x00, 0x03, 0x00, 0x00, 0x01, 0x13, 0x00, 0x00, 0x00, 0x63, 0x6F, 0x75,
+    0x6E, 0x74, 0x00, 0x03, 0x40, 0x69, 0x64, 0x00, 0x03, 0x25, 0x00, 0x01,
+    0x13, 0x00, 0x00, 0x00, 0x63, 0x6F, 0x75, 0x6E, 0x74, 0x00, 0x03, 0x40,
+    0x69, 0x64, 0x00, 0x03, 0x26, 0x00, 0x01, 0x13, 0x00, 0x00, 0x00, 0x63,
+    0x6F, 0x75, 0x6E, 0x74, 0x00, 0x03, 0x40, 0x69, 0x64, 0x00, 0x03, 0x27,
+    0x00, 0x01, 0x13, 0x00, 0x00, 0x00, 0x63, 0x6F, 0x75, 0x6E, 0x74, 0x00,
+    0x03, 0x40, 0x69, 0x64, 0x00, 0x03, 0x28, 0x00, 0x00, 0x69, 0x64, 0x00,
+    0x04, 0xB0, 0x04, 0x00, 0x01, 0x3B, 0x03, 0x00, 0x00, 0x64, 0x61, 0x74,
+    0x61, 0x00, 0x02, 0x01, 0xE6, 0x00, 0x00, 0x00, 0x63, 0x6F, 0x6D, 0x70,
+    0x73, 0x00, 0x01, 0x3D, 0x00, 0x00, 0x00, 0x62, 0x61, 0x73, 0x65, 0x3A,
+    0x64, 0x72, 0x6F, 0x70, 0x00, 0x01, 0x2D, 0x00, 0x00, 0x00, 0x74, 0x69,
+    0x6D, 0x65, 0x72, 0x00, 0x07, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xE0,
+    0x3F, 0x69, 0x74, 0x65, 0x6D, 0x00, 0x01, 0x13, 0x00, 0x00, 0x00, 0x63,
+    0x6F, 0x75, 0x6E, 0x74, 0x00, 0x03, 0x01, 0x69, 0x64, 0x00, 0x03, 0x0C,
+    0x00, 0x00, 0x00, 0x72, 0x69, 0x67, 0x69, 0x64, 0x62, 0x6F, 0x64, 0x79,
+    0x00, 0x01, 0x49, 0x00, 0x00, 0x00, 0x74, 0x79, 0x70, 0x65, 0x00, 0x08,
+    0x07, 0x00, 0x00, 0x00, 0x64, 0x79, 0x6E, 0x61, 0x6D, 0x69, 0x63, 0x64,
+    0x61, 0x6D, 0x70, 0x69, 0x6E, 0x67, 0x00, 0x07, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0xF0, 0x3F, 0x76, 0x65, 0x6C, 0x00, 0x02, 0x07, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x07, 0x9A, 0x99, 0x99, 0x99, 0x99,
+    0x99, 0x23, 0xC0, 0x07, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x74, 0x72, 0x61, 0x6E, 0x73, 0x66, 0x6F, 0x72, 0x6D, 0x00,
+    0x01, 0x27, 0x00, 0x00, 0x00, 0x70, 0x6F, 0x73, 0x00, 0x02, 0x07, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x29, 0x40, 0x07, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x50, 0x40, 0x07, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0A,
+    0xC0, 0x00, 0x00, 0x75, 0x69, 0x64, 0x00, 0x04, 0x00, 0x04, 0x64, 0x65,
+    0x66, 0x00, 0x08, 0x09, 0x00, 0x00, 0x00, 0x62, 0x61, 0x73, 0x65, 0x3A,
+    0x64, 0x72, 0x6F, 0x70, 0x00, 0x01, 0x48, 0x02, 0x00, 0x00, 0x63, 0x6F,
+    0x6D, 0x70, 0x73, 0x00, 0x01, 0x48, 0x00, 0x00, 0x00, 0x62, 0x61, 0x73,
+    0x65, 0x3A, 0x70, 0x6C, 0x61, 0x79, 0x65, 0x72, 0x5F, 0x61, 0x6E, 0x69,
+    0x6D, 0x61, 0x74, 0x6F, 0x72, 0x00, 0x01, 0x2D, 0x00, 0x00, 0x00, 0x74,
+    0x69, 0x6D, 0x65, 0x72, 0x00, 0x07, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0xE0, 0x3F, 0x69, 0x74, 0x65, 0x6D, 0x00, 0x01, 0x13, 0x00, 0x00, 0x00,
+    0x63, 0x6F, 0x75, 0x6E, 0x74, 0x00, 0x03, 0x01, 0x69, 0x64, 0x00, 0x03,
+    0x0C, 0x00, 0x00, 0x00, 0x72, 0x69, 0x67, 0x69, 0x64, 0x62, 0x6F, 0x64,
+    0x79, 0x00, 0x01, 0x5A, 0x00, 0x00, 0x00, 0x65, 0x6E, 0x61, 0x62, 0x6C,
+    0x65, 0x64, 0x00, 0x0A, 0x63, 0x72, 0x6F, 0x75, 0x63, 0x68, 0x00, 0x0B,
+    0x74, 0x79, 0x70, 0x65, 0x00, 0x08, 0x07, 0x00, 0x00, 0x00, 0x64, 0x79,
+    0x6E, 0x61, 0x6D, 0x69, 0x63, 0x64, 0x61, 0x6D, 0x70, 0x69, 0x6E, 0x67,
+    0x00, 0x07, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xF0, 0x3F, 0x76, 0x65,
+    0x6C, 0x00, 0x02, 0x07, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x07, 0x9A, 0x99, 0x99, 0x99, 0x99, 0x99, 0x23, 0xC0, 0x07, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x73, 0x6B, 0x65, 0x6C,
+    0x65, 0x74, 0x6F, 0x6E, 0x00, 0x01, 0xC2, 0x00, 0x00, 0x00, 0x70, 0x6F,
+    0x73, 0x65, 0x00, 0x02, 0x02, 0x07, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0xF0, 0x3F, 0x07, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x07,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x07, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x07, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x07, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xF0, 0x3F, 0x07,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x07, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x07, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x07, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x07,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xF0, 0x3F, 0x07, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x07, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x07, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x07,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x07, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0xF0, 0x3F, 0x00, 0x00, 0x74, 0x65, 0x78, 0x74, 0x75,
+    0x72, 0x65, 0x73, 0x00, 0x01, 0x1A, 0x00, 0x00, 0x00, 0x24, 0x30, 0x00,
+    0x08, 0x0C, 0x00, 0x00, 0x00, 0x62, 0x6C, 0x6F, 0x63, 0x6B, 0x73, 0x3A,
+    0x73, 0x74, 0x6F, 0x6E, 0x65, 0x00, 0x00, 0x74, 0x72, 0x61, 0x6E, 0x73,
+    0x66, 0x6F, 0x72, 0x6D, 0x00, 0x01, 0xA0, 0x00, 0x00, 0x00, 0x73, 0x69,
+    0x7A, 0x65, 0x00, 0x02, 0x07, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0xE3,
+    0x3F, 0x07, 0xCD, 0xCC, 0xCC, 0xCC, 0xCC, 0xCC, 0xFC, 0x3F, 0x07, 0x33,
+    0x33, 0x33, 0x33, 0x33, 0x33, 0xE3, 0x3F, 0x00, 0x72, 0x6F, 0x74, 0x00,
+    0x02, 0x07, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xF0, 0x3F, 0x07, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x07, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x07, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x07, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xF0, 0x3F, 0x07, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x07, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x07, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x07, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xF0, 0x3F, 0x00, 0x70,
+    0x6F, 0x73, 0x00, 0x02, 0x07, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x29,
+    0x40, 0x07, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x50, 0x40, 0x07, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x0A, 0xC0, 0x00, 0x00, 0x75, 0x69, 0x64,
+    0x00, 0x04, 0x01, 0x04, 0x64, 0x65, 0x66, 0x00, 0x08, 0x0B, 0x00, 0x00,
+    0x00, 0x62, 0x61, 0x73, 0x65, 0x3A, 0x70, 0x6C, 0x61, 0x79, 0x65, 0x72,
+    0x00, 0x00, 0x00
+};
+
 static util::BufferPool<ubyte> buffer_pools[] {
     {255},
     {UINT16_MAX},
@@ -27,13 +119,13 @@ static std::shared_ptr<ubyte[]> get_buffer(size_t minSize) {
     return nullptr;
 }
 
-static auto compress_rle(
-    const ubyte* src,
-    size_t srclen,
-    size_t& len,
-    size_t(*encodefunc)(const ubyte*, size_t, ubyte*)
+/// @brief Encode data using pooled buffer if available
+/// @param bufferSize max encoded data length
+/// @param encodefunc encoder writing to the given buffer
+template <typename EncodeFunc>
+static auto compress_buffered(
+    size_t bufferSize, size_t& len, const EncodeFunc& encodefunc
 ) {
-    size_t bufferSize = srclen * 2;
     auto buffer = get_buffer(bufferSize);
     auto bytes = buffer.get();
     std::unique_ptr<ubyte[]> uptr;
@@ -41,7 +133,7 @@ static auto compress_rle(
         uptr = std::make_unique<ubyte[]>(bufferSize);
         bytes = uptr.get();
     }
-    len = encodefunc(src, srclen, bytes);
+    len = encodefunc(bytes);
     if (uptr) {
         if (len < bufferSize * BUFFER_NOCROP_THRESOLD) {
             auto cropped = std::make_unique<ubyte[]>(len);
@@ -55,6 +147,52 @@ static auto compress_rle(
     return data;
 }
 
+static auto compress_rle(
+    const ubyte* src,
+    size_t srclen,
+    size_t& len,
+    size_t(*encodefunc)(const ubyte*, size_t, ubyte*)
+) {
+    return compress_buffered(srclen * 2, len, [=](ubyte* dst) {
+        return encodefunc(src, srclen, dst);
+    });
+}
+
+static auto compress_lz(
+    const ubyte* src,
+    size_t srclen,
+    size_t& len,
+    const ubyte* dict = nullptr,
+    size_t dictLength = 0
+) {
+    return compress_buffered(lz::compress_bound(srclen), len, [=](ubyte* dst) {
+        return lz::encode(src, srclen, dst, dict, dictLength);
+    });
+}
+
+static void check_decompressed_size(size_t expected, size_t decoded) {
+    if (decoded != expected) {
+        throw std::runtime_error(
+            "expected decompressed size " + std::to_string(expected) +
+            " got " + std::to_string(decoded));
+    }
+}
+
+static std::unique_ptr<ubyte[]> decompress_lz(
+    const ubyte* src,
+    size_t srclen,
+    size_t dstlen,
+    const ubyte* dict = nullptr,
+    size_t dictLength = 0
+) {
+    auto decompressed = std::make_unique<ubyte[]>(dstlen);
+    size_t decoded = lz::decode(
+        src, srclen, decompressed.get(), dstlen, dict, dictLength
+    );
+    check_decompressed_size(dstlen, decoded);
+    return decompressed;
+}
+
 std::unique_ptr<ubyte[]> compression::compress(
     const ubyte* src, size_t srclen, size_t& len, Method method
 ) {
@@ -65,6 +203,24 @@ std::unique_ptr<ubyte[]> compression::compress(
             return compress_rle(src, srclen, len, extrle::encode);
         case Method::EXTRLE16:
             return compress_rle(src, srclen, len, extrle::encode16);
+        case Method::LZ:
+            return compress_lz(src, srclen, len);
+        case Method::EXTRLE16_LZ: {
+            size_t bufferSize = srclen * 2;
+            auto buffer = get_buffer(bufferSize);
+            std::unique_ptr<ubyte[]> uptr;
+            ubyte* rleData = buffer.get();
+            if (rleData == nullptr) {
+                uptr = std::make_unique<ubyte[]>(bufferSize);
+                rleData = uptr.get();
+            }
+            size_t rleLength = extrle::encode16(src, srclen, rleData);
+            return compress_lz(rleData, rleLength, len);
+        }
+        case Method::LZ_BJSON:
+            return compress_lz(
+                src, srclen, len, BJSON_DICTIONARY, sizeof(BJSON_DICTIONARY)
+            );
         case Method::GZIP: {
             auto buffer = gzip::compress(src, srclen);
             auto data = std::make_unique<ubyte[]>(buffer.size());
@@ -91,20 +247,36 @@ std::unique_ptr<ubyte[]> compression::decompress(
         case Method::EXTRLE16: {
             auto decompressed = std::make_unique<ubyte[]>(dstlen);
             size_t decoded = extrle::decode16(src, srclen, decompressed.get());
-            if (decoded != dstlen) {
-                throw std::runtime_error(
-                    "expected decompressed size " + std::to_string(dstlen) +
-                    " got " + std::to_string(decoded));
+            check_decompressed_size(dstlen, decoded);
+            return decompressed;
+        }
+        case Method::LZ:
+            return decompress_lz(src, srclen, dstlen);
+        case Method::EXTRLE16_LZ: {
+            // EXTRLE16 output is not longer than twice the source
+            size_t bufferSize = dstlen * 2;
+            auto buffer = get_buffer(bufferSize);
+            std::unique_ptr<ubyte[]> uptr;
+            ubyte* rleData = buffer.get();
+            if (rleData == nullptr) {
+                uptr = std::make_unique<ubyte[]>(bufferSize);
+                rleData = uptr.get();
             }
+            size_t rleLength =
+                lz::decode(src, srclen, rleData, bufferSize);
+            auto decompressed = std::make_unique<ubyte[]>(dstlen);
+            size_t decoded =
+                extrle::decode16(rleData, rleLength, decompressed.get());
+            check_decompressed_size(dstlen, decoded);
             return decompressed;
         }
+        case Method::LZ_BJSON:
+            return decompress_lz(
+                src, srclen, dstlen, BJSON_DICTIONARY, sizeof(BJSON_DICTIONARY)
+            );
         case Method::GZIP: {
             auto buffer = gzip::decompress(src, srclen);
-            if (buffer.size() != dstlen) {
-                throw std::runtime_error(
-                    "expected decompressed size " + std::to_string(dstlen) +
-                    " got " + std::to_string(buffer.size()));
-            }
+            check_decompressed_size(dstlen, buffer.size());
             auto decompressed = std::make_unique<ubyte[]>(buffer.size());
             std::memcpy(decompressed.get(), buffer.data(), buffer.size());
             return decompressed;
@@ -5,10 +5,24 @@
 #include "typedefs.hpp"
 
 namespace compression {
+    /// @brief Compression methods. Values are stored in files, so new
+    /// methods must be added to the end
     enum class Method {
-        NONE, EXTRLE8, EXTRLE16, GZIP
+        NONE,
+        EXTRLE8,
+        EXTRLE16,
+        GZIP,
+        /// @brief Fast LZ77 codec (see coders/lz.hpp)
+        LZ,
+        /// @brief EXTRLE16 output compressed with LZ
+        EXTRLE16_LZ,
+        /// @brief LZ with preset dictionary made of typical binary JSON
+        /// documents (entities, inventories)
+        LZ_BJSON,
     };
 
+    inline constexpr Method LAST_METHOD = Method::LZ_BJSON;
+
     /// @brief Compress buffer
     /// @param src source buffer
     /// @param srclen length of the source buffer
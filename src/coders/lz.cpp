@@ -0,0 +1,229 @@
+#include "lz.hpp"
+
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+
+inline constexpr uint HASH_BITS = 14;
+inline constexpr size_t HASH_SIZE = 1 << HASH_BITS;
+/// @brief Number of missed positions increasing search step by one
+/// (makes incompressible data skipped faster)
+inline constexpr uint SKIP_TRIGGER = 6;
+
+static inline uint32_t read32(const ubyte* src) {
+    uint32_t value;
+    std::memcpy(&value, src, sizeof(value));
+    return value;
+}
+
+static inline uint hash32(uint32_t value) {
+    return (value * 2654435761U) >> (32 - HASH_BITS);
+}
+
+/// @brief Count equal bytes
+static inline size_t count_match(
+    const ubyte* a, const ubyte* b, const ubyte* bEnd
+) {
+    const ubyte* start = b;
+    while (b + 8 <= bEnd) {
+        uint64_t x, y;
+        std::memcpy(&x, a, 8);
+        std::memcpy(&y, b, 8);
+        if (x != y) {
+            break;
+        }
+        a += 8;
+        b += 8;
+    }
+    while (b < bEnd && *a == *b) {
+        a++;
+        b++;
+    }
+    return b - start;
+}
+
+static inline ubyte* write_length(ubyte* dst, size_t length) {
+    while (length >= 255) {
+        *dst++ = 255;
+        length -= 255;
+    }
+    *dst++ = static_cast<ubyte>(length);
+    return dst;
+}
+
+static ubyte* write_sequence(
+    ubyte* dst,
+    const ubyte* literals,
+    size_t literalsCount,
+    size_t offset,
+    size_t matchLength
+) {
+    ubyte* token = dst++;
+    *token = (literalsCount < 15 ? literalsCount : 15) << 4;
+    if (literalsCount >= 15) {
+        dst = write_length(dst, literalsCount - 15);
+    }
+    std::memcpy(dst, literals, literalsCount);
+    dst += literalsCount;
+    if (matchLength == 0) {
+        return dst;
+    }
+    *dst++ = offset & 0xFF;
+    *dst++ = offset >> 8;
+
+    matchLength -= lz::min_match;
+    *token |= matchLength < 15 ? matchLength : 15;
+    if (matchLength >= 15) {
+        dst = write_length(dst, matchLength - 15);
+    }
+    return dst;
+}
+
+/// @brief Compress buf[start, end) where buf[0, start) is dictionary
+static size_t encode_block(
+    const ubyte* buf, size_t start, size_t end, ubyte* dst
+) {
+    // positions are stored + 1, so 0 means empty cell
+    auto table = std::make_unique<uint32_t[]>(HASH_SIZE);
+    for (size_t i = 0; i + lz::min_match <= start; i++) {
+        table[hash32(read32(buf + i))] = i + 1;
+    }
+    ubyte* out = dst;
+    size_t anchor = start;
+    size_t pos = start;
+    while (pos + lz::min_match <= end) {
+        uint32_t sequence = read32(buf + pos);
+        uint hash = hash32(sequence);
+        size_t ref = table[hash];
+        table[hash] = pos + 1;
+
+        if (ref == 0 || pos - (ref - 1) > lz::max_offset ||
+            read32(buf + ref - 1) != sequence) {
+            pos += 1 + ((pos - anchor) >> SKIP_TRIGGER);
+            continue;
+        }
+        size_t matchPos = ref - 1;
+        size_t length = lz::min_match + count_match(
+            buf + matchPos + lz::min_match,
+            buf + pos + lz::min_match,
+            buf + end
+        );
+        out = write_sequence(
+            out, buf + anchor, pos - anchor, pos - matchPos, length
+        );
+        pos += length;
+        anchor = pos;
+        if (pos + lz::min_match <= end) {
+            table[hash32(read32(buf + pos - 2))] = pos - 2 + 1;
+        }
+    }
+    out = write_sequence(out, buf + anchor, end - anchor, 0, 0);
+    return out - dst;
+}
+
+size_t lz::encode(
+    const ubyte* src,
+    size_t length,
+    ubyte* dst,
+    const ubyte* dict,
+    size_t dictLength
+) {
+    if (dict == nullptr || dictLength == 0) {
+        return encode_block(src, 0, length, dst);
+    }
+    if (dictLength > max_offset) {
+        dict += dictLength - max_offset;
+        dictLength = max_offset;
+    }
+    auto buffer = std::make_unique<ubyte[]>(dictLength + length);
+    std::memcpy(buffer.get(), dict, dictLength);
+    std::memcpy(buffer.get() + dictLength, src, length);
+    return encode_block(buffer.get(), dictLength, dictLength + length, dst);
+}
+
+static inline size_t read_length(
+    const ubyte* src, size_t length, size_t& pos
+) {
+    size_t value = 0;
+    ubyte byte;
+    do {
+        if (pos >= length) {
+            throw std::runtime_error("corrupted lz data");
+        }
+        byte = src[pos++];
+        value += byte;
+    } while (byte == 255);
+    return value;
+}
+
+/// @brief Copy match where source may overlap destination
+static inline void copy_match(ubyte* dst, size_t distance, size_t length) {
+    // repeated sequence period is the distance or any multiple of it
+    while (length > 0) {
+        size_t count = distance < length ? distance : length;
+        std::memcpy(dst, dst - distance, count);
+        dst += count;
+        length -= count;
+        distance += count;
+    }
+}
+
+size_t lz::decode(
+    const ubyte* src,
+    size_t length,
+    ubyte* dst,
+    size_t dstLength,
+    const ubyte* dict,
+    size_t dictLength
+) {
+    if (dict == nullptr) {
+        dictLength = 0;
+    } else if (dictLength > max_offset) {
+        dict += dictLength - max_offset;
+        dictLength = max_offset;
+    }
+    size_t pos = 0;
+    size_t out = 0;
+    while (pos < length) {
+        ubyte token = src[pos++];
+
+        size_t literalsCount = token >> 4;
+        if (literalsCount == 15) {
+            literalsCount += read_length(src, length, pos);
+        }
+        if (literalsCount > length - pos || literalsCount > dstLength - out) {
+            throw std::runtime_error("corrupted lz data");
+        }
+        std::memcpy(dst + out, src + pos, literalsCount);
+        pos += literalsCount;
+        out += literalsCount;
+        if (pos == length) {
+            break;
+        }
+
+        if (length - pos < 2) {
+            throw std::runtime_error("corrupted lz data");
+        }
+        size_t offset = src[pos] | (src[pos + 1] << 8);
+        pos += 2;
+        size_t matchLength = (token & 0xF) + min_match;
+        if ((token & 0xF) == 15) {
+            matchLength += read_length(src, length, pos);
+        }
+        if (offset == 0 || offset > out + dictLength ||
+            matchLength > dstLength - out) {
+            throw std::runtime_error("corrupted lz data");
+        }
+        if (offset > out) {
+            // match starts in dictionary
+            size_t fromDict = offset - out;
+            size_t count = fromDict < matchLength ? fromDict : matchLength;
+            std::memcpy(dst + out, dict + dictLength - fromDict, count);
+            out += count;
+            matchLength -= count;
+        }
+        copy_match(dst + out, offset, matchLength);
+        out += matchLength;
+    }
+    return out;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "typedefs.hpp"
+
+/// @brief Fast LZ77 byte-oriented codec (LZ4-like block format).
+///
+/// Compressed block is a sequence of
+/// [token][literals length ext][literals][offset][match length ext],
+/// where token keeps literals length in high and match length minus 4 in low
+/// 4 bits (15 means length continues in following bytes, each 255 adds
+/// 255 and the first byte less than 255 ends the length). Offset is a 16-bit
+/// little-endian distance back to the match start. The last sequence contains
+/// literals only.
+///
+/// Optional dictionary is treated as data preceding the source, so matches
+/// may refer to it. The same dictionary must be used for decoding.
+namespace lz {
+    constexpr uint min_match = 4;
+    constexpr uint max_offset = 0xFFFF;
+
+    /// @brief Get max compressed length of source data
+    constexpr size_t compress_bound(size_t length) {
+        return length + length / 255 + 16;
+    }
+
+    /// @brief Compress data
+    /// @param dst destination buffer of compress_bound(length) size at least
+    /// @param dict dictionary (nullable)
+    /// @return compressed data length
+    size_t encode(
+        const ubyte* src,
+        size_t length,
+        ubyte* dst,
+        const ubyte* dict = nullptr,
+        size_t dictLength = 0
+    );
+
+    /// @brief Decompress data
+    /// @param dstLength destination buffer size
+    /// @return decompressed data length
+    /// @throws std::runtime_error - corrupted data or destination buffer
+    /// is too small
+    size_t decode(
+        const ubyte* src,
+        size_t length,
+        ubyte* dst,
+        size_t dstLength,
+        const ubyte* dict = nullptr,
+        size_t dictLength = 0
+    );
+}
@@ -1,7 +1,24 @@
 #include "rle.hpp"
 
+#include <algorithm>
+#include <atomic>
+
 #include "util/data_io.hpp"
 
+#if defined(__x86_64__) || defined(_M_X64)
+    // SSE2 is always available on x86-64
+    #define RLE_SIMD_X86
+    #include <immintrin.h>
+    #ifdef _MSC_VER
+        #include <intrin.h>
+    #endif
+    #if defined(__GNUC__) || defined(__clang__)
+        #define RLE_TARGET_AVX2 __attribute__((target("avx2")))
+    #else
+        #define RLE_TARGET_AVX2
+    #endif
+#endif
+
 size_t rle::decode(const ubyte* src, size_t srclen, ubyte* dst) {
     size_t offset = 0;
     for (size_t i = 0; i < srclen;) {
@@ -125,7 +142,185 @@ size_t extrle::encode(const ubyte* src, size_t srclen, ubyte* dst) {
     return offset;
 }
 
+/// @brief Runs shorter than this are expanded without fill kernel call
+inline constexpr size_t FILL_KERNEL_MIN_RUN = 16;
+
+namespace {
+    /// @brief extRLE16 vectorized parts
+    struct Kernels16 {
+        /// @brief Count leading values equal to c
+        /// @param limit max number of values to check
+        size_t (*countRun)(const uint16_t* src, size_t limit, uint16_t c);
+        /// @brief Fill destination with count values
+        void (*fill)(uint16_t* dst, size_t count, uint16_t c);
+    };
+}
+
+static size_t count_run16_scalar(
+    const uint16_t* src, size_t limit, uint16_t c
+) {
+    size_t i = 0;
+    while (i < limit && src[i] == c) {
+        i++;
+    }
+    return i;
+}
+
+static void fill16_scalar(uint16_t* dst, size_t count, uint16_t c) {
+    std::fill_n(dst, count, c);
+}
+
+static constexpr Kernels16 SCALAR_KERNELS {count_run16_scalar, fill16_scalar};
+
+#ifdef RLE_SIMD_X86
+
+/// @brief Get number of trailing 1 bits in comparison mask
+static inline uint count_trailing_ones(uint mask) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, ~mask);
+    return index;
+#else
+    return __builtin_ctz(~mask);
+#endif
+}
+
+static size_t count_run16_sse2(const uint16_t* src, size_t limit, uint16_t c) {
+    const __m128i value = _mm_set1_epi16(static_cast<short>(c));
+    size_t i = 0;
+    for (; i + 8 <= limit; i += 8) {
+        __m128i block =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        uint mask = _mm_movemask_epi8(_mm_cmpeq_epi16(block, value));
+        if (mask != 0xFFFF) {
+            return i + count_trailing_ones(mask) / 2;
+        }
+    }
+    return i + count_run16_scalar(src + i, limit - i, c);
+}
+
+static void fill16_sse2(uint16_t* dst, size_t count, uint16_t c) {
+    if (count < 8) {
+        return fill16_scalar(dst, count, c);
+    }
+    const __m128i value = _mm_set1_epi16(static_cast<short>(c));
+    for (size_t i = 0; i + 8 <= count; i += 8) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), value);
+    }
+    // last block overlaps already filled values
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + count - 8), value);
+}
+
+RLE_TARGET_AVX2 static size_t count_run16_avx2(
+    const uint16_t* src, size_t limit, uint16_t c
+) {
+    const __m256i value = _mm256_set1_epi16(static_cast<short>(c));
+    size_t i = 0;
+    for (; i + 16 <= limit; i += 16) {
+        __m256i block =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        uint mask = static_cast<uint>(
+            _mm256_movemask_epi8(_mm256_cmpeq_epi16(block, value))
+        );
+        if (mask != 0xFFFFFFFF) {
+            return i + count_trailing_ones(mask) / 2;
+        }
+    }
+    return i + count_run16_sse2(src + i, limit - i, c);
+}
+
+RLE_TARGET_AVX2 static void fill16_avx2(
+    uint16_t* dst, size_t count, uint16_t c
+) {
+    if (count < 16) {
+        return fill16_sse2(dst, count, c);
+    }
+    const __m256i value = _mm256_set1_epi16(static_cast<short>(c));
+    for (size_t i = 0; i + 16 <= count; i += 16) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), value);
+    }
+    // last block overlaps already filled values
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + count - 16), value);
+}
+
+static constexpr Kernels16 SSE2_KERNELS {count_run16_sse2, fill16_sse2};
+static constexpr Kernels16 AVX2_KERNELS {count_run16_avx2, fill16_avx2};
+
+static bool is_avx2_supported() {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return false;
+    }
+    __cpuid(info, 1);
+    bool osxsave = info[2] & (1 << 27);
+    bool avx = info[2] & (1 << 28);
+    // ymm registers state must be saved by OS
+    if (!osxsave || !avx || (_xgetbv(0) & 6) != 6) {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return info[1] & (1 << 5);
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif // RLE_SIMD_X86
+
+static const Kernels16* get_kernels16(extrle::Simd simd) {
+    switch (simd) {
+#ifdef RLE_SIMD_X86
+        case extrle::Simd::SSE2:
+            return &SSE2_KERNELS;
+        case extrle::Simd::AVX2:
+            return is_avx2_supported() ? &AVX2_KERNELS : nullptr;
+#endif
+        case extrle::Simd::NONE:
+            return &SCALAR_KERNELS;
+        default:
+            return nullptr;
+    }
+}
+
+extrle::Simd extrle::get_supported_simd() {
+    static const Simd supported = [] {
+        for (auto simd : {Simd::AVX2, Simd::SSE2}) {
+            if (get_kernels16(simd)) {
+                return simd;
+            }
+        }
+        return Simd::NONE;
+    }();
+    return supported;
+}
+
+/// @brief Selected kernels (nullptr until the first use)
+static std::atomic<const Kernels16*> kernels16 {nullptr};
+
+static const Kernels16& get_kernels16() {
+    auto kernels = kernels16.load(std::memory_order_relaxed);
+    if (kernels == nullptr) {
+        auto supported = get_kernels16(extrle::get_supported_simd());
+        // not replacing kernels set by another thread
+        if (kernels16.compare_exchange_strong(kernels, supported)) {
+            kernels = supported;
+        }
+    }
+    return *kernels;
+}
+
+bool extrle::set_simd(Simd simd) {
+    if (auto kernels = get_kernels16(simd)) {
+        kernels16 = kernels;
+        return true;
+    }
+    return false;
+}
+
 size_t extrle::decode16(const ubyte* src, size_t srclen, ubyte* dst8) {
+    const auto& kernels = get_kernels16();
     auto dst = reinterpret_cast<uint16_t*>(dst8);
     size_t offset = 0;
     for (size_t i = 0; i < srclen;) {
@@ -141,53 +336,45 @@ size_t extrle::decode16(const ubyte* src, size_t srclen, ubyte* dst8) {
         if (widechar) {
             c |= ((static_cast<uint>(src[i++])) << 8);
         }
-        for (size_t j = 0; j <= len; j++) {
-            dst[offset++] = c;
+        size_t count = len + 1;
+        if (count < FILL_KERNEL_MIN_RUN) {
+            for (size_t j = 0; j < count; j++) {
+                dst[offset + j] = c;
+            }
+        } else {
+            kernels.fill(dst + offset, count, c);
         }
+        offset += count;
     }
     return offset * 2;
 }
 
 size_t extrle::encode16(const ubyte* src8, size_t srclen, ubyte* dst) {
-    if (srclen == 0) {
-        return 0;
-    }
+    const auto& kernels = get_kernels16();
     auto src = reinterpret_cast<const uint16_t*>(src8);
+    size_t length = srclen / 2;
     size_t offset = 0;
-    uint counter = 0;
-    uint16_t c = src[0];
-    for (size_t i = 1; i < srclen/2; i++) {
-        uint16_t cnext = src[i];
-        if (cnext != c || counter == max_sequence16) {
-            if (counter >= 0x40) {
-                dst[offset++] = 0x80 | ((c > 255) << 6) | (counter & 0x3F);
-                dst[offset++] = counter >> 6;
-            } else {
-                dst[offset++] = counter | ((c > 255) << 6);
-            }
-            if (c > 255) {
-                dst[offset++] = c & 0xFF;
-                dst[offset++] = c >> 8;
-            } else {
-                dst[offset++] = c;
-            }
-            c = cnext;
-            counter = 0;
+    for (size_t i = 0; i < length;) {
+        uint16_t c = src[i++];
+        // run contains max_sequence16 + 1 values max
+        size_t limit = std::min<size_t>(length - i, max_sequence16);
+        uint counter = 0;
+        if (limit > 0 && src[i] == c) {
+            counter = kernels.countRun(src + i, limit, c);
+            i += counter;
+        }
+        if (counter >= 0x40) {
+            dst[offset++] = 0x80 | ((c > 255) << 6) | (counter & 0x3F);
+            dst[offset++] = counter >> 6;
         } else {
-            counter++;
+            dst[offset++] = counter | ((c > 255) << 6);
+        }
+        if (c > 255) {
+            dst[offset++] = c & 0xFF;
+            dst[offset++] = c >> 8;
+        } else {
+            dst[offset++] = c;
         }
-    }
-    if (counter >= 0x40) {
-        dst[offset++] = 0x80 | ((c > 255) << 6) | (counter & 0x3F);
-        dst[offset++] = counter >> 6;
-    } else {
-        dst[offset++] = counter | ((c > 255) << 6);
-    }
-    if (c > 255) {
-        dst[offset++] = c & 0xFF;
-        dst[offset++] = c >> 8;
-    } else {
-        dst[offset++] = c;
     }
     return offset;
 }
@@ -18,4 +18,20 @@ namespace extrle {
     constexpr uint max_sequence16 = 0x3FFF;
     size_t encode16(const ubyte* src, size_t length, ubyte* dst);
     size_t decode16(const ubyte* src, size_t length, ubyte* dst);
+
+    /// @brief Instruction sets used by encode16 and decode16 kernels.
+    /// Encoded data does not depend on the instruction set
+    enum class Simd {
+        NONE,
+        SSE2,
+        AVX2,
+    };
+
+    /// @brief Get the best instruction set supported by CPU.
+    /// Used by default
+    Simd get_supported_simd();
+
+    /// @brief Select instruction set used by encode16 and decode16
+    /// @return false if the instruction set is not supported
+    bool set_simd(Simd simd);
 }
@@ -17,7 +17,10 @@ inline constexpr bool ENGINE_DEBUG_BUILD = true;
 inline const std::string ENGINE_VERSION_STRING = "0.26";
 
 /// @brief world regions format version
-inline constexpr uint REGION_FORMAT_VERSION = 3;
+inline constexpr uint REGION_FORMAT_VERSION = 4;
+/// @brief oldest world regions format version readable without conversion.
+/// Region files of compatible versions are upgraded when rewritten
+inline constexpr uint REGION_FORMAT_MIN_VERSION = 3;
 
 /// @brief max simultaneously open world region files
 inline constexpr uint MAX_OPEN_REGION_FILES = 32;
@@ -35,14 +38,16 @@ inline constexpr int CHUNK_D = 16;
 inline constexpr uint VOXEL_USER_BITS = 8;
 inline constexpr uint VOXEL_USER_BITS_OFFSET = sizeof(blockstate_t)*8-VOXEL_USER_BITS;
 
-/// @brief % unordered map max average buckets load factor.
-/// Low value gives significant performance impact by minimizing collisions and
-/// lookup latency. Default value (1.0) shows x2 slower work.
-inline constexpr float CHUNKS_MAP_MAX_LOAD_FACTOR = 0.1f;
-
 /// @brief chunk volume (count of voxels per Chunk)
 inline constexpr int CHUNK_VOL = (CHUNK_W * CHUNK_H * CHUNK_D);
 
+/// @brief chunk section height (sections are horizontal slabs of chunk)
+inline constexpr int CHUNK_SECTION_H = 16;
+/// @brief number of sections in chunk
+inline constexpr int CHUNK_SECTIONS = CHUNK_H / CHUNK_SECTION_H;
+/// @brief number of voxels in chunk section
+inline constexpr int CHUNK_SECTION_VOL = CHUNK_W * CHUNK_SECTION_H * CHUNK_D;
+
 /// @brief block id used to mark non-existing voxel (voxel of missing chunk)
 inline constexpr blockid_t BLOCK_VOID = std::numeric_limits<blockid_t>::max();
 /// @brief item id used to mark non-existing item (error)
@@ -15,7 +15,9 @@
 #include "Time.hpp"
 
 #include <filesystem>
+#include <glm/glm.hpp>
 #include <memory>
+#include <optional>
 #include <stdexcept>
 #include <string>
 #include <vector>
@@ -51,6 +53,15 @@ struct CoreParameters {
     std::filesystem::path resFolder {"res"};
     std::filesystem::path userFolder {"."};
     std::filesystem::path scriptFile;
+    /// @brief Name of the world to pre-generate in headless mode
+    std::string pregenWorld;
+    /// @brief Pre-generation area in chunks {minX, minZ, maxX, maxZ}
+    std::optional<glm::ivec4> pregenArea;
+    /// @brief Name of the world to run meshing benchmark on in headless
+    /// mode (uses pregenArea)
+    std::string benchmarkWorld;
+    /// @brief Number of meshing benchmark passes
+    int benchmarkPasses = 3;
 };
 
 using OnWorldOpen = std::function<void(std::unique_ptr<Level>, int64_t)>;
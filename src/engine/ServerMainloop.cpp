@@ -3,13 +3,18 @@
 #include "Engine.hpp"
 #include "logic/scripting/scripting.hpp"
 #include "logic/LevelController.hpp"
+#include "logic/EngineController.hpp"
+#include "logic/WorldPregenerator.hpp"
+#include "graphics/render/MeshingBenchmark.hpp"
 #include "interfaces/Process.hpp"
 #include "debug/Logger.hpp"
 #include "world/Level.hpp"
 #include "world/World.hpp"
 #include "util/platform.hpp"
 
+#include <algorithm>
 #include <chrono>
+#include <thread>
 
 using namespace std::chrono;
 
@@ -26,6 +31,14 @@ void ServerMainloop::run() {
     const auto& coreParams = engine.getCoreParameters();
     auto& time = engine.getTime();
 
+    if (!coreParams.pregenWorld.empty()) {
+        pregenerate();
+        return;
+    }
+    if (!coreParams.benchmarkWorld.empty()) {
+        benchmarkMeshing();
+        return;
+    }
     if (coreParams.scriptFile.empty()) {
         logger.info() << "nothing to do";
         return;
@@ -73,6 +86,65 @@ void ServerMainloop::run() {
     logger.info() << "script finished";
 }
 
+std::unique_ptr<Level> ServerMainloop::openLevel(const std::string& name) {
+    std::unique_ptr<Level> level;
+    engine.setLevelConsumer([&level](auto newLevel, auto) {
+        level = std::move(newLevel);
+    });
+    engine.getController()->openWorld(name, true);
+    engine.setLevelConsumer([](auto, auto) {});
+    if (level == nullptr) {
+        logger.error() << "could not open world " << name;
+    }
+    return level;
+}
+
+void ServerMainloop::pregenerate() {
+    const auto& coreParams = engine.getCoreParameters();
+    if (!coreParams.pregenArea.has_value()) {
+        throw std::runtime_error("pre-generation area is not specified");
+    }
+    auto level = openLevel(coreParams.pregenWorld);
+    if (level == nullptr) {
+        return;
+    }
+    uint workers = std::max(1U, std::thread::hardware_concurrency()) - 1;
+    WorldPregenerator task(*level, *coreParams.pregenArea, workers);
+    while (task.isActive()) {
+        if (engine.isQuitSignal()) {
+            task.terminate();
+            break;
+        }
+        task.update();
+    }
+    level.reset();
+    engine.getPaths().setCurrentWorldFolder(fs::path());
+}
+
+void ServerMainloop::benchmarkMeshing() {
+    const auto& coreParams = engine.getCoreParameters();
+    if (!coreParams.pregenArea.has_value()) {
+        throw std::runtime_error("benchmark area is not specified");
+    }
+    auto level = openLevel(coreParams.benchmarkWorld);
+    if (level == nullptr) {
+        return;
+    }
+    {
+        MeshingBenchmark benchmark(
+            *level,
+            *engine.getResPaths(),
+            engine.getSettings(),
+            *coreParams.pregenArea
+        );
+        if (!benchmark.run(std::max(1, coreParams.benchmarkPasses))) {
+            logger.error() << "chunks meshing is not deterministic";
+        }
+    }
+    level.reset();
+    engine.getPaths().setCurrentWorldFolder(fs::path());
+}
+
 void ServerMainloop::setLevel(std::unique_ptr<Level> level) {
     if (level == nullptr) {
         controller->onWorldQuit();
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <memory>
+#include <string>
 
 class Level;
 class LevelController;
@@ -9,6 +10,14 @@ class Engine;
 class ServerMainloop {
     Engine& engine;
     std::unique_ptr<LevelController> controller;
+
+    /// @brief Open world without a level controller
+    /// @return nullptr if the world could not be opened
+    std::unique_ptr<Level> openLevel(const std::string& name);
+    /// @brief Run world pre-generation task (see WorldPregenerator)
+    void pregenerate();
+    /// @brief Run chunks meshing benchmark (see MeshingBenchmark)
+    void benchmarkMeshing();
 public:
     ServerMainloop(Engine& engine);
     ~ServerMainloop();
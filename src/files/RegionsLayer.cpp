@@ -1,5 +1,7 @@
 #include "WorldRegions.hpp"
 
+#include <algorithm>
+#include <chrono>
 #include <cstring>
 
 #include "util/data_io.hpp"
@@ -10,26 +12,121 @@ static fs::path get_region_filename(int x, int z) {
     return fs::path(std::to_string(x) + "_" + std::to_string(z) + ".bin");
 }
 
-/// @brief Read missing chunks data (null pointers) from region file
-static void fetch_chunks(WorldRegion* region, int x, int z, regfile* file) {
-    auto* chunks = region->getChunks();
-    auto sizes = region->getSizes();
+static uint32_t count_sectors(size_t length) {
+    return (length + REGION_SECTOR_SIZE - 1) / REGION_SECTOR_SIZE;
+}
 
-    for (size_t i = 0; i < REGION_CHUNKS_COUNT; i++) {
-        int chunk_x = (i % REGION_SIZE) + x * REGION_SIZE;
-        int chunk_z = (i / REGION_SIZE) + z * REGION_SIZE;
-        if (chunks[i] == nullptr) {
-            chunks[i] = RegionsLayer::readChunkData(
-                    chunk_x, chunk_z, sizes[i][0], sizes[i][1], file);
+/// @brief Chunk record length including sizes
+static size_t record_length(uint32_t size) {
+    return 8 + static_cast<size_t>(size);
+}
+
+static void write_record(
+    std::ostream& file, const ubyte* data, uint32_t size, uint32_t srcSize
+) {
+    uint32_t intbuf = dataio::h2le(size);
+    file.write(reinterpret_cast<const char*>(&intbuf), 4);
+    intbuf = dataio::h2le(srcSize);
+    file.write(reinterpret_cast<const char*>(&intbuf), 4);
+    file.write(reinterpret_cast<const char*>(data), size);
+}
+
+namespace {
+    /// @brief Region file sectors allocator
+    class SectorsAllocator {
+        struct SectorsRun {
+            uint32_t first;
+            uint32_t count;
+        };
+        /// @brief Free sectors runs sorted by position
+        std::vector<SectorsRun> freeList;
+        /// @brief Sectors runs freed by this allocator
+        std::vector<SectorsRun> released;
+        /// @brief Number of sectors in file
+        uint32_t end;
+    public:
+        /// @param file region file of sectors format
+        SectorsAllocator(const regfile& file)
+            : end(count_sectors(file.file.length())) {
+            std::vector<SectorsRun> used;
+            for (size_t i = 0; i < REGION_CHUNKS_COUNT; i++) {
+                uint32_t size, srcSize;
+                if (file.getChunkData(i, size, srcSize)) {
+                    used.push_back(SectorsRun {
+                        file.offsets[i] / REGION_SECTOR_SIZE,
+                        count_sectors(record_length(size))});
+                }
+            }
+            std::sort(used.begin(), used.end(), [](auto& a, auto& b) {
+                return a.first < b.first;
+            });
+            uint32_t position = REGION_DATA_OFFSET / REGION_SECTOR_SIZE;
+            for (const auto& run : used) {
+                if (run.first > position) {
+                    freeList.push_back({position, run.first - position});
+                }
+                position = std::max(position, run.first + run.count);
+            }
+            if (end > position) {
+                freeList.push_back({position, end - position});
+            }
+            end = std::max(end, position);
         }
-    }
+
+        /// @brief Allocate sectors run
+        /// @param count number of sectors
+        /// @param reuse allow to use free sectors, otherwise sectors are
+        /// appended to the end of file
+        /// @return first allocated sector
+        uint32_t allocate(uint32_t count, bool reuse) {
+            if (reuse) {
+                for (auto it = freeList.begin(); it != freeList.end(); ++it) {
+                    if (it->count < count) {
+                        continue;
+                    }
+                    uint32_t first = it->first;
+                    it->first += count;
+                    it->count -= count;
+                    if (it->count == 0) {
+                        freeList.erase(it);
+                    }
+                    return first;
+                }
+            }
+            uint32_t first = end;
+            end += count;
+            return first;
+        }
+
+        /// @brief Free sectors run. Freed sectors are not reused by
+        /// the same allocator
+        void free(uint32_t first, uint32_t count) {
+            released.push_back({first, count});
+        }
+
+        /// @brief Get number of unused sectors
+        uint32_t countFree() const {
+            uint32_t count = 0;
+            for (const auto& run : freeList) {
+                count += run.count;
+            }
+            for (const auto& run : released) {
+                count += run.count;
+            }
+            return count;
+        }
+
+        /// @brief Get number of sectors in file after writing
+        uint32_t getEnd() const {
+            return end;
+        }
+    };
 }
 
 regfile::regfile(fs::path filename) : file(std::move(filename)) {
-    if (file.length() < REGION_HEADER_SIZE)
-        throw std::runtime_error("incomplete region file header");
-    char header[REGION_HEADER_SIZE];
-    file.read(header, REGION_HEADER_SIZE);
+    if (file.length() < REGION_HEADER_SIZE + REGION_CHUNKS_COUNT * 4)
+        throw std::runtime_error("incomplete region file");
+    auto header = reinterpret_cast<const char*>(file.data());
 
     // avoid of use strcmp_s
     if (std::string(header, std::strlen(REGION_FORMAT_MAGIC)) !=
@@ -42,53 +139,94 @@ regfile::regfile(fs::path filename) : file(std::move(filename)) {
             "region format " + std::to_string(version) + " is not supported"
         );
     }
+    if (static_cast<ubyte>(header[9]) >
+        static_cast<ubyte>(compression::LAST_METHOD)) {
+        throw illegal_region_format(
+            "unknown region compression method " +
+            std::to_string(static_cast<ubyte>(header[9]))
+        );
+    }
+    compression = static_cast<compression::Method>(header[9]);
+
+    size_t tableOffset;
+    size_t dataStart;
+    size_t dataEnd;
+    if (version >= REGION_SECTORS_VERSION) {
+        if (file.length() < REGION_DATA_OFFSET) {
+            throw std::runtime_error("incomplete region file");
+        }
+        tableOffset = REGION_TABLE_OFFSET;
+        dataStart = REGION_DATA_OFFSET;
+        dataEnd = file.length();
+    } else {
+        tableOffset = file.length() - REGION_CHUNKS_COUNT * 4;
+        dataStart = REGION_HEADER_SIZE;
+        dataEnd = tableOffset;
+    }
+    std::memcpy(offsets, file.data() + tableOffset, REGION_CHUNKS_COUNT * 4);
+    for (size_t i = 0; i < REGION_CHUNKS_COUNT; i++) {
+        offsets[i] = dataio::le2h(offsets[i]);
+        if (offsets[i] < dataStart ||
+            static_cast<size_t>(offsets[i]) + 8 > dataEnd) {
+            // invalid offset - chunk will be considered missing
+            offsets[i] = 0;
+        }
+    }
 }
 
-std::unique_ptr<ubyte[]> regfile::read(int index, uint32_t& size, uint32_t& srcSize) {
-    size_t file_size = file.length();
-    size_t table_offset = file_size - REGION_CHUNKS_COUNT * 4;
-
-    uint32_t buff32;
-    file.seekg(table_offset + index * 4);
-    file.read(reinterpret_cast<char*>(&buff32), 4);
-    uint32_t offset = dataio::le2h(buff32);
+const ubyte* regfile::getChunkData(
+    int index, uint32_t& size, uint32_t& srcSize
+) const {
+    uint32_t offset = offsets[index];
     if (offset == 0) {
         return nullptr;
     }
-
-    file.seekg(offset);
-    file.read(reinterpret_cast<char*>(&buff32), 4);
+    const ubyte* bytes = file.data();
+    uint32_t buff32;
+    std::memcpy(&buff32, bytes + offset, 4);
     size = dataio::le2h(buff32);
-    file.read(reinterpret_cast<char*>(&buff32), 4);
+    std::memcpy(&buff32, bytes + offset + 4, 4);
     srcSize = dataio::le2h(buff32);
 
+    if (offset + 8 + static_cast<size_t>(size) > file.length()) {
+        return nullptr;
+    }
+    return bytes + offset + 8;
+}
+
+std::unique_ptr<ubyte[]> regfile::read(
+    int index, uint32_t& size, uint32_t& srcSize
+) const {
+    auto src = getChunkData(index, size, srcSize);
+    if (src == nullptr) {
+        return nullptr;
+    }
     auto data = std::make_unique<ubyte[]>(size);
-    file.read(reinterpret_cast<char*>(data.get()), size);
+    std::memcpy(data.get(), src, size);
     return data;
 }
 
-
 void RegionsLayer::closeRegFile(glm::ivec2 coord) {
-    openRegFiles.erase(coord);
-    regFilesCv.notify_one();
-}
-
-regfile_ptr RegionsLayer::useRegFile(glm::ivec2 coord) {
-    auto* file = openRegFiles[coord].get();
-    file->inUse = true;
-    return regfile_ptr(file, &regFilesCv);
+    std::lock_guard lock(regFilesMutex);
+    regFilesClosed++;
+    const auto& found = openRegFiles.find(coord);
+    if (found == openRegFiles.end()) {
+        return;
+    }
+    regFilesLru.erase(found->second.lruPosition);
+    openRegFiles.erase(found);
 }
 
-// Marks regfile as used and unmarks when shared_ptr dies
 regfile_ptr RegionsLayer::getRegFile(glm::ivec2 coord, bool create) {
     {
         std::lock_guard lock(regFilesMutex);
-        const auto found = openRegFiles.find(coord);
+        const auto& found = openRegFiles.find(coord);
         if (found != openRegFiles.end()) {
-            if (found->second->inUse) {
-                throw std::runtime_error("regfile is currently in use");
-            }
-            return useRegFile(found->first);
+            auto& entry = found->second;
+            regFilesLru.splice(
+                regFilesLru.begin(), regFilesLru, entry.lruPosition
+            );
+            return entry.file;
         }
     }
     if (create) {
@@ -97,36 +235,133 @@ regfile_ptr RegionsLayer::getRegFile(glm::ivec2 coord, bool create) {
     return nullptr;
 }
 
-regfile_ptr RegionsLayer::createRegFile(glm::ivec2 coord) {
-    auto file =  folder / get_region_filename(coord[0], coord[1]);
-    if (!fs::exists(file)) {
-        return nullptr;
+void RegionsLayer::beginRegFileWrite(glm::ivec2 coord) {
+    std::unique_lock lock(regFilesMutex);
+    regFilesCondition.wait(lock, [this, coord]() {
+        return openingRegFiles.find(coord) == openingRegFiles.end();
+    });
+    writingRegFiles.insert(coord);
+}
+
+void RegionsLayer::endRegFileWrite(glm::ivec2 coord) {
+    {
+        std::lock_guard lock(regFilesMutex);
+        writingRegFiles.erase(coord);
     }
-    if (openRegFiles.size() == MAX_OPEN_REGION_FILES) {
+    regFilesCondition.notify_all();
+}
+
+namespace {
+    /// @brief Region file is not opened by readers while the guard exists
+    class RegFileWriteGuard {
+        RegionsLayer& layer;
+        glm::ivec2 coord;
+    public:
+        RegFileWriteGuard(RegionsLayer& layer, glm::ivec2 coord)
+            : layer(layer), coord(coord) {
+            layer.beginRegFileWrite(coord);
+        }
+
+        ~RegFileWriteGuard() {
+            layer.endRegFileWrite(coord);
+        }
+    };
+}
+
+regfile_ptr RegionsLayer::createRegFile(glm::ivec2 coord) {
+    auto filename = folder / get_region_filename(coord[0], coord[1]);
+    uint64_t closedCount;
+    {
         std::unique_lock lock(regFilesMutex);
-        while (true) {
-            bool closed = false;
-            // FIXME: bad choosing algorithm
-            for (auto& entry : openRegFiles) {
-                if (!entry.second->inUse) {
-                    closeRegFile(entry.first);
-                    closed = true;
-                    break;
-                }
+        // offsets table of the file being written may be incomplete
+        regFilesCondition.wait(lock, [this, coord]() {
+            return writingRegFiles.find(coord) == writingRegFiles.end();
+        });
+        closedCount = regFilesClosed;
+        openingRegFiles[coord]++;
+    }
+    auto finishOpening = [this, coord]() {
+        {
+            std::lock_guard lock(regFilesMutex);
+            if (--openingRegFiles[coord] == 0) {
+                openingRegFiles.erase(coord);
             }
-            if (closed) {
-                break;
+        }
+        regFilesCondition.notify_all();
+    };
+    // opened without lock to not block other region files access.
+    // make_shared is not used to not keep the object allocated by weak refs
+    regfile_ptr file;
+    try {
+        if (fs::exists(filename)) {
+            file.reset(new regfile(filename));
+        }
+    } catch (...) {
+        finishOpening();
+        throw;
+    }
+    finishOpening();
+    if (file == nullptr) {
+        return nullptr;
+    }
+
+    std::lock_guard lock(regFilesMutex);
+    auto& handles = regFileHandles[coord];
+    handles.erase(
+        std::remove_if(
+            handles.begin(),
+            handles.end(),
+            [](const auto& handle) { return handle.expired(); }
+        ),
+        handles.end()
+    );
+    handles.push_back(file);
+    if (regFilesClosed != closedCount) {
+        // the file may be written while opening
+        return file;
+    }
+    const auto& found = openRegFiles.find(coord);
+    if (found != openRegFiles.end()) {
+        // opened by another thread
+        return found->second.file;
+    }
+    regFilesLru.push_front(coord);
+    openRegFiles[coord] = OpenRegFile {file, regFilesLru.begin()};
+
+    if (openRegFiles.size() > MAX_OPEN_REGION_FILES) {
+        // file is still available to its current users
+        openRegFiles.erase(regFilesLru.back());
+        regFilesLru.pop_back();
+    }
+    if (regFileHandles.size() > MAX_OPEN_REGION_FILES * 4) {
+        for (auto it = regFileHandles.begin(); it != regFileHandles.end();) {
+            if (std::all_of(
+                    it->second.begin(),
+                    it->second.end(),
+                    [](const auto& handle) { return handle.expired(); }
+                )) {
+                it = regFileHandles.erase(it);
+            } else {
+                ++it;
             }
-            // notified when any regfile gets out of use or closed
-            regFilesCv.wait(lock);
         }
-        openRegFiles[coord] = std::make_unique<regfile>(file);
-        return useRegFile(coord);
-    } else {
-        std::lock_guard lock(regFilesMutex);
-        openRegFiles[coord] = std::make_unique<regfile>(file);
-        return useRegFile(coord);
     }
+    return file;
+}
+
+bool RegionsLayer::hasRegFileHandles(glm::ivec2 coord) {
+    std::lock_guard lock(regFilesMutex);
+    const auto& found = regFileHandles.find(coord);
+    if (found == regFileHandles.end()) {
+        return false;
+    }
+    for (const auto& handle : found->second) {
+        if (!handle.expired()) {
+            return true;
+        }
+    }
+    regFileHandles.erase(found);
+    return false;
 }
 
 WorldRegion* RegionsLayer::getRegion(int x, int z) {
@@ -153,86 +388,360 @@ WorldRegion* RegionsLayer::getOrCreateRegion(int x, int z) {
     return region;
 }
 
-ubyte* RegionsLayer::getData(int x, int z, uint32_t& size, uint32_t& srcSize) {
+void RegionsLayer::putPending(int x, int z, PendingChunk chunk) {
+    std::lock_guard lock(pendingMutex);
+    pendingChunks[{x, z}] = std::move(chunk);
+}
+
+void RegionsLayer::compressPending() {
+    std::vector<std::pair<glm::ivec2, PendingChunk>> snapshots;
+    {
+        std::lock_guard lock(pendingMutex);
+        for (const auto& [coord, chunk] : pendingChunks) {
+            if (!chunk.compressed) {
+                snapshots.emplace_back(coord, chunk);
+            }
+        }
+    }
+    for (const auto& [coord, snapshot] : snapshots) {
+        size_t size;
+        std::shared_ptr<ubyte[]> data = compression::compress(
+            snapshot.data.get(), snapshot.srcSize, size, compression
+        );
+        std::lock_guard lock(pendingMutex);
+        const auto& found = pendingChunks.find(coord);
+        // chunk may be put again while compressing
+        if (found != pendingChunks.end() &&
+            found->second.data == snapshot.data) {
+            found->second = PendingChunk {
+                std::move(data),
+                static_cast<uint32_t>(size),
+                snapshot.srcSize,
+                true};
+        }
+    }
+}
+
+void RegionsLayer::writePending() {
+    compressPending();
+
+    std::vector<std::pair<glm::ivec2, PendingChunk>> snapshots;
+    {
+        std::lock_guard lock(pendingMutex);
+        for (const auto& [coord, chunk] : pendingChunks) {
+            // chunks put after compression will be written next time
+            if (chunk.compressed) {
+                snapshots.emplace_back(coord, chunk);
+            }
+        }
+    }
+    std::unordered_map<glm::ivec2, std::unique_ptr<WorldRegion>> regions;
+    for (const auto& [coord, snapshot] : snapshots) {
+        int regionX, regionZ, localX, localZ;
+        calc_reg_coords(coord.x, coord.y, regionX, regionZ, localX, localZ);
+        auto& region = regions[{regionX, regionZ}];
+        if (region == nullptr) {
+            region = std::make_unique<WorldRegion>();
+        }
+        std::unique_ptr<ubyte[]> data;
+        if (snapshot.data) {
+            data = std::make_unique<ubyte[]>(snapshot.size);
+            std::memcpy(data.get(), snapshot.data.get(), snapshot.size);
+        }
+        region->put(
+            localX, localZ, std::move(data), snapshot.size, snapshot.srcSize
+        );
+    }
+    for (const auto& [coord, region] : regions) {
+        writeRegion(coord.x, coord.y, region.get());
+    }
+
+    std::lock_guard lock(pendingMutex);
+    for (const auto& [coord, snapshot] : snapshots) {
+        const auto& found = pendingChunks.find(coord);
+        if (found != pendingChunks.end() &&
+            found->second.data == snapshot.data) {
+            pendingChunks.erase(found);
+        }
+    }
+}
+
+ChunkDataView RegionsLayer::getData(int x, int z) {
+    {
+        std::lock_guard lock(pendingMutex);
+        const auto& found = pendingChunks.find({x, z});
+        if (found != pendingChunks.end()) {
+            const auto& chunk = found->second;
+            ChunkDataView view {chunk.data.get(), chunk.size, chunk.srcSize};
+            view.compression =
+                chunk.compressed ? compression : compression::Method::NONE;
+            view.buffer = chunk.data;
+            return view;
+        }
+    }
     int regionX, regionZ, localX, localZ;
     calc_reg_coords(x, z, regionX, regionZ, localX, localZ);
 
-    WorldRegion* region = getOrCreateRegion(regionX, regionZ);
-    ubyte* data = region->getChunkData(localX, localZ);
-    if (data == nullptr) {
-        auto regfile = getRegFile({regionX, regionZ});
-        if (regfile != nullptr) {
-            auto dataptr = readChunkData(x, z, size, srcSize, regfile.get());
-            if (dataptr) {
-                data = dataptr.get();
-                region->put(localX, localZ, std::move(dataptr), size, srcSize);
-            }
+    if (auto region = getRegion(regionX, regionZ)) {
+        if (auto data = region->getChunkData(localX, localZ)) {
+            auto sizevec = region->getChunkDataSize(localX, localZ);
+            return ChunkDataView {data, sizevec[0], sizevec[1], compression};
         }
     }
-    if (data != nullptr) {
-        auto sizevec = region->getChunkDataSize(localX, localZ);
-        size = sizevec[0];
-        srcSize = sizevec[1];
-        return data;
+    auto regfile = getRegFile({regionX, regionZ});
+    if (regfile == nullptr) {
+        return {};
     }
-    return nullptr;
+    ChunkDataView view;
+    view.data = regfile->getChunkData(
+        localZ * REGION_SIZE + localX, view.size, view.srcSize
+    );
+    if (view.data) {
+        view.compression = regfile->compression;
+        view.file = std::move(regfile);
+    }
+    return view;
 }
 
 void RegionsLayer::writeRegion(int x, int z, WorldRegion* entry) {
-    fs::path filename = folder / get_region_filename(x, z);
+    std::lock_guard lock(writeMutex);
 
-    glm::ivec2 regcoord(x, z);
-    if (auto regfile = getRegFile(regcoord, false)) {
-        fetch_chunks(entry, x, z, regfile.get());
+    glm::ivec2 coord(x, z);
+    RegFileWriteGuard writeGuard(*this, coord);
+    // cached handle is closed to not be counted as a file user
+    closeRegFile(coord);
 
-        std::lock_guard lock(regFilesMutex);
-        regfile.reset();
-        closeRegFile(regcoord);
+    fs::path filename = getRegionFilePath(x, z);
+    std::unique_ptr<regfile> file;
+    if (fs::exists(filename)) {
+        file = std::make_unique<regfile>(filename);
     }
+    if (file && file->version >= REGION_SECTORS_VERSION &&
+        file->compression == compression) {
+        updateRegionFile(coord, entry, *file);
+    } else {
+        rewriteRegionFile(coord, entry, std::move(file));
+    }
+    // handles opened while writing may refer to the previous offsets table
+    closeRegFile(coord);
+}
 
-    char header[REGION_HEADER_SIZE] = REGION_FORMAT_MAGIC;
-    header[8] = REGION_FORMAT_VERSION;
-    header[9] = static_cast<ubyte>(compression); // FIXME
-    std::ofstream file(filename, std::ios::out | std::ios::binary);
-    file.write(header, REGION_HEADER_SIZE);
+void RegionsLayer::updateRegionFile(
+    glm::ivec2 coord, WorldRegion* entry, const regfile& file
+) {
+    SectorsAllocator allocator(file);
+    // unused sectors may be referenced by tables of files opened before
+    bool reuse = !hasRegFileHandles(coord);
+
+    uint32_t offsets[REGION_CHUNKS_COUNT];
+    std::memcpy(offsets, file.offsets, sizeof(offsets));
+
+    std::fstream output(
+        getRegionFilePath(coord.x, coord.y),
+        std::ios::in | std::ios::out | std::ios::binary
+    );
+    if (!output.is_open()) {
+        throw std::runtime_error("could not open region file for writing");
+    }
+    auto chunks = entry->getChunks();
+    auto sizes = entry->getSizes();
+    uint32_t usedSectors = 0;
+    for (size_t i = 0; i < REGION_CHUNKS_COUNT; i++) {
+        uint32_t size, srcSize;
+        bool present = file.getChunkData(i, size, srcSize) != nullptr;
+        if (!entry->isChunkUnsaved(i)) {
+            if (present) {
+                usedSectors += count_sectors(record_length(size));
+            }
+            continue;
+        }
+        if (present) {
+            // previous record stays readable until the table is updated
+            allocator.free(
+                offsets[i] / REGION_SECTOR_SIZE,
+                count_sectors(record_length(size))
+            );
+        }
+        const ubyte* data = chunks[i].get();
+        if (data == nullptr) {
+            offsets[i] = 0;
+            continue;
+        }
+        uint32_t sectors = count_sectors(record_length(sizes[i][0]));
+        offsets[i] = allocator.allocate(sectors, reuse) * REGION_SECTOR_SIZE;
+        usedSectors += sectors;
 
-    size_t offset = REGION_HEADER_SIZE;
-    uint32_t intbuf;
-    uint offsets[REGION_CHUNKS_COUNT] {};
+        output.seekp(offsets[i]);
+        write_record(output, data, sizes[i][0], sizes[i][1]);
+    }
+    // records must reach the storage before the table referring to them.
+    // Interrupted table update leaves a mix of previous and new offsets,
+    // all referring to complete records
+    output.flush();
+    if (!output || !files::sync_file(getRegionFilePath(coord.x, coord.y))) {
+        throw std::runtime_error("could not write region file");
+    }
 
-    auto region = entry->getChunks();
-    auto sizes = entry->getSizes();
+    uint32_t table[REGION_CHUNKS_COUNT];
+    for (size_t i = 0; i < REGION_CHUNKS_COUNT; i++) {
+        table[i] = dataio::h2le(offsets[i]);
+    }
+    output.seekp(REGION_TABLE_OFFSET);
+    output.write(reinterpret_cast<const char*>(table), sizeof(table));
+    output.close();
+    if (!output || !files::sync_file(getRegionFilePath(coord.x, coord.y))) {
+        throw std::runtime_error("could not write region file");
+    }
+
+    size_t freeSpace =
+        static_cast<size_t>(allocator.countFree()) * REGION_SECTOR_SIZE;
+    if (freeSpace >= REGION_COMPACTION_MIN_FREE &&
+        allocator.countFree() > usedSectors) {
+        fragmentedRegions.push_back(coord);
+    }
+}
+
+/// @brief Convert chunk data to another compression method
+/// @param sizes [in/out] compressed and source data length
+static std::unique_ptr<ubyte[]> transcode(
+    const ubyte* data,
+    glm::u32vec2& sizes,
+    compression::Method srcMethod,
+    compression::Method dstMethod
+) {
+    std::unique_ptr<ubyte[]> decompressed;
+    if (srcMethod != compression::Method::NONE) {
+        decompressed =
+            compression::decompress(data, sizes[0], sizes[1], srcMethod);
+        data = decompressed.get();
+    }
+    if (dstMethod == compression::Method::NONE) {
+        if (decompressed == nullptr) {
+            decompressed = std::make_unique<ubyte[]>(sizes[1]);
+            std::memcpy(decompressed.get(), data, sizes[1]);
+        }
+        sizes[0] = sizes[1];
+        return decompressed;
+    }
+    size_t length;
+    auto compressed = compression::compress(data, sizes[1], length, dstMethod);
+    sizes[0] = length;
+    return compressed;
+}
+
+void RegionsLayer::rewriteRegionFile(
+    glm::ivec2 coord, WorldRegion* entry, std::unique_ptr<regfile> file
+) {
+    const ubyte* sources[REGION_CHUNKS_COUNT] {};
+    glm::u32vec2 sizes[REGION_CHUNKS_COUNT] {};
+    uint32_t offsets[REGION_CHUNKS_COUNT] {};
+    // file chunks converted to the layer compression method
+    std::vector<std::unique_ptr<ubyte[]>> transcoded;
 
+    size_t offset = REGION_DATA_OFFSET;
     for (size_t i = 0; i < REGION_CHUNKS_COUNT; i++) {
-        ubyte* chunk = region[i].get();
-        if (chunk == nullptr) {
+        if (entry && entry->isChunkUnsaved(i)) {
+            sources[i] = entry->getChunks()[i].get();
+            sizes[i] = entry->getSizes()[i];
+        } else if (file) {
+            sources[i] = file->getChunkData(i, sizes[i][0], sizes[i][1]);
+            if (sources[i] && file->compression != compression) {
+                transcoded.push_back(transcode(
+                    sources[i], sizes[i], file->compression, compression
+                ));
+                sources[i] = transcoded.back().get();
+            }
+        }
+        if (sources[i] == nullptr) {
             continue;
         }
         offsets[i] = offset;
+        offset += count_sectors(record_length(sizes[i][0])) *
+                  REGION_SECTOR_SIZE;
+    }
 
-        auto sizevec = sizes[i];
-        uint32_t compressedSize = sizevec[0];
-        uint32_t srcSize = sizevec[1];
-        
-        intbuf = dataio::h2le(compressedSize);
-        file.write(reinterpret_cast<const char*>(&intbuf), 4);
-        offset += 4;
+    // region file may be still mapped by readers, so it's replaced
+    // instead of being truncated
+    fs::path filename = getRegionFilePath(coord.x, coord.y);
+    fs::path tmpFilename = filename;
+    tmpFilename += ".tmp";
 
-        intbuf = dataio::h2le(srcSize);
-        file.write(reinterpret_cast<const char*>(&intbuf), 4);
-        offset += 4;
+    char header[REGION_HEADER_SIZE] = REGION_FORMAT_MAGIC;
+    header[8] = REGION_FORMAT_VERSION;
+    header[9] = static_cast<ubyte>(compression);
+    const char padding[REGION_SECTOR_SIZE] {};
+    std::ofstream output(tmpFilename, std::ios::out | std::ios::binary);
+    output.write(header, REGION_HEADER_SIZE);
+    output.write(padding, REGION_TABLE_OFFSET - REGION_HEADER_SIZE);
 
-        file.write(reinterpret_cast<const char*>(chunk), compressedSize);
-        offset += compressedSize;
+    uint32_t table[REGION_CHUNKS_COUNT];
+    for (size_t i = 0; i < REGION_CHUNKS_COUNT; i++) {
+        table[i] = dataio::h2le(offsets[i]);
     }
+    output.write(reinterpret_cast<const char*>(table), sizeof(table));
+
+    size_t position = REGION_TABLE_OFFSET + sizeof(table);
     for (size_t i = 0; i < REGION_CHUNKS_COUNT; i++) {
-        intbuf = dataio::h2le(offsets[i]);
-        file.write(reinterpret_cast<const char*>(&intbuf), 4);
+        if (sources[i] == nullptr) {
+            continue;
+        }
+        output.write(padding, offsets[i] - position);
+        write_record(output, sources[i], sizes[i][0], sizes[i][1]);
+        position = offsets[i] + record_length(sizes[i][0]);
+    }
+    output.close();
+    if (!output || !files::sync_file(tmpFilename)) {
+        throw std::runtime_error("could not write region file");
+    }
+    // source file mapping is released, so it does not prevent replacing
+    file.reset();
+    replaceRegionFile(coord, tmpFilename);
+}
+
+void RegionsLayer::replaceRegionFile(
+    glm::ivec2 coord, const fs::path& tmpFilename
+) {
+    fs::path filename = getRegionFilePath(coord.x, coord.y);
+    // cached handle would keep the file mapped
+    closeRegFile(coord);
+    while (true) {
+        bool used = hasRegFileHandles(coord);
+        std::error_code error;
+        fs::rename(tmpFilename, filename, error);
+        if (!error) {
+            break;
+        }
+        if (!used) {
+            throw fs::filesystem_error(
+                "could not replace region file", tmpFilename, filename, error
+            );
+        }
+        // mapped file can not be replaced on Windows, so readers are
+        // waited to release their views. New handles are not opened
+        // while the file is being written
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    // handles opened before refer to the replaced file, so they
+    // do not prevent unused sectors reuse
+    std::lock_guard lock(regFilesMutex);
+    regFileHandles.erase(coord);
+}
+
+void RegionsLayer::compactRegion(int x, int z) {
+    std::lock_guard lock(writeMutex);
+
+    glm::ivec2 coord(x, z);
+    fs::path filename = getRegionFilePath(x, z);
+    if (!fs::exists(filename)) {
+        return;
     }
+    RegFileWriteGuard writeGuard(*this, coord);
+    rewriteRegionFile(coord, nullptr, std::make_unique<regfile>(filename));
+    closeRegFile(coord);
 }
 
 std::unique_ptr<ubyte[]> RegionsLayer::readChunkData(
-    int x, int z, uint32_t& size, uint32_t& srcSize, regfile* rfile
+    int x, int z, uint32_t& size, uint32_t& srcSize, const regfile* rfile
 ) {
     int regionX, regionZ, localX, localZ;
     calc_reg_coords(x, z, regionX, regionZ, localX, localZ);
@@ -225,7 +225,7 @@ void WorldConverter::convertBlocksData(int x, int z, const ContentReport& report
         BlocksMetadata newHeap;
         for (const auto& entry : *heap) {
             size_t index = entry.index;
-            const auto& def = indices.require(chunk.voxels[index].id);
+            const auto& def = indices.require(chunk.voxels.get(index).id);
             const auto& newStruct = *def.dataStruct;
             const auto& found = report.blocksDataLayouts.find(def.name);
             if (found == report.blocksDataLayouts.end()) {
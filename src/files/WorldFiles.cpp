@@ -75,32 +75,64 @@ fs::path WorldFiles::getPacksFile() const {
     return directory / fs::path("packs.list");
 }
 
+static std::string create_packs_list(const std::vector<ContentPack>& packs) {
+    std::stringstream ss;
+    ss << "# autogenerated; do not modify\n";
+    for (const auto& pack : packs) {
+        ss << pack.id << "\n";
+    }
+    return ss.str();
+}
+
+static void write_world_files(
+    const std::vector<std::pair<fs::path, dv::value>>& jsonFiles,
+    const fs::path& packsFile,
+    const std::string& packsList
+) {
+    if (!packsList.empty() && !files::write_string_atomic(packsFile, packsList)) {
+        logger.error() << "could not write " << packsFile.u8string();
+    }
+    for (const auto& [file, value] : jsonFiles) {
+        if (!files::write_json_atomic(file, value)) {
+            logger.error() << "could not write " << file.u8string();
+        }
+    }
+}
+
 void WorldFiles::write(
-    const World* world, const Content* content
+    const World* world,
+    const Content* content,
+    std::vector<std::pair<fs::path, dv::value>> files
 ) {
+    std::string packsList;
     if (world) {
-        writeWorldInfo(world->getInfo());
+        files.emplace_back(getWorldFile(), world->getInfo().serialize());
         if (!fs::exists(getPacksFile())) {
-            writePacks(world->getPacks());
+            packsList = create_packs_list(world->getPacks());
         }
     }
     if (generatorTestMode) {
+        write_world_files(files, getPacksFile(), packsList);
         return;
     }
     if (content) {
-        writeIndices(content->getIndices());
+        files.emplace_back(
+            getIndicesFile(), createIndices(content->getIndices())
+        );
     }
-    regions.writeAll();
+    // world files are written after the regions, so they never describe
+    // region data which is not written yet
+    regions.writeAll([
+        files = std::move(files),
+        packsFile = getPacksFile(),
+        packsList = std::move(packsList)
+    ]() {
+        write_world_files(files, packsFile, packsList);
+    });
 }
 
 void WorldFiles::writePacks(const std::vector<ContentPack>& packs) {
-    auto packsFile = getPacksFile();
-    std::stringstream ss;
-    ss << "# autogenerated; do not modify\n";
-    for (const auto& pack : packs) {
-        ss << pack.id << "\n";
-    }
-    files::write_string(packsFile, ss.str());
+    files::write_string_atomic(getPacksFile(), create_packs_list(packs));
 }
 
 template <class T>
@@ -132,18 +164,13 @@ void WorldFiles::createBlockFieldsIndices(
     }
 }
 
-void WorldFiles::writeIndices(const ContentIndices* indices) {
+dv::value WorldFiles::createIndices(const ContentIndices* indices) {
     dv::value root = dv::object();
     root["region-version"] = REGION_FORMAT_VERSION;
 
     createContentIndicesCache(indices, root);
     createBlockFieldsIndices(indices, root);
-    
-    files::write_json(getIndicesFile(), root);
-}
-
-void WorldFiles::writeWorldInfo(const WorldInfo& info) {
-    files::write_json(getWorldFile(), info.serialize());
+    return root;
 }
 
 std::optional<WorldInfo> WorldFiles::readWorldInfo() {
@@ -5,6 +5,7 @@
 #include <optional>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "content/ContentPack.hpp"
@@ -36,8 +37,7 @@ class WorldFiles {
     fs::path getWorldFile() const;
     fs::path getPacksFile() const;
 
-    void writeWorldInfo(const WorldInfo& info);
-    void writeIndices(const ContentIndices* indices);
+    static dv::value createIndices(const ContentIndices* indices);
 public:
     WorldFiles(const fs::path& directory);
     WorldFiles(const fs::path& directory, const DebugSettings& settings);
@@ -63,7 +63,13 @@ public:
     /// @brief Write all unsaved data to world files
     /// @param world target world
     /// @param content world content
-    void write(const World* world, const Content* content);
+    /// @param files other JSON files written with world info after
+    /// the regions
+    void write(
+        const World* world,
+        const Content* content,
+        std::vector<std::pair<fs::path, dv::value>> files = {}
+    );
 
     void writePacks(const std::vector<ContentPack>& packs);
 
@@ -1,8 +1,10 @@
 #include "WorldRegions.hpp"
 
 #include <cstring>
+#include <optional>
 #include <utility>
 #include <vector>
+#include <zlib.h>
 
 #include "debug/Logger.hpp"
 #include "coders/json.hpp"
@@ -17,6 +19,12 @@
 
 static debug::Logger logger("world-regions");
 
+/// @brief Lights record is encoded lightmap followed by hashes of voxels
+/// data and content the lights were built from
+static constexpr size_t LIGHTS_RECORD_HASHES_OFFSET =
+    LIGHTMAP_DATA_LEN + LIGHTMAP_HEIGHTS_LEN;
+static constexpr size_t LIGHTS_RECORD_LEN = LIGHTS_RECORD_HASHES_OFFSET + 8;
+
 WorldRegion::WorldRegion()
     : chunksData(
           std::make_unique<std::unique_ptr<ubyte[]>[]>(REGION_CHUNKS_COUNT)
@@ -28,11 +36,18 @@ WorldRegion::~WorldRegion() = default;
 
 void WorldRegion::setUnsaved(bool unsaved) {
     this->unsaved = unsaved;
+    if (!unsaved) {
+        unsavedChunks.reset();
+    }
 }
 bool WorldRegion::isUnsaved() const {
     return unsaved;
 }
 
+bool WorldRegion::isChunkUnsaved(uint index) const {
+    return unsavedChunks[index];
+}
+
 std::unique_ptr<ubyte[]>* WorldRegion::getChunks() const {
     return chunksData.get();
 }
@@ -47,6 +62,7 @@ void WorldRegion::put(
     size_t chunk_index = z * REGION_SIZE + x;
     chunksData[chunk_index] = std::move(data);
     sizes[chunk_index] = glm::u32vec2(size, srcSize);
+    unsavedChunks[chunk_index] = true;
 }
 
 ubyte* WorldRegion::getChunkData(uint x, uint z) {
@@ -63,21 +79,148 @@ WorldRegions::WorldRegions(const fs::path& directory) : directory(directory) {
     }
     auto& voxels = layers[REGION_LAYER_VOXELS];
     voxels.folder = directory / fs::path("regions");
-    voxels.compression = compression::Method::EXTRLE16;
+    voxels.compression = compression::Method::EXTRLE16_LZ;
 
     auto& lights = layers[REGION_LAYER_LIGHTS];
     lights.folder = directory / fs::path("lights");
-    lights.compression = compression::Method::EXTRLE8;
+    lights.compression = compression::Method::LZ;
+
+    auto& inventories = layers[REGION_LAYER_INVENTORIES];
+    inventories.folder = directory / fs::path("inventories");
+    inventories.compression = compression::Method::LZ_BJSON;
 
-    layers[REGION_LAYER_INVENTORIES].folder =
-        directory / fs::path("inventories");
-    layers[REGION_LAYER_ENTITIES].folder = directory / fs::path("entities");
+    auto& entities = layers[REGION_LAYER_ENTITIES];
+    entities.folder = directory / fs::path("entities");
+    entities.compression = compression::Method::LZ_BJSON;
 
     auto& blocksData = layers[REGION_LAYER_BLOCKS_DATA];
     blocksData.folder = directory / fs::path("blocksdata");
+    blocksData.compression = compression::Method::LZ;
+}
+
+WorldRegions::~WorldRegions() {
+    {
+        std::lock_guard lock(ioMutex);
+        if (asyncWrites) {
+            // pending chunks are written before the thread stops
+            writesRequested++;
+            startIoThread();
+        }
+        ioStopped = true;
+    }
+    ioCondition.notify_all();
+    if (ioThread.joinable()) {
+        ioThread.join();
+    }
+}
+
+void WorldRegions::startIoThread() {
+    if (!ioThread.joinable()) {
+        ioThread = std::thread(&WorldRegions::ioLoop, this);
+    }
+}
+
+void WorldRegions::queueCompaction() {
+    for (auto& layer : layers) {
+        std::lock_guard lock(layer.writeMutex);
+        for (const auto& coord : layer.fragmentedRegions) {
+            compactionQueue.emplace(layer.layer, coord);
+        }
+        layer.fragmentedRegions.clear();
+    }
+}
+
+void WorldRegions::ioLoop() {
+    while (true) {
+        bool compress;
+        uint64_t writeId;
+        std::optional<std::pair<RegionLayerIndex, glm::ivec2>> compaction;
+        {
+            std::unique_lock lock(ioMutex);
+            ioCondition.wait(lock, [this]() {
+                return ioStopped || compressRequested ||
+                       writesDone < writesRequested ||
+                       !compactionQueue.empty();
+            });
+            writeId = writesRequested;
+            // remaining files will be compacted after the next write
+            if (ioStopped && writesDone == writeId) {
+                return;
+            }
+            compress = compressRequested;
+            compressRequested = false;
+            if (writesDone == writeId && !compress &&
+                !compactionQueue.empty()) {
+                compaction = compactionQueue.front();
+                compactionQueue.pop();
+            }
+        }
+        if (writesDone < writeId) {
+            bool written = true;
+            try {
+                writePending();
+            } catch (const std::exception& err) {
+                logger.error() << "could not write regions: " << err.what();
+                written = false;
+            }
+            std::vector<std::function<void()>> callbacks;
+            // callbacks stay queued until regions are written successfully
+            if (written) {
+                std::lock_guard lock(ioMutex);
+                auto it = writtenCallbacks.begin();
+                while (it != writtenCallbacks.end() && it->first <= writeId) {
+                    callbacks.push_back(std::move(it->second));
+                    ++it;
+                }
+                writtenCallbacks.erase(writtenCallbacks.begin(), it);
+            }
+            for (const auto& callback : callbacks) {
+                try {
+                    callback();
+                } catch (const std::exception& err) {
+                    logger.error() << "could not write world files: "
+                                   << err.what();
+                }
+            }
+            std::lock_guard lock(ioMutex);
+            writesDone = writeId;
+            queueCompaction();
+            writtenCondition.notify_all();
+            continue;
+        }
+        if (compress) {
+            for (auto& layer : layers) {
+                layer.compressPending();
+            }
+        }
+        if (compaction) {
+            auto [layerid, coord] = *compaction;
+            try {
+                layers[layerid].compactRegion(coord.x, coord.y);
+            } catch (const std::exception& err) {
+                logger.error()
+                    << "could not compact region file "
+                    << getRegionFilePath(layerid, coord.x, coord.y).u8string()
+                    << ": " << err.what();
+            }
+        }
+    }
+}
+
+void WorldRegions::writePending() {
+    for (auto& layer : layers) {
+        fs::create_directories(layer.folder);
+        layer.writePending();
+    }
 }
 
-WorldRegions::~WorldRegions() = default;
+void WorldRegions::waitForWrites() {
+    std::unique_lock lock(ioMutex);
+    uint64_t writeId = writesRequested;
+    writtenCondition.wait(lock, [this, writeId]() {
+        return writesDone >= writeId;
+    });
+}
 
 void RegionsLayer::writeAll() {
     for (auto& it : regions) {
@@ -87,6 +230,19 @@ void RegionsLayer::writeAll() {
         }
         const auto& key = it.first;
         writeRegion(key[0], key[1], region);
+        region->setUnsaved(false);
+    }
+}
+
+void RegionsLayer::releaseSaved() {
+    std::lock_guard lock(mapMutex);
+    auto it = regions.begin();
+    while (it != regions.end()) {
+        if (it->second->isUnsaved()) {
+            ++it;
+        } else {
+            it = regions.erase(it);
+        }
     }
 }
 
@@ -102,6 +258,30 @@ void WorldRegions::put(
     int regionX, regionZ, localX, localZ;
     calc_reg_coords(x, z, regionX, regionZ, localX, localZ);
 
+    if (asyncWrites) {
+        // compressed by I/O thread
+        bool compressed = layer.compression == compression::Method::NONE ||
+                          data == nullptr;
+        layer.putPending(
+            x,
+            z,
+            PendingChunk {
+                std::move(data),
+                static_cast<uint32_t>(size),
+                static_cast<uint32_t>(srcSize),
+                compressed}
+        );
+        if (!compressed) {
+            {
+                std::lock_guard lock(ioMutex);
+                compressRequested = true;
+                startIoThread();
+            }
+            ioCondition.notify_one();
+        }
+        return;
+    }
+
     WorldRegion* region = layer.getOrCreateRegion(regionX, regionZ);
     region->setUnsaved(true);
     
@@ -125,7 +305,8 @@ static std::unique_ptr<ubyte[]> write_inventories(
     for (auto& entry : inventories) {
         builder.putInt32(entry.first);
         auto map = entry.second->serialize();
-        auto bytes = json::to_binary(map, true);
+        // compressed by the layer
+        auto bytes = json::to_binary(map);
         builder.putInt32(bytes.size());
         builder.put(bytes.data(), bytes.size());
     }
@@ -168,19 +349,30 @@ void WorldRegions::put(Chunk* chunk, std::vector<ubyte> entitiesData) {
     int regionX, regionZ, localX, localZ;
     calc_reg_coords(chunk->x, chunk->z, regionX, regionZ, localX, localZ);
 
-    put(chunk->x,
-        chunk->z,
-        REGION_LAYER_VOXELS,
-        chunk->encode(),
-        CHUNK_DATA_LEN);
+    // voxels of a chunk loaded and not modified are already stored
+    if (chunk->flags.unsaved) {
+        auto data = chunk->encode();
+        chunk->voxelsHash = hashVoxels(data.get());
+        put(chunk->x,
+            chunk->z,
+            REGION_LAYER_VOXELS,
+            std::move(data),
+            CHUNK_DATA_LEN);
+    }
 
     // Writing lights cache
     if (doWriteLights && chunk->flags.lighted) {
+        auto data = std::make_unique<ubyte[]>(LIGHTS_RECORD_LEN);
+        auto lights = chunk->lightmap.encode();
+        std::memcpy(data.get(), lights.get(), LIGHTS_RECORD_HASHES_OFFSET);
+        ubyte* hashes = data.get() + LIGHTS_RECORD_HASHES_OFFSET;
+        dataio::write_int32_big(chunk->voxelsHash, hashes, 0);
+        dataio::write_int32_big(lightsContentHash, hashes, 4);
         put(chunk->x,
             chunk->z,
             REGION_LAYER_LIGHTS,
-            chunk->lightmap.encode(),
-            LIGHTMAP_DATA_LEN);
+            std::move(data),
+            LIGHTS_RECORD_LEN);
     }
     // Writing block inventories
     if (!chunk->inventories.empty()) {
@@ -215,52 +407,88 @@ void WorldRegions::put(Chunk* chunk, std::vector<ubyte> entitiesData) {
     }
 }
 
+/// @brief Get decompressed copy of chunk data
+static std::unique_ptr<ubyte[]> decompress_view(const ChunkDataView& view) {
+    if (view.compression != compression::Method::NONE) {
+        return compression::decompress(
+            view.data, view.size, view.srcSize, view.compression
+        );
+    }
+    auto data = std::make_unique<ubyte[]>(view.size);
+    std::memcpy(data.get(), view.data, view.size);
+    return data;
+}
+
+/// @brief Decompress chunk data read from region file
+/// @param srcSize [in/out] source data length
+static std::unique_ptr<ubyte[]> decompress_chunk(
+    std::unique_ptr<ubyte[]> data,
+    uint32_t length,
+    uint32_t& srcSize,
+    compression::Method method
+) {
+    if (method == compression::Method::NONE) {
+        srcSize = length;
+        return data;
+    }
+    return compression::decompress(data.get(), length, srcSize, method);
+}
+
 std::unique_ptr<ubyte[]> WorldRegions::getVoxels(int x, int z) {
-    uint32_t size;
-    uint32_t srcSize;
     auto& layer = layers[REGION_LAYER_VOXELS];
-    auto* data = layer.getData(x, z, size, srcSize);
-    if (data == nullptr) {
+    auto view = layer.getData(x, z);
+    if (!view) {
         return nullptr;
     }
-    assert(srcSize == CHUNK_DATA_LEN);
-    return compression::decompress(data, size, srcSize, layer.compression);
+    assert(view.srcSize == CHUNK_DATA_LEN);
+    return decompress_view(view);
 }
 
-std::unique_ptr<light_t[]> WorldRegions::getLights(int x, int z) {
-    uint32_t size;
-    uint32_t srcSize;
+bool WorldRegions::getLights(
+    int x, int z, Lightmap& lightmap, uint32_t voxelsHash
+) {
     auto& layer = layers[REGION_LAYER_LIGHTS];
-    auto* bytes = layer.getData(x, z, size, srcSize);
-    if (bytes == nullptr) {
-        return nullptr;
+    auto view = layer.getData(x, z);
+    if (!view) {
+        return false;
+    }
+    // lights cached before hashes were added can not be validated
+    if (view.srcSize != LIGHTS_RECORD_LEN) {
+        return false;
+    }
+    auto data = decompress_view(view);
+    const ubyte* hashes = data.get() + LIGHTS_RECORD_HASHES_OFFSET;
+    if (static_cast<uint32_t>(dataio::read_int32_big(hashes, 0)) != voxelsHash ||
+        static_cast<uint32_t>(dataio::read_int32_big(hashes, 4)) !=
+            lightsContentHash) {
+        return false;
     }
-    auto data = compression::decompress(
-        bytes, size, srcSize, layer.compression
-    );
-    assert(srcSize == LIGHTMAP_DATA_LEN);
-    return Lightmap::decode(data.get());
+    lightmap.set(Lightmap::decode(data.get()).get());
+    lightmap.decodeHeights(data.get() + LIGHTMAP_DATA_LEN);
+    return true;
+}
+
+uint32_t WorldRegions::hashVoxels(const ubyte* data) {
+    return crc32(crc32(0L, Z_NULL, 0), data, CHUNK_DATA_LEN);
 }
 
 ChunkInventoriesMap WorldRegions::fetchInventories(int x, int z) {
-    uint32_t bytesSize;
-    uint32_t srcSize;
-    auto bytes = layers[REGION_LAYER_INVENTORIES].getData(x, z, bytesSize, srcSize);
-    if (bytes == nullptr) {
+    auto view = layers[REGION_LAYER_INVENTORIES].getData(x, z);
+    if (!view) {
         return {};
     }
-    return load_inventories(bytes, bytesSize);
+    auto data = decompress_view(view);
+    return load_inventories(data.get(), view.srcSize);
 }
 
 BlocksMetadata WorldRegions::getBlocksData(int x, int z) {
-    uint32_t bytesSize;
-    uint32_t srcSize;
-    auto bytes = layers[REGION_LAYER_BLOCKS_DATA].getData(x, z, bytesSize, srcSize);
-    if (bytes == nullptr) {
+    auto view = layers[REGION_LAYER_BLOCKS_DATA].getData(x, z);
+    if (!view) {
         return {};
     }
+    auto data = decompress_view(view);
     BlocksMetadata heap;
-    heap.deserialize(bytes, bytesSize);
+    heap.deserialize(data.get(), view.srcSize);
     return heap;
 }
 
@@ -305,6 +533,10 @@ void WorldRegions::processBlocksData(int x, int z, const BlockDataProc& func) {
             if (datData == nullptr) {
                 continue;
             }
+            datData = decompress_chunk(
+                std::move(datData), datLength, datSrcSize,
+                datRegfile->compression
+            );
             uint32_t voxLength;
             uint32_t voxSrcSize;
             auto voxData = RegionsLayer::readChunkData(
@@ -316,12 +548,13 @@ void WorldRegions::processBlocksData(int x, int z, const BlockDataProc& func) {
                 put(gx, gz, REGION_LAYER_BLOCKS_DATA, nullptr, 0);
                 continue;
             }
-            voxData = compression::decompress(
-                voxData.get(), voxLength, voxSrcSize, voxLayer.compression
+            voxData = decompress_chunk(
+                std::move(voxData), voxLength, voxSrcSize,
+                voxRegfile->compression
             );
 
             BlocksMetadata blocksData;
-            blocksData.deserialize(datData.get(), datLength);
+            blocksData.deserialize(datData.get(), datSrcSize);
             try {
                 func(&blocksData, std::move(voxData));
             } catch (const std::exception& err) {
@@ -339,13 +572,12 @@ dv::value WorldRegions::fetchEntities(int x, int z) {
     if (generatorTestMode) {
         return nullptr;
     }
-    uint32_t bytesSize;
-    uint32_t srcSize;
-    const ubyte* data = layers[REGION_LAYER_ENTITIES].getData(x, z, bytesSize, srcSize);
-    if (data == nullptr) {
+    auto view = layers[REGION_LAYER_ENTITIES].getData(x, z);
+    if (!view) {
         return nullptr;
     }
-    auto map = json::from_binary(data, bytesSize);
+    auto data = decompress_view(view);
+    auto map = json::from_binary(data.get(), view.srcSize);
     if (map.empty()) {
         return nullptr;
     }
@@ -374,13 +606,9 @@ void WorldRegions::processRegion(
             if (data == nullptr) {
                 continue;
             }
-            if (layer.compression != compression::Method::NONE) {
-                data = compression::decompress(
-                    data.get(), length, srcSize, layer.compression
-                );
-            } else {
-                srcSize = length;
-            }
+            data = decompress_chunk(
+                std::move(data), length, srcSize, regfile->compression
+            );
             if (auto writeData = func(std::move(data), &srcSize)) {
                 put(gx, gz, layerid, std::move(writeData), srcSize);
             }
@@ -396,18 +624,49 @@ fs::path WorldRegions::getRegionFilePath(RegionLayerIndex layerid, int x, int z)
     return layers[layerid].getRegionFilePath(x, z);
 }
 
-void WorldRegions::writeAll() {
+void WorldRegions::writeAll(std::function<void()> onWritten) {
+    if (asyncWrites) {
+        {
+            std::lock_guard lock(ioMutex);
+            writesRequested++;
+            if (onWritten) {
+                writtenCallbacks.emplace_back(
+                    writesRequested, std::move(onWritten)
+                );
+            }
+            startIoThread();
+        }
+        ioCondition.notify_one();
+        return;
+    }
     for (auto& layer : layers) {
         fs::create_directories(layer.folder);
         layer.writeAll();
     }
+    if (onWritten) {
+        onWritten();
+    }
+    {
+        std::lock_guard lock(ioMutex);
+        queueCompaction();
+        if (compactionQueue.empty()) {
+            return;
+        }
+        startIoThread();
+    }
+    ioCondition.notify_one();
+}
+
+void WorldRegions::releaseSaved() {
+    for (auto& layer : layers) {
+        layer.releaseSaved();
+    }
 }
 
 void WorldRegions::deleteRegion(RegionLayerIndex layerid, int x, int z) {
     auto& layer = layers[layerid];
-    if (layer.getRegFile({x, z}, false)) {
-        throw std::runtime_error("region file is currently in use");
-    }
+    std::lock_guard lock(layer.writeMutex);
+    layer.closeRegFile({x, z});
     auto file = layer.getRegionFilePath(x, z);
     if (fs::exists(file)) {
         logger.info() << "remove region file " << file.u8string();
@@ -1,12 +1,19 @@
 #pragma once
 
+#include <bitset>
 #include <condition_variable>
 #include <filesystem>
 #include <functional>
 #include <glm/glm.hpp>
+#include <list>
 #include <memory>
 #include <mutex>
+#include <queue>
+#include <thread>
 #include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include "typedefs.hpp"
 #include "util/BufferPool.hpp"
@@ -27,6 +34,21 @@ inline constexpr uint REGION_SIZE_BIT = 5;
 inline constexpr uint REGION_SIZE = (1 << (REGION_SIZE_BIT));
 inline constexpr uint REGION_CHUNKS_COUNT = ((REGION_SIZE) * (REGION_SIZE));
 
+/// @brief First region format version storing chunks in sectors with
+/// the offsets table placed after header
+inline constexpr int REGION_SECTORS_VERSION = 4;
+/// @brief Region file sector size (chunks data allocation unit)
+inline constexpr uint REGION_SECTOR_SIZE = 512;
+/// @brief Offsets table position. Table is sector-aligned, so its entries
+/// never cross sectors and are not torn by an interrupted table update
+inline constexpr uint REGION_TABLE_OFFSET = REGION_SECTOR_SIZE;
+/// @brief Offset of the first sector available for chunks data
+inline constexpr uint REGION_DATA_OFFSET =
+    (REGION_TABLE_OFFSET + REGION_CHUNKS_COUNT * 4 + REGION_SECTOR_SIZE - 1) /
+    REGION_SECTOR_SIZE * REGION_SECTOR_SIZE;
+/// @brief Min unused space in region file to be compacted
+inline constexpr size_t REGION_COMPACTION_MIN_FREE = 64 * 1024;
+
 class illegal_region_format : public std::runtime_error {
 public:
     illegal_region_format(const std::string& message)
@@ -37,6 +59,8 @@ public:
 class WorldRegion {
     std::unique_ptr<std::unique_ptr<ubyte[]>[]> chunksData;
     std::unique_ptr<glm::u32vec2[]> sizes;
+    /// @brief Chunks changed since the region was written
+    std::bitset<REGION_CHUNKS_COUNT> unsavedChunks;
     bool unsaved = false;
 public:
     WorldRegion();
@@ -46,22 +70,53 @@ public:
     ubyte* getChunkData(uint x, uint z);
     glm::u32vec2 getChunkDataSize(uint x, uint z);
 
+    /// @brief Set region unsaved flag. Chunks unsaved flags are reset
+    /// when the region is marked as saved
     void setUnsaved(bool unsaved);
     bool isUnsaved() const;
 
+    /// @brief Check if chunk data was put since the region was written.
+    /// Unsaved chunk with no data is removed from region file
+    bool isChunkUnsaved(uint index) const;
+
     std::unique_ptr<ubyte[]>* getChunks() const;
     glm::u32vec2* getSizes() const;
 };
 
+/// @brief Memory-mapped region file.
+/// Offsets table is parsed once when opening, so chunks data is accessed
+/// without any syscalls and may be read by multiple threads concurrently.
+///
+/// Since format version 4 chunk records are aligned to sectors and written
+/// in place: updated chunks are stored in unused sectors or appended,
+/// then the offsets table is rewritten. Records referenced by the table
+/// are never overwritten, so the file remains consistent for open mappings
 struct regfile {
-    files::rafile file;
+    files::mmfile file;
     int version;
-    bool inUse = false;
+    /// @brief Chunks data compression method
+    compression::Method compression;
+    /// @brief Chunks data offsets (0 if chunk is not present)
+    uint32_t offsets[REGION_CHUNKS_COUNT] {};
 
     regfile(fs::path filename);
     regfile(const regfile&) = delete;
 
-    std::unique_ptr<ubyte[]> read(int index, uint32_t& size, uint32_t& srcSize);
+    /// @brief Get chunk data stored in the file without copying
+    /// @param index chunk index in region
+    /// @param size [out] compressed chunk data length
+    /// @param srcSize [out] source chunk data length
+    /// @return pointer to the mapped data valid while the file is open
+    /// or nullptr if chunk is not present in the file
+    const ubyte* getChunkData(
+        int index, uint32_t& size, uint32_t& srcSize
+    ) const;
+
+    /// @brief Read copy of chunk data
+    /// @return nullptr if chunk is not present in the file
+    std::unique_ptr<ubyte[]> read(
+        int index, uint32_t& size, uint32_t& srcSize
+    ) const;
 };
 
 using RegionsMap = std::unordered_map<glm::ivec2, std::unique_ptr<WorldRegion>>;
@@ -69,41 +124,26 @@ using RegionProc = std::function<std::unique_ptr<ubyte[]>(std::unique_ptr<ubyte[
 using InventoryProc = std::function<void(Inventory*)>;
 using BlockDataProc = std::function<void(BlocksMetadata*, std::unique_ptr<ubyte[]>)>;
 
-/// @brief Region file pointer keeping inUse flag on until destroyed
-class regfile_ptr {
-    regfile* file;
-    std::condition_variable* cv;
-public:
-    regfile_ptr(regfile* file, std::condition_variable* cv)
-        : file(file), cv(cv) {
-    }
-
-    regfile_ptr(const regfile_ptr&) = delete;
-
-    regfile_ptr(std::nullptr_t) : file(nullptr), cv(nullptr) {
-    }
+/// @brief Shared region file handle. File stays mapped until all handles
+/// are released, even if it was closed by the layer
+using regfile_ptr = std::shared_ptr<const regfile>;
+
+/// @brief Read-only chunk data referring to in-memory region, pending
+/// chunk snapshot or directly to the mapped region file, which is kept open
+/// while the view exists
+struct ChunkDataView {
+    const ubyte* data = nullptr;
+    /// @brief Compressed data length
+    uint32_t size = 0;
+    /// @brief Source data length
+    uint32_t srcSize = 0;
+    /// @brief Data compression method
+    compression::Method compression = compression::Method::NONE;
+    regfile_ptr file = nullptr;
+    std::shared_ptr<const ubyte[]> buffer = nullptr;
 
-    bool operator==(std::nullptr_t) const {
-        return file == nullptr;
-    }
-    bool operator!=(std::nullptr_t) const {
-        return file != nullptr;
-    }
     operator bool() const {
-        return file != nullptr;
-    }
-    ~regfile_ptr() {
-        reset();
-    }
-    regfile* get() {
-        return file;
-    }
-    void reset() {
-        if (file) {
-            file->inUse = false;
-            cv->notify_one();
-            file = nullptr;
-        }
+        return data != nullptr;
     }
 };
 
@@ -116,6 +156,16 @@ inline void calc_reg_coords(
     localZ = z - (regionZ * REGION_SIZE);
 }
 
+/// @brief Chunk data snapshot waiting to be written by I/O thread
+struct PendingChunk {
+    /// @brief Chunk data (nullptr if chunk is removed)
+    std::shared_ptr<ubyte[]> data;
+    uint32_t size;
+    uint32_t srcSize;
+    /// @brief Data is compressed with the layer compression method
+    bool compressed;
+};
+
 struct RegionsLayer {
     /// @brief Layer index
     RegionLayerIndex layer;
@@ -131,16 +181,35 @@ struct RegionsLayer {
     /// @brief In-memory regions map mutex
     std::mutex mapMutex;
 
-    /// @brief Open region files map
-    std::unordered_map<glm::ivec2, std::unique_ptr<regfile>> openRegFiles;
+    /// @brief Chunks put in asynchronous writes mode and not written yet.
+    /// Checked before in-memory regions and region files
+    std::unordered_map<glm::ivec2, PendingChunk> pendingChunks;
+
+    /// @brief Pending chunks mutex
+    std::mutex pendingMutex;
+
+    struct OpenRegFile {
+        regfile_ptr file;
+        /// @brief Position in regFilesLru list
+        std::list<glm::ivec2>::iterator lruPosition;
+    };
 
-    /// @brief Open region files map mutex
+    /// @brief Open region files cache (MAX_OPEN_REGION_FILES max)
+    std::unordered_map<glm::ivec2, OpenRegFile> openRegFiles;
+
+    /// @brief Open region files coords from the most recently used
+    std::list<glm::ivec2> regFilesLru;
+
+    /// @brief Open region files cache mutex
     std::mutex regFilesMutex;
-    std::condition_variable regFilesCv;
 
+    /// @brief Get shared region file handle
+    /// @param create open file if it is not in cache
+    /// @return nullptr if region file does not exist or is not open
     [[nodiscard]] regfile_ptr getRegFile(glm::ivec2 coord, bool create = true);
-    [[nodiscard]] regfile_ptr useRegFile(glm::ivec2 coord);
     regfile_ptr createRegFile(glm::ivec2 coord);
+    /// @brief Remove region file from cache. The file is unmapped when
+    /// the last handle is released
     void closeRegFile(glm::ivec2 coord);
 
     WorldRegion* getRegion(int x, int z);
@@ -148,22 +217,97 @@ struct RegionsLayer {
 
     fs::path getRegionFilePath(int x, int z) const;
 
-    /// @brief Get chunk data. Read from file if not loaded yet.
+    /// @brief Replace pending chunk snapshot
     /// @param x chunk x coord
     /// @param z chunk z coord
-    /// @param size [out] compressed chunk data length
-    /// @param size [out] source chunk data length
-    /// @return nullptr if no saved chunk data found
-    [[nodiscard]] ubyte* getData(int x, int z, uint32_t& size, uint32_t& srcSize);
+    void putPending(int x, int z, PendingChunk chunk);
+
+    /// @brief Compress pending chunks snapshots
+    void compressPending();
+
+    /// @brief Write pending chunks to region files.
+    /// Chunks put while writing are kept pending
+    void writePending();
+
+    /// @brief Get chunk data from memory or from region file without copying
+    /// @param x chunk x coord
+    /// @param z chunk z coord
+    /// @return empty view if no saved chunk data found
+    [[nodiscard]] ChunkDataView getData(int x, int z);
+
+    /// @brief Region files writing mutex, locked while region file is
+    /// being written or compacted
+    std::mutex writeMutex;
+
+    /// @brief Regions with region files having too much unused space
+    /// since the last write (guarded by writeMutex)
+    std::vector<glm::ivec2> fragmentedRegions;
+
+    /// @brief Weak references to all open region file handles, used to
+    /// check if unused sectors may still be read (guarded by regFilesMutex)
+    std::unordered_map<glm::ivec2, std::vector<std::weak_ptr<const regfile>>>
+        regFileHandles;
+
+    /// @brief Number of closeRegFile calls. Region files opened while
+    /// closing are not cached (guarded by regFilesMutex)
+    uint64_t regFilesClosed = 0;
+
+    /// @brief Region files being written. Their offsets tables may be
+    /// incomplete, so they are not opened until written
+    /// (guarded by regFilesMutex)
+    std::unordered_set<glm::ivec2> writingRegFiles;
 
-    /// @brief Write or rewrite region file
+    /// @brief Number of region files handles being opened by coords.
+    /// Region file is not written while opening (guarded by regFilesMutex)
+    std::unordered_map<glm::ivec2, int> openingRegFiles;
+
+    /// @brief Notified when region file writing or opening is finished
+    std::condition_variable regFilesCondition;
+
+    /// @brief Wait for the region file handles being opened and prevent
+    /// opening new ones until endRegFileWrite
+    void beginRegFileWrite(glm::ivec2 coord);
+    void endRegFileWrite(glm::ivec2 coord);
+
+    /// @brief Check if region file may be read by handles opened before.
+    /// Open files cache is not checked
+    bool hasRegFileHandles(glm::ivec2 coord);
+
+    /// @brief Write unsaved region chunks. Region file of an older format
+    /// is fully rewritten
     /// @param x region X
     /// @param z region Z
     void writeRegion(int x, int y, WorldRegion* entry);
 
+    /// @brief Write unsaved chunks into existing region file sectors
+    void updateRegionFile(
+        glm::ivec2 coord, WorldRegion* entry, const regfile& file
+    );
+
+    /// @brief Write new region file replacing the existing one.
+    /// Chunks missing in memory are copied from the source file
+    /// @param entry in-memory region (nullable)
+    /// @param file source region file (nullable), closed before replacing
+    void rewriteRegionFile(
+        glm::ivec2 coord,
+        WorldRegion* entry,
+        std::unique_ptr<regfile> file
+    );
+
+    /// @brief Replace region file with the written temporary file
+    void replaceRegionFile(glm::ivec2 coord, const fs::path& tmpFilename);
+
+    /// @brief Rewrite region file excluding unused sectors
+    /// @param x region X
+    /// @param z region Z
+    void compactRegion(int x, int z);
+
     /// @brief Write all unsaved regions to files
     void writeAll();
 
+    /// @brief Remove regions having no unsaved data from memory
+    void releaseSaved();
+
     /// @brief Read chunk data from region file
     /// @param x chunk x coord
     /// @param z chunk z coord
@@ -172,7 +316,7 @@ struct RegionsLayer {
     /// @param rfile region file
     /// @return nullptr if chunk is not present in region file
     [[nodiscard]] static std::unique_ptr<ubyte[]> readChunkData(
-        int x, int z, uint32_t& size, uint32_t& srcSize, regfile* rfile
+        int x, int z, uint32_t& size, uint32_t& srcSize, const regfile* rfile
     );
 };
 
@@ -181,9 +325,41 @@ class WorldRegions {
     fs::path directory;
 
     RegionsLayer layers[REGION_LAYERS_COUNT] {};
+
+    /// @brief Background regions I/O thread compressing and writing
+    /// pending chunks and compacting region files (started on demand)
+    std::thread ioThread;
+    std::mutex ioMutex;
+    std::condition_variable ioCondition;
+    /// @brief Notified when requested writes are done
+    std::condition_variable writtenCondition;
+    std::queue<std::pair<RegionLayerIndex, glm::ivec2>> compactionQueue;
+    bool compressRequested = false;
+    /// @brief Number of requested pending chunks writes
+    uint64_t writesRequested = 0;
+    /// @brief Number of done pending chunks writes
+    uint64_t writesDone = 0;
+    /// @brief Functions called when writes with the id are done
+    std::vector<std::pair<uint64_t, std::function<void()>>> writtenCallbacks;
+    bool ioStopped = false;
+
+    /// @brief Start I/O thread if not started yet (ioMutex must be locked)
+    void startIoThread();
+    void ioLoop();
+    /// @brief Write pending chunks of all layers (called by I/O thread)
+    void writePending();
+    /// @brief Queue fragmented regions compaction (ioMutex must be locked)
+    void queueCompaction();
 public:
     bool generatorTestMode = false;
     bool doWriteLights = true;
+    /// @brief Hash of content properties used by lights
+    /// (see Lighting::calculateContentHash). Cached lights are loaded only
+    /// if they were built with the same content and voxels
+    uint32_t lightsContentHash = 0;
+    /// @brief Put chunks are compressed and written by I/O thread,
+    /// so writeAll does not block. Must be set before chunks are put
+    bool asyncWrites = false;
 
     WorldRegions(const fs::path& directory);
     WorldRegions(const WorldRegions&) = delete;
@@ -212,9 +388,11 @@ public:
     /// @return voxels data buffer or nullptr
     std::unique_ptr<ubyte[]> getVoxels(int x, int z);
 
-    /// @brief Get cached lights for chunk at x,z
-    /// @return lights data or nullptr
-    std::unique_ptr<light_t[]> getLights(int x, int z);
+    /// @brief Load cached lights for chunk at x,z
+    /// @param lightmap target lightmap
+    /// @param voxelsHash hash of the chunk voxels data (see hashVoxels)
+    /// @return false if there are no cached lights or they are stale
+    bool getLights(int x, int z, Lightmap& lightmap, uint32_t voxelsHash);
     
     ChunkInventoriesMap fetchInventories(int x, int z);
 
@@ -245,11 +423,27 @@ public:
 
     fs::path getRegionFilePath(RegionLayerIndex layerid, int x, int z) const;
 
-    /// @brief Write all region layers
-    void writeAll();
+    /// @brief Write all region layers. Fragmented region files are
+    /// compacted in background after that.
+    /// In asynchronous writes mode only requests I/O thread to write
+    /// pending chunks
+    /// @param onWritten called after the regions are written
+    /// (by I/O thread in asynchronous writes mode)
+    void writeAll(std::function<void()> onWritten = nullptr);
+
+    /// @brief Wait until all chunks put before are written
+    void waitForWrites();
+
+    /// @brief Unload saved regions data of all layers.
+    /// Released chunks data will be read from files again when requested
+    void releaseSaved();
 
     void deleteRegion(RegionLayerIndex layerid, int x, int z);
 
+    /// @brief Calculate hash of chunk voxels data
+    /// @param data CHUNK_DATA_LEN bytes (see Chunk::encode)
+    static uint32_t hashVoxels(const ubyte* data);
+
     /// @brief Extract X and Z from 'X_Z.bin' region file name.
     /// @param name source region file name
     /// @param x parsed X destination
@@ -13,6 +13,16 @@
 #include "coders/toml.hpp"
 #include "util/stringutil.hpp"
 
+#ifdef _WIN32
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 namespace fs = std::filesystem;
 
 files::rafile::rafile(const fs::path& filename)
@@ -36,6 +46,88 @@ void files::rafile::read(char* buffer, std::streamsize size) {
     file.read(buffer, size);
 }
 
+#ifdef _WIN32
+files::mmfile::mmfile(const fs::path& filename) {
+    HANDLE file = CreateFileW(
+        filename.wstring().c_str(),
+        GENERIC_READ,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        nullptr,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL,
+        nullptr
+    );
+    if (file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("could not to open file " + filename.string());
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        CloseHandle(file);
+        throw std::runtime_error("could not to get file size " + filename.string());
+    }
+    fileHandle = file;
+    filelength = static_cast<size_t>(size.QuadPart);
+    if (filelength == 0) {
+        return;
+    }
+    HANDLE mapping =
+        CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr) {
+        CloseHandle(file);
+        throw std::runtime_error("could not to map file " + filename.string());
+    }
+    mappingHandle = mapping;
+    bytes = static_cast<const ubyte*>(
+        MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0)
+    );
+    if (bytes == nullptr) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        throw std::runtime_error("could not to map file " + filename.string());
+    }
+}
+
+files::mmfile::~mmfile() {
+    if (bytes) {
+        UnmapViewOfFile(bytes);
+    }
+    if (mappingHandle) {
+        CloseHandle(mappingHandle);
+    }
+    CloseHandle(fileHandle);
+}
+#else
+files::mmfile::mmfile(const fs::path& filename) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd == -1) {
+        throw std::runtime_error("could not to open file " + filename.string());
+    }
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        close(fd);
+        throw std::runtime_error("could not to get file size " + filename.string());
+    }
+    filelength = static_cast<size_t>(st.st_size);
+    if (filelength == 0) {
+        close(fd);
+        return;
+    }
+    void* ptr = mmap(nullptr, filelength, PROT_READ, MAP_SHARED, fd, 0);
+    // mapping stays valid after the descriptor is closed
+    close(fd);
+    if (ptr == MAP_FAILED) {
+        throw std::runtime_error("could not to map file " + filename.string());
+    }
+    bytes = static_cast<const ubyte*>(ptr);
+}
+
+files::mmfile::~mmfile() {
+    if (bytes) {
+        munmap(const_cast<ubyte*>(bytes), filelength);
+    }
+}
+#endif
+
 bool files::write_bytes(
     const fs::path& filename, const ubyte* data, size_t size
 ) {
@@ -119,12 +211,74 @@ bool files::write_string(const fs::path& filename, std::string_view content) {
     return true;
 }
 
+#ifdef _WIN32
+bool files::sync_file(const fs::path& filename) {
+    HANDLE file = CreateFileW(
+        filename.wstring().c_str(),
+        GENERIC_WRITE,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        nullptr,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL,
+        nullptr
+    );
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    bool flushed = FlushFileBuffers(file);
+    CloseHandle(file);
+    return flushed;
+}
+#else
+bool files::sync_file(const fs::path& filename) {
+    int fd = open(filename.c_str(), O_WRONLY);
+    if (fd == -1) {
+        return false;
+    }
+    bool flushed = fsync(fd) == 0;
+    close(fd);
+    return flushed;
+}
+#endif
+
+bool files::write_string_atomic(
+    const fs::path& filename, std::string_view content
+) {
+    fs::path tmpFilename = filename;
+    tmpFilename += ".tmp";
+    {
+        std::ofstream file(tmpFilename);
+        if (!file) {
+            return false;
+        }
+        file << content;
+        file.close();
+        if (!file) {
+            return false;
+        }
+    }
+    if (!sync_file(tmpFilename)) {
+        return false;
+    }
+    std::error_code err;
+    fs::rename(tmpFilename, filename, err);
+    return !err;
+}
+
 bool files::write_json(
     const fs::path& filename, const dv::value& obj, bool nice
 ) {
     return files::write_string(filename, json::stringify(obj, nice, "  "));
 }
 
+bool files::write_json_atomic(
+    const fs::path& filename, const dv::value& obj, bool nice
+) {
+    return files::write_string_atomic(
+        filename, json::stringify(obj, nice, "  ")
+    );
+}
+
 bool files::write_binary_json(
     const fs::path& filename, const dv::value& obj, bool compression
 ) {
@@ -25,6 +25,31 @@ namespace files {
         size_t length() const;
     };
 
+    /// @brief Read-only memory-mapped file.
+    /// Mapped content may be read from multiple threads concurrently
+    class mmfile {
+        const ubyte* bytes = nullptr;
+        size_t filelength = 0;
+#ifdef _WIN32
+        void* fileHandle = nullptr;
+        void* mappingHandle = nullptr;
+#endif
+    public:
+        /// @throws std::runtime_error - file could not be opened or mapped
+        mmfile(const fs::path& filename);
+        mmfile(const mmfile&) = delete;
+        ~mmfile();
+
+        /// @return mapped file content (nullptr if file is empty)
+        const ubyte* data() const {
+            return bytes;
+        }
+
+        size_t length() const {
+            return filelength;
+        }
+    };
+
     /// @brief Write bytes array to the file without any extra data
     /// @param file target file
     /// @param data data bytes array
@@ -40,6 +65,17 @@ namespace files {
     /// @brief Write string to the file
     bool write_string(const fs::path& filename, std::string_view content);
 
+    /// @brief Flush written file content to the storage device
+    /// @return false if file could not be opened or flushed
+    bool sync_file(const fs::path& filename);
+
+    /// @brief Write string to a temporary file, then replace the target
+    /// file with it, so the target file is never left partially written.
+    /// Temporary file is synced before the replace
+    bool write_string_atomic(
+        const fs::path& filename, std::string_view content
+    );
+
     /// @brief Write dynamic data to the JSON file
     /// @param nice if true, human readable format will be used, otherwise
     /// minimal
@@ -47,6 +83,12 @@ namespace files {
         const fs::path& filename, const dv::value& obj, bool nice = true
     );
 
+    /// @brief Write dynamic data to the JSON file using temporary file
+    /// (see write_string_atomic)
+    bool write_json_atomic(
+        const fs::path& filename, const dv::value& obj, bool nice = true
+    );
+
     /// @brief Write dynamic data to the binary JSON file
     /// (see src/coders/binary_json_spec.md)
     /// @param compressed use gzip compression
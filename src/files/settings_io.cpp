@@ -64,6 +64,9 @@ SettingsHandler::SettingsHandler(EngineSettings& settings) {
     builder.add("load-distance", &settings.chunks.loadDistance);
     builder.add("load-speed", &settings.chunks.loadSpeed);
     builder.add("padding", &settings.chunks.padding);
+    builder.add("generator-workers", &settings.chunks.generatorWorkers);
+    builder.add("lighting-workers", &settings.chunks.lightingWorkers);
+    builder.add("palette-storage", &settings.chunks.paletteStorage);
 
     builder.section("graphics");
     builder.add("fog-curve", &settings.graphics.fogCurve);
@@ -71,6 +74,7 @@ SettingsHandler::SettingsHandler(EngineSettings& settings) {
     builder.add("dense-render", &settings.graphics.denseRender);
     builder.add("gamma", &settings.graphics.gamma);
     builder.add("frustum-culling", &settings.graphics.frustumCulling);
+    builder.add("greedy-meshing", &settings.graphics.greedyMeshing);
     builder.add("skybox-resolution", &settings.graphics.skyboxResolution);
     builder.add("chunk-max-vertices", &settings.graphics.chunkMaxVertices);
     builder.add("chunk-max-vertices-dense", &settings.graphics.chunkMaxVerticesDense);
@@ -36,9 +36,13 @@ void ContentGfxCache::refresh(const Block& def, const Atlas& atlas) {
         }
     }
     if (def.model == BlockModel::custom) {
-        auto model = assets.require<model::Model>(def.modelName);
+        // model generated from custom-model-raw if not named
+        std::string modelName = def.modelName.empty()
+                                    ? def.name + ".model"
+                                    : def.modelName;
+        auto model = assets.require<model::Model>(modelName);
         // temporary dirty fix tbh
-        if (def.modelName.find(':') == std::string::npos) {
+        if (modelName.find(':') == std::string::npos) {
             for (auto& mesh : model.meshes) {
                 size_t pos = mesh.texture.find(':');
                 if (pos == std::string::npos) {
@@ -80,6 +80,9 @@ LevelScreen::LevelScreen(
         worldRenderer->clear();
         frontend->getContentGfxCache().refresh();
     }));
+    keepAlive(settings.graphics.greedyMeshing.observe([=](bool) {
+        worldRenderer->clear();
+    }));
     keepAlive(settings.camera.fov.observe([=](double value) {
         player->fpCamera->setFov(glm::radians(value));
     }));
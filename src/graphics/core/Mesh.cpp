@@ -8,7 +8,7 @@ int Mesh::drawCalls = 0;
 inline size_t calc_vertex_size(const VertexAttribute* attrs) {
     size_t vertexSize = 0;
     for (int i = 0; attrs[i].size; i++) {
-        vertexSize += attrs[i].size;
+        vertexSize += attrs[i].count();
     }
     assert(vertexSize != 0);
     return vertexSize;
@@ -27,10 +27,7 @@ Mesh::Mesh(const float* vertexBuffer, size_t vertices, const int* indexBuffer, s
     indices(0)
 {
     meshesCount++;
-    vertexSize = 0;
-    for (int i = 0; attrs[i].size; i++) {
-        vertexSize += attrs[i].size;
-    }
+    vertexSize = calc_vertex_size(attrs);
 
     glGenVertexArrays(1, &vao);
     glGenBuffers(1, &vbo);
@@ -41,9 +38,12 @@ Mesh::Mesh(const float* vertexBuffer, size_t vertices, const int* indexBuffer, s
     int offset = 0;
     for (int i = 0; attrs[i].size; i++) {
         int size = attrs[i].size;
-        glVertexAttribPointer(i, size, GL_FLOAT, GL_FALSE, vertexSize * sizeof(float), (GLvoid*)(offset * sizeof(float)));
+        GLenum type = attrs[i].type == VertexAttribute::Type::USHORT
+                          ? GL_UNSIGNED_SHORT
+                          : GL_FLOAT;
+        glVertexAttribPointer(i, size, type, GL_FALSE, vertexSize * sizeof(float), (GLvoid*)(offset * sizeof(float)));
         glEnableVertexAttribArray(i);
-        offset += size;
+        offset += attrs[i].count();
     }
 
     glBindVertexArray(0);
@@ -7,7 +7,20 @@
 
 /// @brief Vertex attribute info
 struct VertexAttribute {
+    enum class Type : ubyte {
+        FLOAT,
+        /// @brief Unsigned short converted to float without normalization.
+        /// Two components take a single float of vertex data
+        USHORT,
+    };
+    /// @brief Number of components
     ubyte size;
+    Type type = Type::FLOAT;
+
+    /// @return attribute size in vertex data elements
+    inline int count() const {
+        return type == Type::USHORT ? (size + 1) / 2 : size;
+    }
 };
 
 /// @brief Raw mesh data structure
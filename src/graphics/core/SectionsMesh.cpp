@@ -0,0 +1,137 @@
+#include "SectionsMesh.hpp"
+#include "Mesh.hpp"
+#include <assert.h>
+#include <GL/glew.h>
+
+SectionsMesh::SectionsMesh(size_t sectionsCount, const VertexAttribute* attrs)
+    : vertexSize(0), sections(sectionsCount) {
+    Mesh::meshesCount++;
+    for (int i = 0; attrs[i].size; i++) {
+        this->attrs.push_back(attrs[i]);
+        vertexSize += attrs[i].count();
+    }
+    this->attrs.push_back({0});
+    assert(vertexSize != 0);
+
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &vbo);
+    glGenBuffers(1, &ibo);
+    bindAttributes();
+}
+
+SectionsMesh::~SectionsMesh() {
+    Mesh::meshesCount--;
+    glDeleteVertexArrays(1, &vao);
+    glDeleteBuffers(1, &vbo);
+    glDeleteBuffers(1, &ibo);
+}
+
+void SectionsMesh::bindAttributes() {
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    int offset = 0;
+    for (int i = 0; attrs[i].size; i++) {
+        int size = attrs[i].size;
+        GLenum type = attrs[i].type == VertexAttribute::Type::USHORT
+                          ? GL_UNSIGNED_SHORT
+                          : GL_FLOAT;
+        glVertexAttribPointer(i, size, type, GL_FALSE, vertexSize * sizeof(float), (GLvoid*)(offset * sizeof(float)));
+        glEnableVertexAttribArray(i);
+        offset += attrs[i].count();
+    }
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+    glBindVertexArray(0);
+}
+
+bool SectionsMesh::hasAttributes(const VertexAttribute* attrs) const {
+    for (size_t i = 0; i < this->attrs.size(); i++) {
+        if (attrs[i].size != this->attrs[i].size ||
+            attrs[i].type != this->attrs[i].type) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void SectionsMesh::update(const MeshData* const* data) {
+    std::vector<Section> updated(sections.size());
+    size_t totalVertices = 0;
+    size_t totalIndices = 0;
+    for (size_t i = 0; i < sections.size(); i++) {
+        auto& section = updated[i];
+        section.baseVertex = totalVertices;
+        section.firstIndex = totalIndices;
+        if (data[i]) {
+            section.vertices = data[i]->vertices.size() / vertexSize;
+            section.indices = data[i]->indices.size();
+        } else {
+            section.vertices = sections[i].vertices;
+            section.indices = sections[i].indices;
+        }
+        totalVertices += section.vertices;
+        totalIndices += section.indices;
+    }
+    size_t vertexBytes = vertexSize * sizeof(float);
+
+    // kept sections are copied from the current buffers to the new ones
+    GLuint buffers[2];
+    glGenBuffers(2, buffers);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffers[0]);
+    glBufferData(GL_COPY_WRITE_BUFFER, totalVertices * vertexBytes, nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_READ_BUFFER, vbo);
+    for (size_t i = 0; i < sections.size(); i++) {
+        const auto& section = updated[i];
+        if (section.vertices == 0) {
+            continue;
+        }
+        if (data[i]) {
+            glBufferSubData(GL_COPY_WRITE_BUFFER, section.baseVertex * vertexBytes, section.vertices * vertexBytes, data[i]->vertices.data());
+        } else {
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, sections[i].baseVertex * vertexBytes, section.baseVertex * vertexBytes, section.vertices * vertexBytes);
+        }
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffers[1]);
+    glBufferData(GL_COPY_WRITE_BUFFER, totalIndices * sizeof(int), nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_READ_BUFFER, ibo);
+    for (size_t i = 0; i < sections.size(); i++) {
+        const auto& section = updated[i];
+        if (section.indices == 0) {
+            continue;
+        }
+        if (data[i]) {
+            glBufferSubData(GL_COPY_WRITE_BUFFER, section.firstIndex * sizeof(int), section.indices * sizeof(int), data[i]->indices.data());
+        } else {
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, sections[i].firstIndex * sizeof(int), section.firstIndex * sizeof(int), section.indices * sizeof(int));
+        }
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    glDeleteBuffers(1, &vbo);
+    glDeleteBuffers(1, &ibo);
+    vbo = buffers[0];
+    ibo = buffers[1];
+    bindAttributes();
+
+    sections = std::move(updated);
+    drawCounts.clear();
+    drawOffsets.clear();
+    drawBaseVertices.clear();
+    for (const auto& section : sections) {
+        if (section.indices == 0) {
+            continue;
+        }
+        drawCounts.push_back(section.indices);
+        drawOffsets.push_back((const GLvoid*)(section.firstIndex * sizeof(int)));
+        drawBaseVertices.push_back(section.baseVertex);
+    }
+}
+
+void SectionsMesh::draw() const {
+    if (drawCounts.empty()) {
+        return;
+    }
+    Mesh::drawCalls++;
+    glBindVertexArray(vao);
+    glMultiDrawElementsBaseVertex(GL_TRIANGLES, drawCounts.data(), GL_UNSIGNED_INT, drawOffsets.data(), drawCounts.size(), drawBaseVertices.data());
+    glBindVertexArray(0);
+}
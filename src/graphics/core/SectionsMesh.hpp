@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stdlib.h>
+#include <vector>
+
+#include "typedefs.hpp"
+#include "MeshData.hpp"
+
+/// @brief Indexed mesh split into sections sharing vertex and index
+/// buffers. Sections are replaced independently, all of them are drawn
+/// with a single draw call
+class SectionsMesh {
+    struct Section {
+        /// @brief First section vertex, section indices are relative to it
+        size_t baseVertex = 0;
+        size_t vertices = 0;
+        size_t firstIndex = 0;
+        size_t indices = 0;
+    };
+    unsigned int vao;
+    unsigned int vbo = 0;
+    unsigned int ibo = 0;
+    size_t vertexSize;
+    /// @brief Vertex attributes including the terminating one
+    std::vector<VertexAttribute> attrs;
+    std::vector<Section> sections;
+
+    /// @brief Index counts, offsets and base vertices of not empty sections
+    std::vector<int> drawCounts;
+    std::vector<const void*> drawOffsets;
+    std::vector<int> drawBaseVertices;
+
+    void bindAttributes();
+public:
+    /// @param sectionsCount number of sections (all are empty)
+    /// @param attrs vertex attribute sizes (must be null-terminated)
+    SectionsMesh(size_t sectionsCount, const VertexAttribute* attrs);
+    SectionsMesh(const SectionsMesh&) = delete;
+    ~SectionsMesh();
+
+    /// @brief Check if the mesh vertex attributes are the same
+    /// @param attrs vertex attribute sizes (must be null-terminated)
+    bool hasAttributes(const VertexAttribute* attrs) const;
+
+    /// @brief Replace data of the sections. Data of other sections is
+    /// copied by GPU without being read back
+    /// @param data section index buffers with indices relative to the
+    /// section vertices, nullptr to keep the section.
+    /// Not empty data must have the mesh vertex attributes
+    void update(const MeshData* const* data);
+
+    /// @brief Draw not empty sections as triangles
+    void draw() const;
+
+    bool isEmpty() const {
+        return drawCounts.empty();
+    }
+};
@@ -1,5 +1,7 @@
 #include "BlocksRenderer.hpp"
 
+#include <algorithm>
+
 #include "graphics/core/Mesh.hpp"
 #include "graphics/commons/Model.hpp"
 #include "maths/UVRegion.hpp"
@@ -11,13 +13,40 @@
 
 const glm::vec3 BlocksRenderer::SUN_VECTOR (0.411934f, 0.863868f, -0.279161f);
 
+static inline float as_float(uint32_t bits) {
+    union {
+        float floating;
+        uint32_t integer;
+    } value;
+    value.integer = bits;
+    return value.floating;
+}
+
+static uint32_t compress_light(const glm::vec4& light) {
+    uint32_t compressed = (static_cast<uint32_t>(light.r * 255) & 0xff) << 24;
+    compressed |= (static_cast<uint32_t>(light.g * 255) & 0xff) << 16;
+    compressed |= (static_cast<uint32_t>(light.b * 255) & 0xff) << 8;
+    compressed |= (static_cast<uint32_t>(light.a * 255) & 0xff);
+    return compressed;
+}
+
+/// @brief Convert UV region size to 16-bit fixed point
+/// (exact for atlases up to 65536 pixels, see main.glslv)
+static uint16_t to_tile_size(float size) {
+    return static_cast<uint16_t>(
+        std::clamp(std::lround(size * 65536), 1L, 0xFFFFL)
+    );
+}
+
 BlocksRenderer::BlocksRenderer(
     size_t capacity,
     const Content& content,
     const ContentGfxCache& cache,
     const EngineSettings& settings
 ) : content(content),
-    vertexBuffer(std::make_unique<float[]>(capacity * CHUNK_VERTEX_SIZE)),
+    vertexBuffer(
+        std::make_unique<float[]>(capacity * CHUNK_GREEDY_VERTEX_SIZE)
+    ),
     indexBuffer(std::make_unique<int[]>(capacity)),
     vertexOffset(0),
     indexOffset(0),
@@ -26,11 +55,11 @@ BlocksRenderer::BlocksRenderer(
     cache(cache),
     settings(settings) 
 {
-    voxelsBuffer = std::make_unique<VoxelsVolume>(
-        CHUNK_W + voxelBufferPadding*2, 
-        CHUNK_H, 
-        CHUNK_D + voxelBufferPadding*2);
+    chunkVoxels = std::make_unique<voxel[]>(CHUNK_VOL);
     blockDefsCache = content.getIndices()->blocks.getDefs();
+    greedyFaces = std::make_unique<GreedyFace[]>(
+        std::max(CHUNK_W, CHUNK_D) * CHUNK_H
+    );
 }
 
 BlocksRenderer::~BlocksRenderer() {
@@ -39,6 +68,16 @@ BlocksRenderer::~BlocksRenderer() {
 /// Basic vertex add method
 void BlocksRenderer::vertex(
     const glm::vec3& coord, float u, float v, const glm::vec4& light
+) {
+    vertex(coord, u, v, compress_light(light), {});
+}
+
+void BlocksRenderer::vertex(
+    const glm::vec3& coord,
+    float u,
+    float v,
+    uint32_t light,
+    const TileSize& tileSize
 ) {
     vertexBuffer[vertexOffset++] = coord.x;
     vertexBuffer[vertexOffset++] = coord.y;
@@ -47,17 +86,11 @@ void BlocksRenderer::vertex(
     vertexBuffer[vertexOffset++] = u;
     vertexBuffer[vertexOffset++] = v;
 
-    union {
-        float floating;
-        uint32_t integer;
-    } compressed;
-
-    compressed.integer = (static_cast<uint32_t>(light.r * 255) & 0xff) << 24;
-    compressed.integer |= (static_cast<uint32_t>(light.g * 255) & 0xff) << 16;
-    compressed.integer |= (static_cast<uint32_t>(light.b * 255) & 0xff) << 8;
-    compressed.integer |= (static_cast<uint32_t>(light.a * 255) & 0xff);
-
-    vertexBuffer[vertexOffset++] = compressed.floating;
+    vertexBuffer[vertexOffset++] = as_float(light);
+    if (vertexSize == CHUNK_GREEDY_VERTEX_SIZE) {
+        uint16_t size[] {tileSize.width, tileSize.height};
+        std::memcpy(&vertexBuffer[vertexOffset++], size, sizeof(size));
+    }
 }
 
 void BlocksRenderer::index(int a, int b, int c, int d, int e, int f) {
@@ -81,7 +114,7 @@ void BlocksRenderer::face(
     const glm::vec4(&lights)[4],
     const glm::vec4& tint
 ) {
-    if (vertexOffset + CHUNK_VERTEX_SIZE * 4 > capacity) {
+    if (vertexOffset + vertexSize * 4 > capacity) {
         overflow = true;
         return;
     }
@@ -121,7 +154,7 @@ void BlocksRenderer::faceAO(
     const UVRegion& region,
     bool lights
 ) {
-    if (vertexOffset + CHUNK_VERTEX_SIZE * 4 > capacity) {
+    if (vertexOffset + vertexSize * 4 > capacity) {
         overflow = true;
         return;
     }
@@ -159,7 +192,7 @@ void BlocksRenderer::face(
     glm::vec4 tint,
     bool lights
 ) {
-    if (vertexOffset + CHUNK_VERTEX_SIZE * 4 > capacity) {
+    if (vertexOffset + vertexSize * 4 > capacity) {
         overflow = true;
         return;
     }
@@ -177,6 +210,41 @@ void BlocksRenderer::face(
     index(0, 1, 2, 0, 2, 3);
 }
 
+void BlocksRenderer::greedyQuad(
+    const glm::vec3& coord,
+    const glm::ivec3& axisX,
+    const glm::ivec3& axisY,
+    const glm::ivec3& axisZ,
+    int w, int h,
+    const UVRegion& region,
+    uint32_t light
+) {
+    if (vertexOffset + vertexSize * 4 > capacity) {
+        overflow = true;
+        return;
+    }
+    glm::vec3 X = glm::vec3(axisX) * static_cast<float>(w);
+    glm::vec3 Y = glm::vec3(axisY) * static_cast<float>(h);
+    glm::vec3 Z(axisZ);
+    float u2 = region.u1 + region.getWidth() * w;
+    float v2 = region.v1 + region.getHeight() * h;
+    TileSize tiling;
+    if (w > 1 || h > 1) {
+        tiling = {
+            to_tile_size(region.getWidth()), to_tile_size(region.getHeight())
+        };
+    }
+
+    float s = 0.5f;
+    vertex(coord + (-X - Y + Z) * s, region.u1, region.v1, light, tiling);
+    vertex(coord + ( X - Y + Z) * s, u2, region.v1, light, tiling);
+    vertex(coord + ( X + Y + Z) * s, u2, v2, light, tiling);
+    vertex(coord + (-X + Y + Z) * s, region.u1, v2, light, tiling);
+    // the first vertex is provoking (last in triangle), shader takes
+    // the region origin from it
+    index(1, 2, 0, 2, 3, 0);
+}
+
 void BlocksRenderer::blockXSprite(
     int x, int y, int z, 
     const glm::vec3& size, 
@@ -289,7 +357,7 @@ void BlocksRenderer::blockCustomModel(
 
     const auto& model = cache.getModel(block->rt.id);
     for (const auto& mesh : model.meshes) {
-        if (vertexOffset + CHUNK_VERTEX_SIZE * mesh.vertices.size() > capacity) {
+        if (vertexOffset + vertexSize * mesh.vertices.size() > capacity) {
             overflow = true;
             return;
         }
@@ -385,9 +453,9 @@ void BlocksRenderer::blockCube(
 }
 
 bool BlocksRenderer::isOpenForLight(int x, int y, int z) const {
-    blockid_t id = voxelsBuffer->pickBlockId(chunk->x * CHUNK_W + x, 
-                                             y, 
-                                             chunk->z * CHUNK_D + z);
+    blockid_t id = voxelsView.pickBlockId(chunk->x * CHUNK_W + x, 
+                                           y, 
+                                           chunk->z * CHUNK_D + z);
     if (id == BLOCK_VOID) {
         return false;
     }
@@ -400,8 +468,8 @@ bool BlocksRenderer::isOpenForLight(int x, int y, int z) const {
 
 glm::vec4 BlocksRenderer::pickLight(int x, int y, int z) const {
     if (isOpenForLight(x, y, z)) {
-        light_t light = voxelsBuffer->pickLight(chunk->x * CHUNK_W + x, y, 
-                                                chunk->z * CHUNK_D + z);
+        light_t light = voxelsView.pickLight(chunk->x * CHUNK_W + x, y, 
+                                             chunk->z * CHUNK_D + z);
         return glm::vec4(Lightmap::extract(light, 0),
                          Lightmap::extract(light, 1),
                          Lightmap::extract(light, 2),
@@ -444,6 +512,10 @@ void BlocksRenderer::render(
         }
         int end = beginEnds[drawGroup][1];
         for (int i = begin-1; i <= end; i++) {
+            if (emptySections[i / CHUNK_SECTION_VOL]) {
+                i += CHUNK_SECTION_VOL - 1 - i % CHUNK_SECTION_VOL;
+                continue;
+            }
             const voxel& vox = voxels[i];
             blockid_t id = vox.id;
             blockstate state = vox.state;
@@ -451,7 +523,7 @@ void BlocksRenderer::render(
             if (id == 0 || def.drawGroup != drawGroup || state.segment) {
                 continue;
             }
-            if (def.translucent) {
+            if (def.translucent || (greedy && isGreedyBlock(def))) {
                 continue;
             }
             const UVRegion texfaces[6] {
@@ -492,6 +564,142 @@ void BlocksRenderer::render(
     }
 }
 
+/// @brief Greedy meshing faces directions, axes are the same as in blockCube
+static const struct {
+    glm::ivec3 axisX, axisY, axisZ;
+    int side;
+} GREEDY_DIRECTIONS[6] {
+    {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}, 5},
+    {{-1, 0, 0}, {0, 1, 0}, {0, 0, -1}, 4},
+    {{1, 0, 0}, {0, 0, -1}, {0, 1, 0}, 3},
+    {{1, 0, 0}, {0, 0, 1}, {0, -1, 0}, 2},
+    {{0, 0, -1}, {0, 1, 0}, {1, 0, 0}, 1},
+    {{0, 0, 1}, {0, 1, 0}, {-1, 0, 0}, 0},
+};
+
+static inline int axis_index(const glm::ivec3& axis) {
+    return axis.x ? 0 : (axis.y ? 1 : 2);
+}
+
+void BlocksRenderer::renderGreedy(const voxel* voxels, int section) {
+    const int lo[3] {
+        0, std::max(section * CHUNK_SECTION_H, chunk->bottom), 0
+    };
+    const int hi[3] {
+        CHUNK_W, std::min((section + 1) * CHUNK_SECTION_H, chunk->top), CHUNK_D
+    };
+    if (lo[1] >= hi[1]) {
+        return;
+    }
+
+    for (const auto& dir : GREEDY_DIRECTIONS) {
+        const auto& X = dir.axisX;
+        const auto& Y = dir.axisY;
+        const auto& Z = dir.axisZ;
+        int ua = axis_index(X);
+        int va = axis_index(Y);
+        int na = axis_index(Z);
+        int gw = hi[ua] - lo[ua];
+        int gh = hi[va] - lo[va];
+        float d = 0.8f + glm::dot(glm::vec3(Z), SUN_VECTOR) * 0.2f;
+
+        for (int slice = lo[na]; slice < hi[na]; slice++) {
+            bool found = false;
+            for (int gv = 0; gv < gh; gv++) {
+                for (int gu = 0; gu < gw; gu++) {
+                    auto& face = greedyFaces[gv * gw + gu];
+                    face.id = 0;
+
+                    glm::ivec3 pos;
+                    pos[na] = slice;
+                    pos[ua] = lo[ua] + gu;
+                    pos[va] = lo[va] + gv;
+                    uint index = vox_index(pos.x, pos.y, pos.z);
+                    if (emptySections[index / CHUNK_SECTION_VOL]) {
+                        continue;
+                    }
+                    const voxel& vox = voxels[index];
+                    const auto& def = *blockDefsCache[vox.id];
+                    if (vox.id == 0 || vox.state.segment ||
+                        !isGreedyBlock(def) || !isOpen(pos + Z, def)) {
+                        continue;
+                    }
+                    bool lights = !def.shadeless;
+                    glm::vec4 light(1.0f);
+                    if (!def.ambientOcclusion) {
+                        light = pickLight(pos + Z) * (lights ? d : 1.0f);
+                    } else if (lights) {
+                        auto corner = pos + Z;
+                        uint32_t corners[4] {
+                            compress_light(pickSoftLight(corner, X, Y) * d),
+                            compress_light(pickSoftLight(corner + X, X, Y) * d),
+                            compress_light(pickSoftLight(corner + X + Y, X, Y) * d),
+                            compress_light(pickSoftLight(corner + Y, X, Y) * d),
+                        };
+                        if (corners[0] != corners[1] ||
+                            corners[0] != corners[2] ||
+                            corners[0] != corners[3]) {
+                            // smooth lighting can't be merged
+                            faceAO(
+                                pos, X, Y, Z,
+                                cache.getRegion(vox.id, dir.side), true
+                            );
+                            continue;
+                        }
+                        face = {vox.id, corners[0]};
+                        found = true;
+                        continue;
+                    }
+                    face = {vox.id, compress_light(light)};
+                    found = true;
+                }
+            }
+            if (!found) {
+                continue;
+            }
+            for (int gv = 0; gv < gh; gv++) {
+                for (int gu = 0; gu < gw; gu++) {
+                    const auto face = greedyFaces[gv * gw + gu];
+                    if (face.id == 0) {
+                        continue;
+                    }
+                    auto same = [face](const GreedyFace& other) {
+                        return other.id == face.id && other.light == face.light;
+                    };
+                    int w = 1;
+                    while (gu + w < gw && same(greedyFaces[gv * gw + gu + w])) {
+                        w++;
+                    }
+                    int h = 1;
+                    for (; gv + h < gh; h++) {
+                        const auto row = &greedyFaces[(gv + h) * gw + gu];
+                        if (!std::all_of(row, row + w, same)) {
+                            break;
+                        }
+                    }
+                    for (int j = 0; j < h; j++) {
+                        auto row = &greedyFaces[(gv + j) * gw + gu];
+                        for (int i = 0; i < w; i++) {
+                            row[i].id = 0;
+                        }
+                    }
+                    glm::vec3 coord;
+                    coord[na] = slice;
+                    coord[ua] = lo[ua] + gu + (w - 1) * 0.5f;
+                    coord[va] = lo[va] + gv + (h - 1) * 0.5f;
+                    greedyQuad(
+                        coord, X, Y, Z, w, h,
+                        cache.getRegion(face.id, dir.side), face.light
+                    );
+                    if (overflow) {
+                        return;
+                    }
+                }
+            }
+        }
+    }
+}
+
 SortingMeshData BlocksRenderer::renderTranslucent(
     const voxel* voxels, int beginEnds[256][2]
 ) {
@@ -507,6 +715,10 @@ SortingMeshData BlocksRenderer::renderTranslucent(
         }
         int end = beginEnds[drawGroup][1];
         for (int i = begin-1; i <= end; i++) {
+            if (emptySections[i / CHUNK_SECTION_VOL]) {
+                i += CHUNK_SECTION_VOL - 1 - i % CHUNK_SECTION_VOL;
+                continue;
+            }
             const voxel& vox = voxels[i];
             blockid_t id = vox.id;
             blockstate state = vox.state;
@@ -562,9 +774,10 @@ SortingMeshData BlocksRenderer::renderTranslucent(
             totalSize += entry.vertexData.size();
 
             for (int j = 0; j < indexSize; j++) {
+                // translucent faces are not tiled
                 std::memcpy(
                     entry.vertexData.data() + j * CHUNK_VERTEX_SIZE,
-                    vertexBuffer.get() + indexBuffer[j] * CHUNK_VERTEX_SIZE,
+                    vertexBuffer.get() + indexBuffer[j] * vertexSize,
                     sizeof(float) * CHUNK_VERTEX_SIZE
                 );
                 float& vx = entry.vertexData[j * CHUNK_VERTEX_SIZE + 0];
@@ -608,71 +821,96 @@ SortingMeshData BlocksRenderer::renderTranslucent(
     return sortingMesh;
 }
 
-void BlocksRenderer::build(const Chunk* chunk, const Chunks* chunks) {
+void BlocksRenderer::build(const ChunksArea& area, uint32_t sections) {
+    const Chunk* chunk = area[4].get();
     this->chunk = chunk;
-    voxelsBuffer->setPosition(
-        chunk->x * CHUNK_W - voxelBufferPadding, 0,
-        chunk->z * CHUNK_D - voxelBufferPadding);
-    chunks->getVoxels(*voxelsBuffer, settings.graphics.backlight.get());
-
-    if (voxelsBuffer->pickBlockId(
-        chunk->x * CHUNK_W, 0, chunk->z * CHUNK_D
-    ) == BLOCK_VOID) {
-        cancelled = true;
+    meshes.sections = 0;
+
+    int lowest = 0;
+    while (lowest < CHUNK_SECTIONS && !(sections & (1U << lowest))) {
+        lowest++;
+    }
+    if (lowest == CHUNK_SECTIONS) {
+        cancelled = false;
         return;
     }
-    const voxel* voxels = chunk->voxels;
-
-    int totalBegin = chunk->bottom * (CHUNK_W * CHUNK_D);
-    int totalEnd = chunk->top * (CHUNK_W * CHUNK_D);
-
-    int beginEnds[256][2] {};
-    for (int i = totalBegin; i < totalEnd; i++) {
-        const voxel& vox = voxels[i];
-        blockid_t id = vox.id;
-        const auto& def = *blockDefsCache[id];
-    
-        if (beginEnds[def.drawGroup][0] == 0) {
-            beginEnds[def.drawGroup][0] = i+1;
+    int highest = CHUNK_SECTIONS - 1;
+    while (!(sections & (1U << highest))) {
+        highest--;
+    }
+    voxelsView.set(area, blockDefsCache, settings.graphics.backlight.get());
+    for (int i = 0; i < CHUNK_SECTIONS; i++) {
+        emptySections[i] = chunk->voxels.isEmpty(i);
+        if (!emptySections[i] && (sections & (1U << i))) {
+            chunk->voxels.readSection(
+                i, chunkVoxels.get() + i * CHUNK_SECTION_VOL
+            );
         }
-        beginEnds[def.drawGroup][1] = i;
     }
+    const voxel* voxels = chunkVoxels.get();
+
     cancelled = false;
+    greedy = settings.graphics.greedyMeshing.get();
+    vertexSize = greedy ? CHUNK_GREEDY_VERTEX_SIZE : CHUNK_VERTEX_SIZE;
 
-    overflow = false;
-    vertexOffset = 0;
-    indexOffset = indexSize = 0;
-    
-    sortingMesh = std::move(renderTranslucent(voxels, beginEnds));
-    
-    overflow = false;
-    vertexOffset = 0;
-    indexOffset = indexSize = 0;
-    
-    render(voxels, beginEnds);
-}
+    for (int section = lowest; section <= highest; section++) {
+        if (!(sections & (1U << section))) {
+            continue;
+        }
+        auto& data = meshes.meshes[section];
+        meshes.sections |= 1U << section;
+
+        int totalBegin = std::max(section * CHUNK_SECTION_H, chunk->bottom) *
+                         (CHUNK_W * CHUNK_D);
+        int totalEnd = std::min((section + 1) * CHUNK_SECTION_H, chunk->top) *
+                       (CHUNK_W * CHUNK_D);
+        if (emptySections[section] || totalBegin >= totalEnd) {
+            // section has no blocks, its previous mesh must be cleared
+            data = ChunkMeshData {};
+            continue;
+        }
+        int beginEnds[256][2] {};
+        for (int i = totalBegin; i < totalEnd; i++) {
+            const voxel& vox = voxels[i];
+            blockid_t id = vox.id;
+            const auto& def = *blockDefsCache[id];
+        
+            if (beginEnds[def.drawGroup][0] == 0) {
+                beginEnds[def.drawGroup][0] = i+1;
+            }
+            beginEnds[def.drawGroup][1] = i;
+        }
 
-ChunkMeshData BlocksRenderer::createMesh() {
-    return ChunkMeshData {
-        MeshData(
+        overflow = false;
+        vertexOffset = 0;
+        indexOffset = indexSize = 0;
+        
+        data.sortingMesh = renderTranslucent(voxels, beginEnds);
+        
+        overflow = false;
+        vertexOffset = 0;
+        indexOffset = indexSize = 0;
+        
+        render(voxels, beginEnds);
+        if (greedy && !overflow) {
+            renderGreedy(voxels, section);
+        }
+        data.mesh = MeshData(
             util::Buffer<float>(vertexBuffer.get(), vertexOffset),
             util::Buffer<int>(indexBuffer.get(), indexSize),
-            util::Buffer<VertexAttribute>(
-                CHUNK_VATTRS, sizeof(CHUNK_VATTRS) / sizeof(VertexAttribute)
-            )
-        ),
-        std::move(sortingMesh)};
-}
-
-ChunkMesh BlocksRenderer::render(const Chunk* chunk, const Chunks* chunks) {
-    build(chunk, chunks);
-
-    size_t vcount = vertexOffset / CHUNK_VERTEX_SIZE;
-    return ChunkMesh{std::make_unique<Mesh>(
-        vertexBuffer.get(), vcount, indexBuffer.get(), indexSize, CHUNK_VATTRS
-    ), std::move(sortingMesh)};
+            greedy ? util::Buffer<VertexAttribute>(
+                         CHUNK_GREEDY_VATTRS,
+                         sizeof(CHUNK_GREEDY_VATTRS) / sizeof(VertexAttribute)
+                     )
+                   : util::Buffer<VertexAttribute>(
+                         CHUNK_VATTRS,
+                         sizeof(CHUNK_VATTRS) / sizeof(VertexAttribute)
+                     )
+        );
+    }
+    voxelsView.release();
 }
 
-VoxelsVolume* BlocksRenderer::getVoxelsBuffer() const {
-    return voxelsBuffer.get();
+ChunkSectionsMeshData BlocksRenderer::createMesh() {
+    return std::move(meshes);
 }
@@ -9,7 +9,7 @@
 
 #include "voxels/Block.hpp"
 #include "voxels/Chunk.hpp"
-#include "voxels/VoxelsVolume.hpp"
+#include "voxels/VoxelsView.hpp"
 #include "graphics/core/MeshData.hpp"
 #include "maths/util.hpp"
 #include "commons.hpp"
@@ -20,7 +20,6 @@ class Mesh;
 class Block;
 class Chunk;
 class Chunks;
-class VoxelsVolume;
 class Chunks;
 class ContentGfxCache;
 struct UVRegion;
@@ -31,13 +30,37 @@ class BlocksRenderer {
     std::unique_ptr<float[]> vertexBuffer;
     std::unique_ptr<int[]> indexBuffer;
     size_t vertexOffset;
+    /// @brief Vertex size of the chunk being built divided by sizeof(float)
+    size_t vertexSize = CHUNK_VERTEX_SIZE;
     size_t indexOffset, indexSize;
     size_t capacity;
-    int voxelBufferPadding = 2;
     bool overflow = false;
     bool cancelled = false;
     const Chunk* chunk = nullptr;
-    std::unique_ptr<VoxelsVolume> voxelsBuffer;
+    /// @brief Blocks of the chunk being built and its neighbours
+    VoxelsView voxelsView;
+    /// @brief Unpacked voxels of the chunk being built
+    std::unique_ptr<voxel[]> chunkVoxels;
+    /// @brief Air sections of the chunk being built (not unpacked)
+    bool emptySections[CHUNK_SECTIONS] {};
+
+    /// @brief Cube face in a greedy meshing slice
+    struct GreedyFace {
+        /// @brief Block id (0 if there is no face to merge)
+        blockid_t id;
+        /// @brief Compressed face light
+        uint32_t light;
+    };
+    /// @brief Size of the tiled UV region as 16-bit fixed point width and
+    /// height (0 - no tiling, see main.glslv)
+    struct TileSize {
+        uint16_t width = 0;
+        uint16_t height = 0;
+    };
+    /// @brief Merge faces of full cubes (see renderGreedy)
+    bool greedy = false;
+    /// @brief Faces of the slice being merged
+    std::unique_ptr<GreedyFace[]> greedyFaces;
 
     const Block* const* blockDefsCache;
     const ContentGfxCache& cache;
@@ -45,9 +68,20 @@ class BlocksRenderer {
     
     util::PseudoRandom randomizer;
 
-    SortingMeshData sortingMesh;
+    /// @brief Meshes data of the built sections
+    ChunkSectionsMeshData meshes;
 
     void vertex(const glm::vec3& coord, float u, float v, const glm::vec4& light);
+    /// @param light compressed light
+    /// @param tileSize size of the tiled UV region (written with greedy
+    /// meshing only)
+    void vertex(
+        const glm::vec3& coord,
+        float u,
+        float v,
+        uint32_t light,
+        const TileSize& tileSize
+    );
     void index(int a, int b, int c, int d, int e, int f);
 
     void vertexAO(
@@ -84,6 +118,17 @@ class BlocksRenderer {
         const UVRegion& region,
         bool lights
     );
+    /// @brief Add a quad covering w*h faces, texture region is repeated
+    /// for each face
+    void greedyQuad(
+        const glm::vec3& coord,
+        const glm::ivec3& axisX,
+        const glm::ivec3& axisY,
+        const glm::ivec3& axisZ,
+        int w, int h,
+        const UVRegion& region,
+        uint32_t light
+    );
     void blockCube(
         const glm::ivec3& coord,
         const UVRegion(&faces)[6], 
@@ -119,7 +164,7 @@ class BlocksRenderer {
 
     // Does block allow to see other blocks sides (is it transparent)
     inline bool isOpen(const glm::ivec3& pos, const Block& def) const {
-        auto id = voxelsBuffer->pickBlockId(
+        auto id = voxelsView.pickBlockId(
             chunk->x * CHUNK_W + pos.x, pos.y, chunk->z * CHUNK_D + pos.z
         );
         if (id == BLOCK_VOID) {
@@ -143,7 +188,17 @@ class BlocksRenderer {
     glm::vec4 pickSoftLight(const glm::ivec3& coord, const glm::ivec3& right, const glm::ivec3& up) const;
     glm::vec4 pickSoftLight(float x, float y, float z, const glm::ivec3& right, const glm::ivec3& up) const;
     
+    /// @brief Check if block faces may be merged by renderGreedy
+    inline bool isGreedyBlock(const Block& def) const {
+        return def.model == BlockModel::block && !def.rotatable &&
+               !def.translucent;
+    }
+
     void render(const voxel* voxels, int beginEnds[256][2]);
+    /// @brief Render faces of greedy blocks (see isGreedyBlock) of the
+    /// section, merging neighbour faces of the same block with the same
+    /// light into quads
+    void renderGreedy(const voxel* voxels, int section);
     SortingMeshData renderTranslucent(const voxel* voxels, int beginEnds[256][2]);
 public:
     BlocksRenderer(
@@ -154,10 +209,15 @@ public:
     );
     virtual ~BlocksRenderer();
 
-    void build(const Chunk* chunk, const Chunks* chunks);
-    ChunkMesh render(const Chunk* chunk, const Chunks* chunks);
-    ChunkMeshData createMesh();
-    VoxelsVolume* getVoxelsBuffer() const;
+    /// @brief Build meshes of the central chunk sections
+    /// @param area chunk and its neighbours pinned by the caller
+    /// (see VoxelsView::pin)
+    /// @param sections bit mask of sections to build
+    void build(
+        const ChunksArea& area, uint32_t sections = CHUNK_SECTIONS_MASK
+    );
+    /// @brief Take meshes data of the sections built by the last build call
+    ChunkSectionsMeshData createMesh();
 
     bool isCancelled() const {
         return cancelled;
@@ -3,6 +3,7 @@
 #include "debug/Logger.hpp"
 #include "assets/Assets.hpp"
 #include "graphics/core/Mesh.hpp"
+#include "graphics/core/SectionsMesh.hpp"
 #include "graphics/core/Shader.hpp"
 #include "graphics/core/Texture.hpp"
 #include "graphics/core/Atlas.hpp"
@@ -18,19 +19,16 @@ static debug::Logger logger("chunks-render");
 
 size_t ChunksRenderer::visibleChunks = 0;
 
-class RendererWorker : public util::Worker<std::shared_ptr<Chunk>, RendererResult> {
+class RendererWorker : public util::Worker<ChunksRenderJob, RendererResult> {
     const Level& level;
-    const Chunks& chunks;
     BlocksRenderer renderer;
 public:
     RendererWorker(
         const Level& level,
-        const Chunks& chunks,
         const ContentGfxCache& cache,
         const EngineSettings& settings
     )
         : level(level),
-          chunks(chunks),
           renderer(
               settings.graphics.denseRender.get()
                   ? settings.graphics.chunkMaxVerticesDense.get()
@@ -41,11 +39,12 @@ public:
           ) {
     }
 
-    RendererResult operator()(const std::shared_ptr<Chunk>& chunk) override {
-        renderer.build(chunk.get(), &chunks);
+    RendererResult operator()(const ChunksRenderJob& job) override {
+        const auto& chunk = job.area[4];
+        renderer.build(job.area, job.sections);
         if (renderer.isCancelled()) {
             return RendererResult {
-                glm::ivec2(chunk->x, chunk->z), true, MeshData()};
+                glm::ivec2(chunk->x, chunk->z), true, {}};
         }
         auto meshData = renderer.createMesh();
         return RendererResult {
@@ -70,15 +69,14 @@ ChunksRenderer::ChunksRenderer(
           "chunks-render-pool",
           [&]() {
               return std::make_shared<RendererWorker>(
-                  *level, chunks, cache, settings
+                  *level, cache, settings
               );
           },
           [&](RendererResult& result) {
-              if (!result.cancelled) {
-                  auto meshData = std::move(result.meshData);
-                  meshes[result.key] = ChunkMesh {
-                      std::make_unique<Mesh>(meshData.mesh),
-                      std::move(meshData.sortingMesh)};
+              // chunk may be unloaded while its job is in work
+              if (!result.cancelled &&
+                  chunks.getChunk(result.key.x, result.key.y)) {
+                  setMeshes(result.key, std::move(result.meshData));
               }
               inwork.erase(result.key);
           },
@@ -95,23 +93,93 @@ ChunksRenderer::ChunksRenderer(
 ChunksRenderer::~ChunksRenderer() {
 }
 
-const Mesh* ChunksRenderer::render(
-    const std::shared_ptr<Chunk>& chunk, bool important
+const ChunkMesh* ChunksRenderer::setMeshes(
+    const glm::ivec2& key, ChunkSectionsMeshData data
 ) {
-    chunk->flags.modified = false;
-    if (important) {
-        auto mesh = renderer->render(chunk.get(), &chunks);
-        meshes[glm::ivec2(chunk->x, chunk->z)] = ChunkMesh {
-            std::move(mesh.mesh), std::move(mesh.sortingMeshData)
-        };
-        return meshes[glm::ivec2(chunk->x, chunk->z)].mesh.get();
+    const MeshData* sectionsData[CHUNK_SECTIONS] {};
+    const VertexAttribute* attrs = nullptr;
+    for (int i = 0; i < CHUNK_SECTIONS; i++) {
+        if (!((data.sections >> i) & 1U)) {
+            continue;
+        }
+        const auto& mesh = data.meshes[i].mesh;
+        sectionsData[i] = &mesh;
+        if (mesh.vertices.size() != 0) {
+            attrs = mesh.attrs.data();
+        }
+    }
+    auto found = meshes.find(key);
+    if (found != meshes.end() && found->second.mesh && attrs &&
+        !found->second.mesh->hasAttributes(attrs)) {
+        // sections built before the vertex format change
+        // can not be kept, so the chunk is built again
+        meshes.erase(found);
+        found = meshes.end();
+    }
+    if (found == meshes.end()) {
+        if (data.sections != CHUNK_SECTIONS_MASK) {
+            return nullptr;
+        }
+        found = meshes.try_emplace(key).first;
+    }
+    auto& chunkMesh = found->second;
+    if (chunkMesh.mesh == nullptr && attrs) {
+        chunkMesh.mesh = std::make_unique<SectionsMesh>(CHUNK_SECTIONS, attrs);
+    }
+    if (chunkMesh.mesh) {
+        chunkMesh.mesh->update(sectionsData);
+    }
+    auto& entries = chunkMesh.sortingMeshData.entries;
+    entries.erase(
+        std::remove_if(
+            entries.begin(),
+            entries.end(),
+            [sections = data.sections](const SortingMeshEntry& entry) {
+                int section =
+                    static_cast<int>(entry.position.y) / CHUNK_SECTION_H;
+                return (sections >> section) & 1U;
+            }
+        ),
+        entries.end()
+    );
+    for (int i = 0; i < CHUNK_SECTIONS; i++) {
+        if (!((data.sections >> i) & 1U)) {
+            continue;
+        }
+        auto& sectionData = data.meshes[i];
+        for (auto& entry : sectionData.sortingMesh.entries) {
+            entries.push_back(std::move(entry));
+        }
     }
+    chunkMesh.sortedMesh = nullptr;
+    return &chunkMesh;
+}
+
+const ChunkMesh* ChunksRenderer::render(
+    const std::shared_ptr<Chunk>& chunk, bool important
+) {
     glm::ivec2 key(chunk->x, chunk->z);
     if (inwork.find(key) != inwork.end()) {
+        // modified sections will be built when the job is done
         return nullptr;
     }
+    uint32_t sections = chunk->modifiedSections;
+    if (sections == 0 || meshes.find(key) == meshes.end()) {
+        sections = CHUNK_SECTIONS_MASK;
+    }
+    chunk->flags.modified = false;
+    chunk->modifiedSections = 0;
+    auto area = VoxelsView::pin(chunks, chunk->x, chunk->z);
+    if (important) {
+        renderer->build(area, sections);
+        if (renderer->isCancelled()) {
+            chunk->setModified();
+            return nullptr;
+        }
+        return setMeshes(key, renderer->createMesh());
+    }
     inwork[key] = true;
-    threadPool.enqueueJob(chunk);
+    threadPool.enqueueJob(ChunksRenderJob {std::move(area), sections});
     return nullptr;
 }
 
@@ -128,24 +196,25 @@ void ChunksRenderer::clear() {
     threadPool.clearQueue();
 }
 
-const Mesh* ChunksRenderer::getOrRender(
+const ChunkMesh* ChunksRenderer::getOrRender(
     const std::shared_ptr<Chunk>& chunk, bool important
 ) {
     auto found = meshes.find(glm::ivec2(chunk->x, chunk->z));
     if (found == meshes.end()) {
         return render(chunk, important);
     }
+    const ChunkMesh* mesh = &found->second;
     if (chunk->flags.modified && chunk->flags.lighted) {
         render(chunk, important);
     }
-    return found->second.mesh.get();
+    return mesh;
 }
 
 void ChunksRenderer::update() {
     threadPool.update();
 }
 
-const Mesh* ChunksRenderer::retrieveChunk(
+const ChunkMesh* ChunksRenderer::retrieveChunk(
     size_t index, const Camera& camera, Shader& shader, bool culling
 ) {
     auto chunk = chunks.getChunks()[index];
@@ -157,7 +226,7 @@ const Mesh* ChunksRenderer::retrieveChunk(
         if (found == meshes.end()) {
             return nullptr;
         } else {
-            return found->second.mesh.get();
+            return &found->second;
         }
     }
     float distance = glm::distance(
@@ -230,7 +299,9 @@ void ChunksRenderer::drawChunks(
             );
             glm::mat4 model = glm::translate(glm::mat4(1.0f), coord);
             shader.uniformMatrix("u_model", model);
-            mesh->draw();
+            if (mesh->mesh) {
+                mesh->mesh->draw();
+            }
             visibleChunks++;
         }
     }
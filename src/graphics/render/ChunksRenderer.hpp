@@ -10,6 +10,7 @@
 #include <glm/gtx/hash.hpp>
 
 #include "voxels/Block.hpp"
+#include "voxels/VoxelsView.hpp"
 #include "util/ThreadPool.hpp"
 #include "graphics/core/MeshData.hpp"
 #include "commons.hpp"
@@ -35,10 +36,17 @@ struct ChunksSortEntry {
     }
 };
 
+struct ChunksRenderJob {
+    /// @brief Chunk and its neighbours pinned by the main thread
+    ChunksArea area;
+    /// @brief Bit mask of sections to build
+    uint32_t sections;
+};
+
 struct RendererResult {
     glm::ivec2 key;
     bool cancelled;
-    ChunkMeshData meshData;
+    ChunkSectionsMeshData meshData;
 };
 
 class ChunksRenderer {
@@ -52,10 +60,16 @@ class ChunksRenderer {
     std::unordered_map<glm::ivec2, ChunkMesh> meshes;
     std::unordered_map<glm::ivec2, bool> inwork;
     std::vector<ChunksSortEntry> indices;
-    util::ThreadPool<std::shared_ptr<Chunk>, RendererResult> threadPool;
-    const Mesh* retrieveChunk(
+    util::ThreadPool<ChunksRenderJob, RendererResult> threadPool;
+    const ChunkMesh* retrieveChunk(
         size_t index, const Camera& camera, Shader& shader, bool culling
     );
+    /// @brief Replace meshes of the built sections.
+    /// Partial results are dropped if the chunk has no mesh
+    /// @return chunk mesh or nullptr
+    const ChunkMesh* setMeshes(
+        const glm::ivec2& key, ChunkSectionsMeshData data
+    );
 public:
     ChunksRenderer(
         const Level* level,
@@ -67,13 +81,16 @@ public:
     );
     virtual ~ChunksRenderer();
 
-    const Mesh* render(
+    /// @brief Build meshes of the chunk modified sections
+    /// (all sections if the chunk has no mesh)
+    /// @param important build synchronously
+    const ChunkMesh* render(
         const std::shared_ptr<Chunk>& chunk, bool important
     );
     void unload(const Chunk* chunk);
     void clear();
 
-    const Mesh* getOrRender(
+    const ChunkMesh* getOrRender(
         const std::shared_ptr<Chunk>& chunk, bool important
     );
     void drawChunks(const Camera& camera, Shader& shader);
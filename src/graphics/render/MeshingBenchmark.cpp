@@ -0,0 +1,281 @@
+#include "MeshingBenchmark.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <zlib.h>
+
+#include "BlocksRenderer.hpp"
+#include "ModelsGenerator.hpp"
+#include "assets/Assets.hpp"
+#include "coders/imageio.hpp"
+#include "coders/obj.hpp"
+#include "coders/vec3.hpp"
+#include "constants.hpp"
+#include "content/Content.hpp"
+#include "debug/Logger.hpp"
+#include "files/engine_paths.hpp"
+#include "files/files.hpp"
+#include "frontend/ContentGfxCache.hpp"
+#include "graphics/core/Atlas.hpp"
+#include "graphics/core/ImageData.hpp"
+#include "graphics/core/Mesh.hpp"
+#include "lighting/Lighting.hpp"
+#include "logic/WorldPregenerator.hpp"
+#include "settings.hpp"
+#include "util/WorkerGroup.hpp"
+#include "util/stringutil.hpp"
+#include "util/timeutil.hpp"
+#include "voxels/Chunk.hpp"
+#include "voxels/Chunks.hpp"
+#include "voxels/GlobalChunks.hpp"
+#include "world/Level.hpp"
+
+static debug::Logger logger("meshing-bench");
+
+MeshingBenchmark::MeshingBenchmark(
+    Level& level,
+    const ResPaths& paths,
+    const EngineSettings& settings,
+    const glm::ivec4& area
+)
+    : level(level), paths(paths), settings(settings), area(area) {
+    if (area.x > area.z || area.y > area.w) {
+        throw std::invalid_argument("invalid benchmark area");
+    }
+    loadChunks();
+    loadAssets();
+}
+
+MeshingBenchmark::~MeshingBenchmark() = default;
+
+void MeshingBenchmark::loadChunks() {
+    glm::ivec4 border(area.x - 1, area.y - 1, area.z + 1, area.w + 1);
+    uint workersCount = std::max(1U, std::thread::hardware_concurrency()) - 1;
+    {
+        WorldPregenerator pregenerator(level, border, workersCount);
+        pregenerator.waitForEnd();
+    }
+    int width = border.z - border.x + 1;
+    int depth = border.w - border.y + 1;
+    chunks = std::make_unique<Chunks>(
+        width, depth, 0, 0, level.events.get(), *level.content.getIndices()
+    );
+    chunks->setCenter(
+        (border.x + width / 2) * CHUNK_W, (border.y + depth / 2) * CHUNK_D
+    );
+
+    const auto& indices = *level.content.getIndices();
+    std::vector<Chunk*> unlighted;
+    for (int z = border.y; z <= border.w; z++) {
+        for (int x = border.x; x <= border.z; x++) {
+            auto chunk = level.chunks->create(x, z);
+            if (!chunk->flags.loaded) {
+                throw std::runtime_error(
+                    "chunk " + std::to_string(x) + "," + std::to_string(z) +
+                    " is not generated"
+                );
+            }
+            chunk->updateHeights();
+            if (!chunk->flags.loadedLights) {
+                Lighting::prebuildSkyLight(*chunk, indices);
+                if (x >= area.x && x <= area.z && z >= area.y && z <= area.w) {
+                    unlighted.push_back(chunk.get());
+                }
+            }
+            chunk->flags.ready = true;
+            chunks->putChunk(std::move(chunk));
+        }
+    }
+    if (!unlighted.empty()) {
+        // lights are not cached (see debug.write-lights)
+        util::WorkerGroup workers(workersCount);
+        Lighting(level.content, *chunks).buildLights(unlighted, workers);
+    }
+}
+
+/// @brief Load block model file like assetload::model does,
+/// model textures are expected to be in the blocks atlas
+static void load_model(
+    Assets& assets, const ResPaths& paths, const std::string& name
+) {
+    auto file = MODELS_FOLDER + "/" + name;
+    auto path = paths.find(file + ".vec3");
+    if (fs::exists(path)) {
+        auto bytes = files::read_bytes_buffer(path);
+        auto modelVEC3 = vec3::load(path.u8string(), bytes);
+        for (auto& [modelName, model] : modelVEC3.models) {
+            std::string fullName = name;
+            if (name != modelName) {
+                fullName += "." + modelName;
+            }
+            assets.store(
+                std::make_unique<model::Model>(std::move(model.model)),
+                fullName
+            );
+        }
+        return;
+    }
+    path = paths.find(file + ".obj");
+    if (!fs::exists(path)) {
+        throw std::runtime_error("model " + util::quote(name) + " not found");
+    }
+    assets.store(
+        obj::parse(path.u8string(), files::read_string(path)), name
+    );
+}
+
+void MeshingBenchmark::loadAssets() {
+    assets = std::make_unique<Assets>();
+
+    AtlasBuilder builder;
+    for (const auto& file : paths.listdir("textures/blocks")) {
+        if (!imageio::is_read_supported(file.extension().u8string())) {
+            continue;
+        }
+        std::string name = file.stem().string();
+        if (builder.has(name)) {
+            continue;
+        }
+        auto image = imageio::read(file);
+        image->fixAlphaColor();
+        builder.add(name, std::move(image));
+    }
+    assets->store(builder.build(2, false), "blocks");
+
+    for (const auto& [name, def] : level.content.blocks.getDefs()) {
+        if (def->model != BlockModel::custom) {
+            continue;
+        }
+        if (def->modelName.empty()) {
+            // block definitions are shared with the level content,
+            // so the generated model name is not assigned
+            // (see ContentGfxCache::refresh)
+            assets->store(
+                std::make_unique<model::Model>(
+                    ModelsGenerator::loadCustomBlockModel(
+                        def->customModelRaw, *assets, !def->shadeless
+                    )
+                ),
+                name + ".model"
+            );
+        } else if (assets->get<model::Model>(def->modelName) == nullptr) {
+            load_model(*assets, paths, def->modelName);
+        }
+    }
+    cache = std::make_unique<ContentGfxCache>(
+        level.content, *assets, settings.graphics
+    );
+}
+
+bool MeshingBenchmark::run(uint passes) {
+    BlocksRenderer renderer(
+        settings.graphics.denseRender.get()
+            ? settings.graphics.chunkMaxVerticesDense.get()
+            : settings.graphics.chunkMaxVertices.get(),
+        level.content,
+        *cache,
+        settings
+    );
+    logger.info() << "meshing area " << area.x << "," << area.y << " - "
+                  << area.z << "," << area.w << " (greedy meshing: "
+                  << (settings.graphics.greedyMeshing.get() ? "on" : "off")
+                  << ")";
+
+    bool deterministic = true;
+    uLong firstChecksum = 0;
+    for (uint pass = 0; pass < passes; pass++) {
+        uLong checksum = crc32(0L, Z_NULL, 0);
+        size_t meshed = 0;
+        size_t vertices = 0;
+        size_t indices = 0;
+        size_t bytes = 0;
+        // result buffers: vertices and indices per mesh and vertices per
+        // sorting entry (temporary allocations of meshing are not counted)
+        size_t allocations = 0;
+        // not empty sections meshes, drawn with a single draw call per chunk
+        size_t sectionMeshes = 0;
+        int64_t mcs = 0;
+        size_t vertexSize = settings.graphics.greedyMeshing.get()
+                                ? CHUNK_GREEDY_VERTEX_SIZE
+                                : CHUNK_VERTEX_SIZE;
+        for (int z = area.y; z <= area.w; z++) {
+            for (int x = area.x; x <= area.z; x++) {
+                auto chunksArea = VoxelsView::pin(*chunks, x, z);
+                if (chunksArea[4] == nullptr) {
+                    continue;
+                }
+                timeutil::Timer timer;
+                renderer.build(chunksArea);
+                auto data = renderer.createMesh();
+                mcs += timer.stop();
+
+                if (renderer.isCancelled()) {
+                    continue;
+                }
+                meshed++;
+
+                for (int s = 0; s < CHUNK_SECTIONS; s++) {
+                    if (!((data.sections >> s) & 1U)) {
+                        continue;
+                    }
+                    const auto& section = data.meshes[s];
+                    const auto& mesh = section.mesh;
+                    if (mesh.vertices != nullptr) {
+                        sectionMeshes += mesh.indices.size() != 0;
+                        vertices += mesh.vertices.size() / vertexSize;
+                        indices += mesh.indices.size();
+                        bytes += mesh.vertices.size() * sizeof(float) +
+                                 mesh.indices.size() * sizeof(int);
+                        allocations += 2;
+                        checksum = crc32(
+                            checksum,
+                            reinterpret_cast<const Bytef*>(mesh.vertices.data()),
+                            mesh.vertices.size() * sizeof(float)
+                        );
+                        checksum = crc32(
+                            checksum,
+                            reinterpret_cast<const Bytef*>(mesh.indices.data()),
+                            mesh.indices.size() * sizeof(int)
+                        );
+                    }
+                    for (const auto& entry : section.sortingMesh.entries) {
+                        const auto& vertexData = entry.vertexData;
+                        vertices += vertexData.size() / CHUNK_VERTEX_SIZE;
+                        bytes += vertexData.size() * sizeof(float);
+                        allocations++;
+                        checksum = crc32(
+                            checksum,
+                            reinterpret_cast<const Bytef*>(vertexData.data()),
+                            vertexData.size() * sizeof(float)
+                        );
+                    }
+                }
+            }
+        }
+        double seconds = std::max(mcs, static_cast<int64_t>(1)) / 1e6;
+        double count = std::max(meshed, static_cast<size_t>(1));
+        logger.info() << "pass " << (pass + 1) << ": " << meshed
+                      << " chunks in " << (mcs / 1000) << " ms ("
+                      << static_cast<int>(meshed / seconds) << " chunks/s), "
+                      << static_cast<size_t>(vertices / count)
+                      << " vertices/chunk, "
+                      << static_cast<size_t>(indices / count)
+                      << " indices/chunk, "
+                      << static_cast<size_t>(bytes / count) << " bytes/chunk, "
+                      << (allocations / count)
+                      << " buffers/chunk (estimated), "
+                      << (sectionMeshes / count)
+                      << " section meshes/chunk, checksum "
+                      << util::tohex(checksum);
+        if (pass == 0) {
+            firstChecksum = checksum;
+        } else if (checksum != firstChecksum) {
+            logger.error() << "pass " << (pass + 1)
+                           << " meshes differ from the first pass";
+            deterministic = false;
+        }
+    }
+    return deterministic;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <memory>
+
+#include <glm/glm.hpp>
+
+#include "typedefs.hpp"
+
+class Level;
+class Chunks;
+class Assets;
+class ResPaths;
+class ContentGfxCache;
+struct EngineSettings;
+
+/// @brief Headless chunks meshing benchmark.
+///
+/// The area with a border of one chunk is pre-generated (see
+/// WorldPregenerator) and loaded, then every area chunk is meshed with
+/// BlocksRenderer without a graphics context: block textures are packed
+/// into an atlas that is never uploaded.
+/// Meshing is repeated for a number of passes, every pass must produce
+/// the same meshes checksum. The checksum is reported to compare meshes
+/// built by different versions
+class MeshingBenchmark {
+    Level& level;
+    const ResPaths& paths;
+    const EngineSettings& settings;
+    /// @brief Area in chunks {minX, minZ, maxX, maxZ} (inclusive)
+    glm::ivec4 area;
+    std::unique_ptr<Chunks> chunks;
+    std::unique_ptr<Assets> assets;
+    std::unique_ptr<ContentGfxCache> cache;
+
+    /// @brief Pre-generate, load and light the area and its border
+    void loadChunks();
+    /// @brief Create blocks atlas and models used by ContentGfxCache
+    void loadAssets();
+public:
+    /// @param level target level. Chunks must not be loaded by other
+    /// controllers while the benchmark is running
+    /// @param paths resources paths of the level content
+    /// @param area chunks area {minX, minZ, maxX, maxZ} (inclusive)
+    MeshingBenchmark(
+        Level& level,
+        const ResPaths& paths,
+        const EngineSettings& settings,
+        const glm::ivec4& area
+    );
+    ~MeshingBenchmark();
+
+    /// @brief Mesh all area chunks the number of times, reporting
+    /// statistics of each pass
+    /// @return false if passes produced different meshes
+    bool run(uint passes);
+};
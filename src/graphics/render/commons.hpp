@@ -4,6 +4,7 @@
 #include <memory>
 #include <glm/vec3.hpp>
 
+#include "constants.hpp"
 #include "graphics/core/MeshData.hpp"
 #include "util/Buffer.hpp"
 
@@ -11,8 +12,15 @@
 inline const VertexAttribute CHUNK_VATTRS[]{ {3}, {2}, {1}, {0} };
 /// @brief Chunk mesh vertex size divided by sizeof(float)
 inline constexpr int CHUNK_VERTEX_SIZE = 6;
+/// @brief Chunk mesh vertex attributes with greedy meshing: additional
+/// size of the tiled uv region (see main.glslv)
+inline const VertexAttribute CHUNK_GREEDY_VATTRS[]{
+    {3}, {2}, {1}, {2, VertexAttribute::Type::USHORT}, {0} };
+/// @brief Chunk mesh vertex size with greedy meshing divided by sizeof(float)
+inline constexpr int CHUNK_GREEDY_VERTEX_SIZE = 7;
 
 class Mesh;
+class SectionsMesh;
 
 struct SortingMeshEntry {
     glm::vec3 position;
@@ -28,13 +36,24 @@ struct SortingMeshData {
     std::vector<SortingMeshEntry> entries;
 };
 
+/// @brief Mesh data of a chunk section
 struct ChunkMeshData {
     MeshData mesh;
     SortingMeshData sortingMesh;
 };
 
+/// @brief Mesh data of built chunk sections
+struct ChunkSectionsMeshData {
+    /// @brief Bit mask of built sections
+    uint32_t sections = 0;
+    ChunkMeshData meshes[CHUNK_SECTIONS];
+};
+
 struct ChunkMesh {
-    std::unique_ptr<Mesh> mesh;
+    /// @brief Opaque faces of all chunk sections, drawn with a single draw
+    /// call (nullptr if there are no faces)
+    std::unique_ptr<SectionsMesh> mesh;
+    /// @brief Translucent blocks of all sections
     SortingMeshData sortingMeshData;
     std::unique_ptr<Mesh> sortedMesh = nullptr;
 };
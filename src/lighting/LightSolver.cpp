@@ -1,126 +1,250 @@
-#include <iostream>
-#include <assert.h>
-
 #include "LightSolver.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+
 #include "Lightmap.hpp"
 #include "content/Content.hpp"
+#include "maths/voxmaths.hpp"
 #include "voxels/Chunks.hpp"
 #include "voxels/Chunk.hpp"
 #include "voxels/voxel.hpp"
 #include "voxels/Block.hpp"
 
-LightSolver::LightSolver(const ContentIndices& contentIds, Chunks& chunks, int channel) 
-    : blockDefs(contentIds.blocks.getDefs()),
-      chunks(chunks), 
-      channel(channel) {
+static constexpr int COORDS[] {
+    0, 0, 1,
+    0, 0,-1,
+    0, 1, 0,
+    0,-1, 0,
+    1, 0, 0,
+   -1, 0, 0
+};
+
+LightSolver::LightSolver(
+    const ContentIndices& contentIds,
+    Chunks& chunks,
+    std::initializer_list<int> channels
+)
+    : blockDefs(contentIds.blocks.getDefs()), chunks(chunks), mask(0) {
+    for (int channel : channels) {
+        this->channels[channelsCount++] = channel;
+        mask |= 0xF << (channel << 2);
+    }
+}
+
+Chunk* LightSolver::getChunk(int cx, int cz) {
+    if (!centerValid || std::abs(cx - centerX) > 1 ||
+        std::abs(cz - centerZ) > 1) {
+        centerX = cx;
+        centerZ = cz;
+        centerValid = true;
+        for (int dz = -1; dz <= 1; dz++) {
+            for (int dx = -1; dx <= 1; dx++) {
+                neighbours[(dz + 1) * 3 + dx + 1] =
+                    chunks.getChunk(cx + dx, cz + dz);
+            }
+        }
+    }
+    return getNeighbour(cx, cz);
 }
 
-void LightSolver::add(int x, int y, int z, int emission) {
-    if (emission <= 1)
+void LightSolver::add(int x, int y, int z, light_t emission) {
+    if (y < 0 || y >= CHUNK_H) {
         return;
-    Chunk* chunk = chunks.getChunkByVoxel(x, y, z);
-    if (chunk == nullptr)
+    }
+    Chunk* chunk = getChunk(floordiv<CHUNK_W>(x), floordiv<CHUNK_D>(z));
+    if (chunk == nullptr) {
         return;
-    ubyte light = chunk->lightmap.get(x-chunk->x*CHUNK_W, y, z-chunk->z*CHUNK_D, channel);
-    if (emission < light) return;
-
-    addqueue.push(lightentry {x, y, z, ubyte(emission)});
+    }
+    uint index = vox_index(x - chunk->x * CHUNK_W, y, z - chunk->z * CHUNK_D);
+    light_t light = chunk->lightmap.get(index);
+    light_t added = 0;
+    light_t addedMask = 0;
+    for (int i = 0; i < channelsCount; i++) {
+        int shift = channels[i] << 2;
+        int value = (emission >> shift) & 0xF;
+        if (value <= 1 || value < ((light >> shift) & 0xF)) {
+            continue;
+        }
+        added |= value << shift;
+        addedMask |= 0xF << shift;
+    }
+    if (added == 0) {
+        return;
+    }
+    addqueue.push(lightentry {x, z, uint16_t(y), added});
 
-    chunk->flags.modified = true;
-    chunk->lightmap.set(x-chunk->x*CHUNK_W, y, z-chunk->z*CHUNK_D, channel, emission);
+    chunk->setModified(y);
+    chunk->lightmap.set(index, (light & ~addedMask) | added);
 }
 
 void LightSolver::add(int x, int y, int z) {
-    add(x,y,z, chunks.getLight(x,y,z, channel));
+    if (y < 0 || y >= CHUNK_H) {
+        return;
+    }
+    Chunk* chunk = getChunk(floordiv<CHUNK_W>(x), floordiv<CHUNK_D>(z));
+    if (chunk == nullptr) {
+        return;
+    }
+    uint index = vox_index(x - chunk->x * CHUNK_W, y, z - chunk->z * CHUNK_D);
+    add(x, y, z, chunk->lightmap.get(index) & mask);
 }
 
 void LightSolver::remove(int x, int y, int z) {
-    Chunk* chunk = chunks.getChunkByVoxel(x, y, z);
-    if (chunk == nullptr)
+    if (y < 0 || y >= CHUNK_H) {
         return;
-
-    ubyte light = chunk->lightmap.get(x-chunk->x*CHUNK_W, y, z-chunk->z*CHUNK_D, channel);
-    if (light == 0){
+    }
+    Chunk* chunk = getChunk(floordiv<CHUNK_W>(x), floordiv<CHUNK_D>(z));
+    if (chunk == nullptr) {
+        return;
+    }
+    uint index = vox_index(x - chunk->x * CHUNK_W, y, z - chunk->z * CHUNK_D);
+    light_t light = chunk->lightmap.get(index);
+    if ((light & mask) == 0) {
         return;
     }
-    remqueue.push(lightentry {x, y, z, light});
-    chunk->lightmap.set(x-chunk->x*CHUNK_W, y, z-chunk->z*CHUNK_D, channel, 0);
+    remqueue.push(lightentry {x, z, uint16_t(y), light_t(light & mask)});
+    chunk->lightmap.set(index, light & ~mask);
 }
 
-void LightSolver::solve(){
-    const int coords[] = {
-            0, 0, 1,
-            0, 0,-1,
-            0, 1, 0,
-            0,-1, 0,
-            1, 0, 0,
-           -1, 0, 0
-    };
-
-    while (!remqueue.empty()){
-        const lightentry entry = remqueue.front();
-        remqueue.pop();
+void LightSolver::solveRemove() {
+    while (!remqueue.empty()) {
+        const lightentry entry = remqueue.pop();
 
         for (int i = 0; i < 6; i++) {
             int imul3 = i*3;
-            int x = entry.x+coords[imul3];
-            int y = entry.y+coords[imul3+1];
-            int z = entry.z+coords[imul3+2];
-            
-            Chunk* chunk = chunks.getChunkByVoxel(x,y,z);
-            if (chunk) {
-                int lx = x - chunk->x * CHUNK_W;
-                int lz = z - chunk->z * CHUNK_D;
-                chunk->flags.modified = true;
-
-                ubyte light = chunk->lightmap.get(lx,y,lz, channel);
-                if (light != 0 && light == entry.light-1){
-                    voxel* vox = chunks.get(x, y, z);
-                    if (vox && vox->id != 0) {
-                        const Block* block = blockDefs[vox->id];
-                        if (uint8_t emission = block->emission[channel]) {
-                            addqueue.push(lightentry {x, y, z, emission});
-                            chunk->lightmap.set(lx, y, lz, channel, emission);
-                        }
-                        else chunk->lightmap.set(lx, y, lz, channel, 0);
-                    }
-                    else chunk->lightmap.set(lx, y, lz, channel, 0);
-                    remqueue.push(lightentry {x, y, z, light});
+            int x = entry.x+COORDS[imul3];
+            int y = entry.y+COORDS[imul3+1];
+            int z = entry.z+COORDS[imul3+2];
+            if (y < 0 || y >= CHUNK_H) {
+                continue;
+            }
+            Chunk* chunk = getChunk(floordiv<CHUNK_W>(x), floordiv<CHUNK_D>(z));
+            if (chunk == nullptr) {
+                continue;
+            }
+            chunk->setModified(y);
+
+            uint index = vox_index(
+                x - chunk->x * CHUNK_W, y, z - chunk->z * CHUNK_D
+            );
+            light_t light = chunk->lightmap.get(index);
+            light_t newLight = light;
+            light_t removed = 0;
+            light_t added = 0;
+            const Block* block = nullptr;
+            for (int c = 0; c < channelsCount; c++) {
+                int channel = channels[c];
+                int shift = channel << 2;
+                int entryLight = (entry.light >> shift) & 0xF;
+                if (entryLight == 0) {
+                    continue;
                 }
-                else if (light >= entry.light){
-                    addqueue.push(lightentry {x, y, z, light});
+                int value = (light >> shift) & 0xF;
+                if (value != 0 && value == entryLight - 1) {
+                    if (block == nullptr) {
+                        block = blockDefs[chunk->voxels.get(index).id];
+                    }
+                    int emission = block->emission[channel];
+                    newLight = (newLight & ~(0xF << shift)) | (emission << shift);
+                    added |= emission << shift;
+                    removed |= value << shift;
+                } else if (value >= entryLight) {
+                    added |= value << shift;
                 }
             }
+            if (newLight != light) {
+                chunk->lightmap.set(index, newLight);
+            }
+            if (removed) {
+                remqueue.push(lightentry {x, z, uint16_t(y), removed});
+            }
+            if (added) {
+                addqueue.push(lightentry {x, z, uint16_t(y), added});
+            }
         }
     }
+}
 
-    while (!addqueue.empty()){
-        const lightentry entry = addqueue.front();
-        addqueue.pop();
+void LightSolver::solveAdd() {
+    while (!addqueue.empty()) {
+        const lightentry entry = addqueue.pop();
 
         for (int i = 0; i < 6; i++) {
             int imul3 = i*3;
-            int x = entry.x+coords[imul3];
-            int y = entry.y+coords[imul3+1];
-            int z = entry.z+coords[imul3+2];
-
-            Chunk* chunk = chunks.getChunkByVoxel(x,y,z);
-            if (chunk) {
-                int lx = x - chunk->x * CHUNK_W;
-                int lz = z - chunk->z * CHUNK_D;
-                chunk->flags.modified = true;
-
-                ubyte light = chunk->lightmap.get(lx, y, lz, channel);
-                voxel& v = chunk->voxels[vox_index(lx, y, lz)];
-                const Block* block = blockDefs[v.id];
-                if (block->lightPassing && light+2 <= entry.light){
-                    chunk->lightmap.set(
-                        x-chunk->x*CHUNK_W, y, z-chunk->z*CHUNK_D, 
-                        channel, 
-                        entry.light-1);
-                    addqueue.push(lightentry {x, y, z, ubyte(entry.light-1)});
+            int x = entry.x+COORDS[imul3];
+            int y = entry.y+COORDS[imul3+1];
+            int z = entry.z+COORDS[imul3+2];
+            if (y < 0 || y >= CHUNK_H) {
+                continue;
+            }
+            Chunk* chunk = getChunk(floordiv<CHUNK_W>(x), floordiv<CHUNK_D>(z));
+            if (chunk == nullptr) {
+                continue;
+            }
+            chunk->setModified(y);
+
+            uint index = vox_index(
+                x - chunk->x * CHUNK_W, y, z - chunk->z * CHUNK_D
+            );
+            light_t light = chunk->lightmap.get(index);
+            light_t newLight = light;
+            light_t spread = 0;
+            for (int c = 0; c < channelsCount; c++) {
+                int shift = channels[c] << 2;
+                int entryLight = (entry.light >> shift) & 0xF;
+                if (((light >> shift) & 0xF) + 2 <= entryLight) {
+                    newLight = (newLight & ~(0xF << shift)) |
+                               ((entryLight - 1) << shift);
+                    spread |= (entryLight - 1) << shift;
                 }
             }
+            if (spread == 0) {
+                continue;
+            }
+            const Block* block = blockDefs[chunk->voxels.get(index).id];
+            if (!block->lightPassing) {
+                continue;
+            }
+            chunk->lightmap.set(index, newLight);
+            addqueue.push(lightentry {x, z, uint16_t(y), spread});
         }
     }
 }
+
+void LightSolver::validateAdded() {
+    for (size_t i = addqueue.size(); i > 0; i--) {
+        lightentry entry = addqueue.pop();
+        Chunk* chunk = getChunk(
+            floordiv<CHUNK_W>(entry.x), floordiv<CHUNK_D>(entry.z)
+        );
+        if (chunk == nullptr) {
+            continue;
+        }
+        light_t light = chunk->lightmap.get(vox_index(
+            entry.x - chunk->x * CHUNK_W, entry.y, entry.z - chunk->z * CHUNK_D
+        ));
+        light_t valid = 0;
+        for (int c = 0; c < channelsCount; c++) {
+            int shift = channels[c] << 2;
+            int value = std::min(
+                (entry.light >> shift) & 0xF, (light >> shift) & 0xF
+            );
+            valid |= value << shift;
+        }
+        if (valid) {
+            addqueue.push(lightentry {entry.x, entry.z, entry.y, valid});
+        }
+    }
+}
+
+void LightSolver::solve() {
+    if (!remqueue.empty()) {
+        solveRemove();
+        validateAdded();
+    }
+    solveAdd();
+
+    // chunks may be unloaded before the next use
+    centerValid = false;
+}
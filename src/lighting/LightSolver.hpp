@@ -1,29 +1,78 @@
 #pragma once
 
-#include <queue>
+#include <initializer_list>
 
+#include "typedefs.hpp"
+#include "util/RingBuffer.hpp"
+
+class Chunk;
 class Chunks;
 class ContentIndices;
 class Block;
 
+/// @brief Packed light propagation queue entry
 struct lightentry {
-    int x;
-    int y;
-    int z;
-    unsigned char light;
+    int32_t x;
+    int32_t z;
+    uint16_t y;
+    /// @brief Lights of solver channels (see Lightmap::combine)
+    light_t light;
 };
 
+/// @brief Light propagation (BFS) for a set of channels solved in one pass.
+/// Propagation of each channel is independent, entries just carry
+/// values of all channels
 class LightSolver {
-    std::queue<lightentry> addqueue;
-    std::queue<lightentry> remqueue;
+    util::RingBuffer<lightentry> addqueue;
+    util::RingBuffer<lightentry> remqueue;
     const Block* const* blockDefs;
     Chunks& chunks;
-    int channel;
+    /// @brief Channels bit mask of light_t
+    light_t mask;
+    /// @brief Channels indices
+    ubyte channels[4];
+    ubyte channelsCount = 0;
+
+    /// @brief Chunks 3x3 area around the last visited chunk
+    Chunk* neighbours[9] {};
+    int centerX = 0;
+    int centerZ = 0;
+    bool centerValid = false;
+
+    /// @brief Get chunk in the cached neighbourhood, moving it if needed
+    Chunk* getChunk(int cx, int cz);
+    /// @brief Get neighbour chunk of the current center
+    inline Chunk* getNeighbour(int cx, int cz) const {
+        return neighbours[(cz - centerZ + 1) * 3 + (cx - centerX + 1)];
+    }
+
+    void solveRemove();
+    /// @brief Clamp queued additions to the current lights.
+    /// Removal of several sources may zero a voxel already queued as a
+    /// boundary of another removal, so its entry would spread stale light
+    void validateAdded();
+    void solveAdd();
 public:
-    LightSolver(const ContentIndices& contentIds, Chunks& chunks, int channel);
+    /// @param channels list of channels indices (0 - R, 1 - G, 2 - B, 3 - S)
+    LightSolver(
+        const ContentIndices& contentIds,
+        Chunks& chunks,
+        std::initializer_list<int> channels
+    );
 
+    /// @brief Add voxel current light to propagation queue
     void add(int x, int y, int z);
-    void add(int x, int y, int z, int emission);
+
+    /// @brief Add light source to propagation queue
+    /// @param emission lights of the solver channels (see Lightmap::combine).
+    /// Channel is skipped if emission is lower than current light
+    void add(int x, int y, int z, light_t emission);
+
+    /// @brief Remove voxel light, queueing removal of the light it spread
     void remove(int x, int y, int z);
+
+    /// @brief Propagate queued removals and additions.
+    /// Cached chunks are released, so the solver may be used after
+    /// chunks are unloaded
     void solve();
 };
@@ -8,208 +8,367 @@
 #include "voxels/Block.hpp"
 #include "constants.hpp"
 #include "util/timeutil.hpp"
+#include "util/WorkerGroup.hpp"
 #include "debug/Logger.hpp"
 
+#include <algorithm>
+#include <cstdlib>
 #include <memory>
+#include <zlib.h>
 
 static debug::Logger logger("lighting");
 
 Lighting::Lighting(const Content& content, Chunks& chunks) 
   : content(content), chunks(chunks) {
-    auto& indices = *content.getIndices();
-    solverR = std::make_unique<LightSolver>(indices, chunks, 0);
-    solverG = std::make_unique<LightSolver>(indices, chunks, 1);
-    solverB = std::make_unique<LightSolver>(indices, chunks, 2);
-    solverS = std::make_unique<LightSolver>(indices, chunks, 3);
+    solvers.push_back(createSolvers());
 }
 
 Lighting::~Lighting() = default;
 
+Lighting::Solvers Lighting::createSolvers() const {
+    auto& indices = *content.getIndices();
+    return Solvers {
+        std::make_unique<LightSolver>(
+            indices, chunks, std::initializer_list<int> {0, 1, 2}
+        ),
+        std::make_unique<LightSolver>(
+            indices, chunks, std::initializer_list<int> {3}
+        )};
+}
+
+static constexpr light_t emission_rgb(const Block& block) {
+    return Lightmap::combine(
+        block.emission[0], block.emission[1], block.emission[2], 0
+    );
+}
+
 void Lighting::clear(){
     const auto& chunks = this->chunks.getChunks();
     for (size_t index = 0; index < chunks.size(); index++){
         auto chunk = chunks[index];
         if (chunk == nullptr)
             continue;
-        Lightmap& lightmap = chunk->lightmap;
-        for (int i = 0; i < CHUNK_VOL; i++){
-            lightmap.map[i] = 0;
-        }
+        chunk->lightmap.fill(0);
     }
 }
 
 void Lighting::prebuildSkyLight(Chunk& chunk, const ContentIndices& indices){
     const auto* blockDefs = indices.blocks.getDefs();
 
-    int highestPoint = 0;
+    bool passingSections[CHUNK_SECTIONS];
+    for (int i = 0; i < CHUNK_SECTIONS; i++) {
+        voxel vox;
+        passingSections[i] = chunk.voxels.getUniform(i, vox) &&
+                             blockDefs[vox.id]->skyLightPassing;
+    }
+    // lowest voxel lighted by the sky in each column
+    int heights[CHUNK_W * CHUNK_D];
+    int maxHeight = 0;
+    int minHeight = CHUNK_H;
     for (int z = 0; z < CHUNK_D; z++){
         for (int x = 0; x < CHUNK_W; x++){
-            for (int y = CHUNK_H-1; y >= 0; y--){
-                int index = (y * CHUNK_D + z) * CHUNK_W + x;
-                voxel& vox = chunk.voxels[index];
-                const Block* block = blockDefs[vox.id];
-                if (!block->skyLightPassing) {
-                    if (highestPoint < y)
-                        highestPoint = y;
+            int y = CHUNK_H-1;
+            while (y >= 0) {
+                if ((y + 1) % CHUNK_SECTION_H == 0 &&
+                    passingSections[y / CHUNK_SECTION_H]) {
+                    y -= CHUNK_SECTION_H;
+                    continue;
+                }
+                voxel vox = chunk.voxels.get(vox_index(x, y, z));
+                if (!blockDefs[vox.id]->skyLightPassing) {
                     break;
                 }
-                chunk.lightmap.setS(x,y,z, 15);
+                y--;
+            }
+            heights[z * CHUNK_W + x] = y + 1;
+            chunk.lightmap.setHeight(x, z, y + 1);
+            maxHeight = std::max(maxHeight, y + 1);
+            minHeight = std::min(minHeight, y + 1);
+        }
+    }
+    auto& lightmap = chunk.lightmap;
+    for (int i = CHUNK_SECTIONS-1; i >= 0; i--) {
+        int sectionBottom = i * CHUNK_SECTION_H;
+        int sectionTop = sectionBottom + CHUNK_SECTION_H;
+        light_t value;
+        if (sectionBottom >= maxHeight && lightmap.getUniform(i, value)) {
+            lightmap.fill(i, (value & 0x0FFF) | 0xF000);
+            continue;
+        }
+        if (sectionTop <= minHeight) {
+            break;
+        }
+        for (int z = 0; z < CHUNK_D; z++){
+            for (int x = 0; x < CHUNK_W; x++){
+                int height = std::max(heights[z * CHUNK_W + x], sectionBottom);
+                for (int y = height; y < sectionTop; y++) {
+                    lightmap.setS(x, y, z, 15);
+                }
             }
         }
     }
-    if (highestPoint < CHUNK_H-1)
-        highestPoint++;
-    chunk.lightmap.highestPoint = highestPoint;
 }
 
-void Lighting::buildSkyLight(int cx, int cz){
-    const auto blockDefs = content.getIndices()->blocks.getDefs();
+uint32_t Lighting::calculateContentHash(const ContentIndices& indices) {
+    uLong crc = crc32(0L, Z_NULL, 0);
+    const auto* blockDefs = indices.blocks.getDefs();
+    for (size_t id = 0; id < indices.blocks.count(); id++) {
+        const auto& def = *blockDefs[id];
+        ubyte props[] {
+            def.emission[0],
+            def.emission[1],
+            def.emission[2],
+            def.lightPassing,
+            def.skyLightPassing,
+        };
+        crc = crc32(
+            crc,
+            reinterpret_cast<const Bytef*>(def.name.data()),
+            def.name.size() + 1
+        );
+        crc = crc32(crc, props, sizeof(props));
+    }
+    return crc;
+}
 
+void Lighting::buildSkyLight(int cx, int cz){
     Chunk* chunk = chunks.getChunk(cx, cz);
     if (chunk == nullptr) {
         logger.error() << "attempted to build sky lights to chunk missing in local matrix";
         return;
     }
+    buildSkyLight(*chunk, *solvers[0].sky);
+}
+
+void Lighting::buildSkyLight(Chunk& chunkRef, LightSolver& solverS){
+    Chunk* chunk = &chunkRef;
+    int cx = chunk->x;
+    int cz = chunk->z;
+    // sections where all voxels sky light is too low to spread
+    bool darkSections[CHUNK_SECTIONS];
+    for (int i = 0; i < CHUNK_SECTIONS; i++) {
+        light_t value;
+        darkSections[i] = chunk->lightmap.getUniform(i, value) &&
+                          Lightmap::extract(value, 3) <= 1;
+    }
     for (int z = 0; z < CHUNK_D; z++){
         for (int x = 0; x < CHUNK_W; x++){
             int gx = x + cx * CHUNK_W;
             int gz = z + cz * CHUNK_D;
-            for (int y = chunk->lightmap.highestPoint; y >= 0; y--){
-                while (y > 0 && !blockDefs[chunk->voxels[vox_index(x, y, z)].id]->lightPassing) {
-                    y--;
-                }
-                if (chunk->lightmap.getS(x, y, z) != 15) {
-                    solverS->add(gx,y+1,gz);
-                    for (; y >= 0; y--){
-                        solverS->add(gx+1,y,gz);
-                        solverS->add(gx-1,y,gz);
-                        solverS->add(gx,y,gz+1);
-                        solverS->add(gx,y,gz-1);
-                    }
+            // neighbours of inner columns voxels are in the same section
+            bool inner = x > 0 && x < CHUNK_W-1 && z > 0 && z < CHUNK_D-1;
+            // voxels above the column height are lighted by prebuildSkyLight
+            int height = chunk->lightmap.getHeight(x, z);
+            solverS.add(gx,height,gz);
+            for (int y = height - 1; y >= 0; y--){
+                if (inner && darkSections[y / CHUNK_SECTION_H]) {
+                    y -= y % CHUNK_SECTION_H;
+                    continue;
                 }
+                solverS.add(gx+1,y,gz);
+                solverS.add(gx-1,y,gz);
+                solverS.add(gx,y,gz+1);
+                solverS.add(gx,y,gz-1);
             }
         }
     }
-    solverS->solve();
+    solverS.solve();
 }
 
 
 void Lighting::onChunkLoaded(int cx, int cz, bool expand) {
-    auto& solverR = *this->solverR;
-    auto& solverG = *this->solverG;
-    auto& solverB = *this->solverB;
-    auto& solverS = *this->solverS;
-
-    auto blockDefs = content.getIndices()->blocks.getDefs();
     auto chunk = chunks.getChunk(cx, cz);
     if (chunk == nullptr) {
         logger.error() << "attempted to build lights to chunk missing in local matrix";
         return;
     }
+    onChunkLoaded(*chunk, solvers[0], expand);
+}
+
+void Lighting::onChunkLoaded(Chunk& chunkRef, Solvers& solvers, bool expand) {
+    auto& solverRGB = *solvers.rgb;
+    auto& solverS = *solvers.sky;
+
+    auto blockDefs = content.getIndices()->blocks.getDefs();
+    Chunk* chunk = &chunkRef;
+    int cx = chunk->x;
+    int cz = chunk->z;
     for (uint y = 0; y < CHUNK_H; y++){
+        voxel uniform;
+        if (y % CHUNK_SECTION_H == 0 &&
+            chunk->voxels.getUniform(y / CHUNK_SECTION_H, uniform) &&
+            !blockDefs[uniform.id]->rt.emissive) {
+            y += CHUNK_SECTION_H - 1;
+            continue;
+        }
         for (uint z = 0; z < CHUNK_D; z++){
             for (uint x = 0; x < CHUNK_W; x++){
-                const voxel& vox = chunk->voxels[(y * CHUNK_D + z) * CHUNK_W + x];
+                voxel vox = chunk->voxels.get((y * CHUNK_D + z) * CHUNK_W + x);
                 const Block* block = blockDefs[vox.id];
                 int gx = x + cx * CHUNK_W;
                 int gz = z + cz * CHUNK_D;
                 if (block->rt.emissive){
-                    solverR.add(gx,y,gz,block->emission[0]);
-                    solverG.add(gx,y,gz,block->emission[1]);
-                    solverB.add(gx,y,gz,block->emission[2]);
+                    solverRGB.add(gx,y,gz, emission_rgb(*block));
                 }
             }
         }
     }
 
     if (expand) {
+        auto isDark = [chunk](int y) {
+            light_t value;
+            return chunk->lightmap.getUniform(y / CHUNK_SECTION_H, value) &&
+                   value == 0;
+        };
         for (int x = 0; x < CHUNK_W; x += CHUNK_W-1) {
             for (int y = 0; y < CHUNK_H; y++) {
+                if (y % CHUNK_SECTION_H == 0 && isDark(y)) {
+                    y += CHUNK_SECTION_H - 1;
+                    continue;
+                }
                 for (int z = 0; z < CHUNK_D; z++) {
                     int gx = x + cx * CHUNK_W;
                     int gz = z + cz * CHUNK_D;
                     int rgbs = chunk->lightmap.get(x, y, z);
                     if (rgbs){
-                        solverR.add(gx,y,gz, Lightmap::extract(rgbs, 0));
-                        solverG.add(gx,y,gz, Lightmap::extract(rgbs, 1));
-                        solverB.add(gx,y,gz, Lightmap::extract(rgbs, 2));
-                        solverS.add(gx,y,gz, Lightmap::extract(rgbs, 3));
+                        solverRGB.add(gx,y,gz, rgbs);
+                        solverS.add(gx,y,gz, rgbs);
                     }
                 }
             }
         }
         for (int z = 0; z < CHUNK_D; z += CHUNK_D-1) {
             for (int y = 0; y < CHUNK_H; y++) {
+                if (y % CHUNK_SECTION_H == 0 && isDark(y)) {
+                    y += CHUNK_SECTION_H - 1;
+                    continue;
+                }
                 for (int x = 0; x < CHUNK_W; x++) {
                     int gx = x + cx * CHUNK_W;
                     int gz = z + cz * CHUNK_D;
                     int rgbs = chunk->lightmap.get(x, y, z);
                     if (rgbs){
-                        solverR.add(gx,y,gz, Lightmap::extract(rgbs, 0));
-                        solverG.add(gx,y,gz, Lightmap::extract(rgbs, 1));
-                        solverB.add(gx,y,gz, Lightmap::extract(rgbs, 2));
-                        solverS.add(gx,y,gz, Lightmap::extract(rgbs, 3));
+                        solverRGB.add(gx,y,gz, rgbs);
+                        solverS.add(gx,y,gz, rgbs);
                     }
                 }
             }
         }
     }
-    solverR.solve();
-    solverG.solve();
-    solverB.solve();
+    solverRGB.solve();
     solverS.solve();
 }
 
+void Lighting::buildLights(Chunk& chunk, Solvers& solvers) {
+    bool lightsCache = chunk.flags.loadedLights;
+    if (!lightsCache) {
+        buildSkyLight(chunk, *solvers.sky);
+    }
+    onChunkLoaded(chunk, solvers, !lightsCache);
+}
+
+void Lighting::buildLights(
+    const std::vector<Chunk*>& chunks, util::WorkerGroup& workers
+) {
+    while (solvers.size() < workers.getWorkersCount()) {
+        solvers.push_back(createSolvers());
+    }
+    std::vector<Chunk*> remaining = chunks;
+    std::vector<Chunk*> wave;
+    std::vector<Chunk*> next;
+    while (!remaining.empty()) {
+        wave.clear();
+        next.clear();
+        for (auto chunk : remaining) {
+            // 3x3 neighbourhoods must not intersect
+            bool independent = std::all_of(
+                wave.begin(), wave.end(), [chunk](const Chunk* other) {
+                    return std::abs(chunk->x - other->x) > 2 ||
+                           std::abs(chunk->z - other->z) > 2;
+                }
+            );
+            (independent ? wave : next).push_back(chunk);
+        }
+        workers.run(wave.size(), [this, &wave](size_t index, uint worker) {
+            buildLights(*wave[index], solvers[worker]);
+        });
+        std::swap(remaining, next);
+    }
+}
+
 void Lighting::onBlockSet(int x, int y, int z, blockid_t id){
+    auto& solverRGB = *solvers[0].rgb;
+    auto& solverS = *solvers[0].sky;
     const auto& block = content.getIndices()->blocks.require(id);
-    solverR->remove(x,y,z);
-    solverG->remove(x,y,z);
-    solverB->remove(x,y,z);
-
-    if (id == 0){
-        solverR->solve();
-        solverG->solve();
-        solverB->solve();
-        if (chunks.getLight(x,y+1,z, 3) == 0xF){
-            for (int i = y; i >= 0; i--){
-                voxel* vox = chunks.get(x,i,z);
-                if ((vox == nullptr || vox->id != 0) && block.skyLightPassing)
-                    break;
-                solverS->add(x,i,z, 0xF);
-            }
+    solverRGB.remove(x,y,z);
+
+    if (!block.skyLightPassing){
+        // only voxels lighted by the sky directly have max sky light
+        solverS.remove(x,y,z);
+        for (int i = y-1; i >= 0 && chunks.getLight(x,i,z, 3) == 0xF; i--){
+            solverS.remove(x,i,z);
         }
-        solverR->add(x,y+1,z); solverG->add(x,y+1,z); solverB->add(x,y+1,z); solverS->add(x,y+1,z);
-        solverR->add(x,y-1,z); solverG->add(x,y-1,z); solverB->add(x,y-1,z); solverS->add(x,y-1,z);
-        solverR->add(x+1,y,z); solverG->add(x+1,y,z); solverB->add(x+1,y,z); solverS->add(x+1,y,z);
-        solverR->add(x-1,y,z); solverG->add(x-1,y,z); solverB->add(x-1,y,z); solverS->add(x-1,y,z);
-        solverR->add(x,y,z+1); solverG->add(x,y,z+1); solverB->add(x,y,z+1); solverS->add(x,y,z+1);
-        solverR->add(x,y,z-1); solverG->add(x,y,z-1); solverB->add(x,y,z-1); solverS->add(x,y,z-1);
-        solverR->solve();
-        solverG->solve();
-        solverB->solve();
-        solverS->solve();
-    } else {
-        if (!block.skyLightPassing){
-            solverS->remove(x,y,z);
-            for (int i = y-1; i >= 0; i--){
-                solverS->remove(x,i,z);
-                if (i == 0 || chunks.get(x,i-1,z)->id != 0){
-                    break;
-                }
+    }
+    changes.emplace_back(x, y, z);
+    if (batchDepth == 0) {
+        solveChanges();
+    }
+}
+
+void Lighting::beginBatch() {
+    batchDepth++;
+}
+
+void Lighting::endBatch() {
+    if (--batchDepth == 0 && !changes.empty()) {
+        solveChanges();
+    }
+}
+
+void Lighting::solveChanges() {
+    auto& solverRGB = *solvers[0].rgb;
+    auto& solverS = *solvers[0].sky;
+    // all removals are queued by onBlockSet, so lights are removed
+    // before the new ones are spread from any of the changed blocks
+    solverRGB.solve();
+    solverS.solve();
+
+    const auto& blocks = content.getIndices()->blocks;
+    for (const auto& pos : changes) {
+        int x = pos.x;
+        int y = pos.y;
+        int z = pos.z;
+        // block may be changed again later in the batch
+        Chunk* chunk = chunks.getChunkByVoxel(x, y, z);
+        if (chunk == nullptr) {
+            continue;
+        }
+        int lx = x - chunk->x * CHUNK_W;
+        int lz = z - chunk->z * CHUNK_D;
+        const auto& block =
+            blocks.require(chunk->voxels.get(vox_index(lx, y, lz)).id);
+        if (block.skyLightPassing) {
+            // column part opened by the change (see blocks_agent::set),
+            // stopping at the part lighted by another change
+            const auto& lightmap = chunk->lightmap;
+            int height = lightmap.getHeight(lx, lz);
+            for (int i = y; i >= height && lightmap.getS(lx, i, lz) != 0xF; i--) {
+                solverS.add(x,i,z, Lightmap::combine(0, 0, 0, 0xF));
             }
-            solverS->solve();
         }
-        solverR->solve();
-        solverG->solve();
-        solverB->solve();
-
+        if (block.lightPassing) {
+            solverRGB.add(x,y+1,z); solverS.add(x,y+1,z);
+            solverRGB.add(x,y-1,z); solverS.add(x,y-1,z);
+            solverRGB.add(x+1,y,z); solverS.add(x+1,y,z);
+            solverRGB.add(x-1,y,z); solverS.add(x-1,y,z);
+            solverRGB.add(x,y,z+1); solverS.add(x,y,z+1);
+            solverRGB.add(x,y,z-1); solverS.add(x,y,z-1);
+        }
         if (block.emission[0] || block.emission[1] || block.emission[2]){
-            solverR->add(x,y,z,block.emission[0]);
-            solverG->add(x,y,z,block.emission[1]);
-            solverB->add(x,y,z,block.emission[2]);
-            solverR->solve();
-            solverG->solve();
-            solverB->solve();
+            solverRGB.add(x,y,z, emission_rgb(block));
         }
     }
+    changes.clear();
+    solverRGB.solve();
+    solverS.solve();
 }
@@ -1,5 +1,9 @@
 #pragma once
 
+#include <memory>
+#include <vector>
+#include <glm/glm.hpp>
+
 #include "typedefs.hpp"
 
 class Content;
@@ -8,13 +12,33 @@ class Chunk;
 class Chunks;
 class LightSolver;
 
+namespace util {
+    class WorkerGroup;
+}
+
 class Lighting {
+    /// @brief Light solvers used by a single thread
+    struct Solvers {
+        /// @brief Solver of R, G, B channels
+        std::unique_ptr<LightSolver> rgb;
+        /// @brief Solver of sky light channel
+        std::unique_ptr<LightSolver> sky;
+    };
     const Content& content;
     Chunks& chunks;
-    std::unique_ptr<LightSolver> solverR;
-    std::unique_ptr<LightSolver> solverG;
-    std::unique_ptr<LightSolver> solverB;
-    std::unique_ptr<LightSolver> solverS;
+    /// @brief Solvers of workers, the first ones are used by the main thread
+    std::vector<Solvers> solvers;
+    /// @brief Positions of blocks set since the last lights update
+    std::vector<glm::ivec3> changes;
+    /// @brief Number of unfinished beginBatch calls
+    int batchDepth = 0;
+
+    Solvers createSolvers() const;
+    void buildSkyLight(Chunk& chunk, LightSolver& solverS);
+    void onChunkLoaded(Chunk& chunk, Solvers& solvers, bool expand);
+    void buildLights(Chunk& chunk, Solvers& solvers);
+    /// @brief Spread lights around the changed blocks
+    void solveChanges();
 public:
     Lighting(const Content& content, Chunks& chunks);
     ~Lighting();
@@ -22,7 +46,62 @@ public:
     void clear();
     void buildSkyLight(int cx, int cz);
     void onChunkLoaded(int cx, int cz, bool expand);
+
+    /// @brief Build lights of loaded chunks having all neighbours present.
+    /// Chunk lights spread to its neighbours only, so chunks are split into
+    /// waves of chunks with no common neighbours lighted in parallel.
+    /// Waves are formed in the chunks order, so the result does not depend
+    /// on the number of workers
+    /// @param chunks chunks to light (flags are not changed)
+    /// @param workers workers group, chunks matrix must not be modified
+    /// until the function returns
+    void buildLights(
+        const std::vector<Chunk*>& chunks, util::WorkerGroup& workers
+    );
+
+    /// @brief Update lights after the block is set.
+    /// Lights are solved immediately if there is no active batch
     void onBlockSet(int x, int y, int z, blockid_t id);
 
+    /// @brief Start batch of block changes. Lights of all blocks set until
+    /// the matching endBatch are solved together with one propagation.
+    /// Batches may be nested. Chunks must not be unloaded during a batch
+    void beginBatch();
+
+    /// @brief Finish batch of block changes, solving lights if it is the
+    /// outermost one
+    void endBatch();
+
     static void prebuildSkyLight(Chunk& chunk, const ContentIndices& indices);
+
+    /// @brief Calculate hash of blocks properties lights depend on.
+    /// Cached lights built with another content hash are stale
+    static uint32_t calculateContentHash(const ContentIndices& indices);
+};
+
+/// @brief Lighting batch finished when the scope is left (including
+/// errors). Must be ended before scripts may see the changed blocks
+class LightingBatch {
+    Lighting* lighting;
+public:
+    /// @param lighting may be nullptr
+    LightingBatch(Lighting* lighting) : lighting(lighting) {
+        if (lighting) {
+            lighting->beginBatch();
+        }
+    }
+
+    LightingBatch(const LightingBatch&) = delete;
+
+    ~LightingBatch() {
+        end();
+    }
+
+    /// @brief Finish the batch before leaving the scope
+    void end() {
+        if (lighting) {
+            lighting->endBatch();
+            lighting = nullptr;
+        }
+    }
 };
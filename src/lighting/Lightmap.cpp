@@ -2,23 +2,130 @@
 
 #include "util/data_io.hpp"
 
+#include <algorithm>
 #include <cassert>
 #include <cstring>
+#include <iterator>
+
+light_t* Lightmap::allocate(uint sectionIndex) {
+    auto& section = sections[sectionIndex];
+    auto buffer = std::make_unique<light_t[]>(CHUNK_SECTION_VOL);
+    std::fill_n(
+        buffer.get(),
+        CHUNK_SECTION_VOL,
+        section.value.load(std::memory_order_relaxed)
+    );
+    light_t* lights = buffer.get();
+    buffers[sectionIndex] = std::move(buffer);
+    section.lights.store(lights, std::memory_order_release);
+    return lights;
+}
 
 void Lightmap::set(const Lightmap* lightmap) {
-    set(lightmap->map);
+    std::copy(std::begin(lightmap->heights), std::end(lightmap->heights), heights);
+    for (uint i = 0; i < CHUNK_SECTIONS; i++) {
+        light_t value;
+        if (lightmap->getUniform(i, value)) {
+            fill(i, value);
+            continue;
+        }
+        auto lights = sections[i].lights.load(std::memory_order_relaxed);
+        if (lights == nullptr) {
+            lights = allocate(i);
+        }
+        std::memcpy(
+            lights,
+            lightmap->sections[i].lights.load(std::memory_order_acquire),
+            sizeof(light_t) * CHUNK_SECTION_VOL
+        );
+    }
 }
 
 void Lightmap::set(const light_t* map) {
-    std::memcpy(this->map, map, sizeof(light_t) * CHUNK_VOL);
+    for (uint i = 0; i < CHUNK_SECTIONS; i++) {
+        const light_t* src = map + i * CHUNK_SECTION_VOL;
+        auto lights = sections[i].lights.load(std::memory_order_relaxed);
+        if (lights == nullptr) {
+            bool uniform = std::all_of(
+                src + 1,
+                src + CHUNK_SECTION_VOL,
+                [value = src[0]](light_t light) { return light == value; }
+            );
+            if (uniform) {
+                sections[i].value.store(src[0], std::memory_order_relaxed);
+                continue;
+            }
+            lights = allocate(i);
+        }
+        std::memcpy(lights, src, sizeof(light_t) * CHUNK_SECTION_VOL);
+    }
+}
+
+void Lightmap::fill(uint sectionIndex, light_t value) {
+    auto& section = sections[sectionIndex];
+    if (auto lights = section.lights.load(std::memory_order_relaxed)) {
+        // section array may be in use by other threads
+        std::fill_n(lights, CHUNK_SECTION_VOL, value);
+    } else {
+        section.value.store(value, std::memory_order_relaxed);
+    }
+}
+
+void Lightmap::fill(light_t value) {
+    for (uint i = 0; i < CHUNK_SECTIONS; i++) {
+        fill(i, value);
+    }
+}
+
+void Lightmap::read(light_t* dst) const {
+    for (uint i = 0; i < CHUNK_SECTIONS; i++) {
+        light_t* sectionDst = dst + i * CHUNK_SECTION_VOL;
+        light_t value;
+        if (getUniform(i, value)) {
+            std::fill_n(sectionDst, CHUNK_SECTION_VOL, value);
+        } else {
+            std::memcpy(
+                sectionDst,
+                sections[i].lights.load(std::memory_order_acquire),
+                sizeof(light_t) * CHUNK_SECTION_VOL
+            );
+        }
+    }
+}
+
+size_t Lightmap::getMemoryUsage() const {
+    size_t size = 0;
+    for (const auto& buffer : buffers) {
+        if (buffer) {
+            size += sizeof(light_t) * CHUNK_SECTION_VOL;
+        }
+    }
+    return size;
 }
 
 static_assert(sizeof(light_t) == 2, "replace dataio calls to new light_t");
+static_assert(CHUNK_SECTION_VOL % 2 == 0);
 
 std::unique_ptr<ubyte[]> Lightmap::encode() const {
-    auto buffer = std::make_unique<ubyte[]>(LIGHTMAP_DATA_LEN);
-    for (uint i = 0; i < CHUNK_VOL; i+=2) {
-        buffer[i/2] = ((map[i] >> 12) & 0xF) | ((map[i+1] >> 8) & 0xF0);
+    auto buffer = std::make_unique<ubyte[]>(
+        LIGHTMAP_DATA_LEN + LIGHTMAP_HEIGHTS_LEN
+    );
+    for (uint s = 0; s < CHUNK_SECTIONS; s++) {
+        ubyte* dst = buffer.get() + s * CHUNK_SECTION_VOL / 2;
+        light_t value;
+        if (getUniform(s, value)) {
+            ubyte sky = (value >> 12) & 0xF;
+            std::memset(dst, sky | (sky << 4), CHUNK_SECTION_VOL / 2);
+            continue;
+        }
+        const light_t* map = sections[s].lights.load(std::memory_order_acquire);
+        for (uint i = 0; i < CHUNK_SECTION_VOL; i+=2) {
+            dst[i/2] = ((map[i] >> 12) & 0xF) | ((map[i+1] >> 8) & 0xF0);
+        }
+    }
+    ubyte* heightsDst = buffer.get() + LIGHTMAP_DATA_LEN;
+    for (uint i = 0; i < CHUNK_W * CHUNK_D; i++) {
+        dataio::write_int16_big(heights[i], heightsDst, i * 2);
     }
     return buffer;
 }
@@ -29,6 +136,12 @@ std::unique_ptr<light_t[]> Lightmap::decode(const ubyte* buffer) {
         ubyte b = buffer[i/2];
         lights[i] = ((b & 0xF) << 12);
         lights[i+1] = ((b & 0xF0) << 8);
-    } 
+    }
     return lights;
 }
+
+void Lightmap::decodeHeights(const ubyte* buffer) {
+    for (uint i = 0; i < CHUNK_W * CHUNK_D; i++) {
+        heights[i] = dataio::read_int16_big(buffer, i * 2);
+    }
+}
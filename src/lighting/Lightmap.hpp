@@ -3,75 +3,145 @@
 #include "constants.hpp"
 #include "typedefs.hpp"
 
+#include <atomic>
 #include <memory>
 
 inline constexpr int LIGHTMAP_DATA_LEN = CHUNK_VOL/2;
-
-// Lichtkarte
+inline constexpr int LIGHTMAP_HEIGHTS_LEN = CHUNK_W*CHUNK_D*2;
+
+/// @brief Chunk lights split into CHUNK_SECTIONS sections. Section is stored
+/// as a single light value until a different value is set in it.
+///
+/// Lights may be read by other threads while the chunk is lighted
+/// by the main thread, so allocated sections are kept until the lightmap
+/// is destroyed
 class Lightmap {
+    struct Section {
+        /// @brief Section lights (nullptr if section is uniform)
+        std::atomic<light_t*> lights {nullptr};
+        /// @brief Value of all section lights used if there is no array
+        std::atomic<light_t> value {0};
+    };
+    Section sections[CHUNK_SECTIONS];
+    std::unique_ptr<light_t[]> buffers[CHUNK_SECTIONS];
+    /// @brief Height of the sky lighted part of each column
+    uint16_t heights[CHUNK_W * CHUNK_D] {};
+
+    light_t* allocate(uint sectionIndex);
 public:
-    light_t map[CHUNK_VOL] {};
-    int highestPoint = 0;
+    Lightmap() = default;
+    Lightmap(const Lightmap&) = delete;
 
     void set(const Lightmap* lightmap);
 
+    /// @param map CHUNK_VOL lights
     void set(const light_t* map);
 
+    /// @brief Set all section lights to the value
+    void fill(uint sectionIndex, light_t value);
+
+    /// @brief Set all lights to the value
+    void fill(light_t value);
+
+    /// @brief Copy all lights
+    /// @param dst CHUNK_VOL lights
+    void read(light_t* dst) const;
+
+    /// @brief Check if section is stored as a single light value
+    /// @param value [out] value of all section lights
+    bool getUniform(uint sectionIndex, light_t& value) const {
+        const auto& section = sections[sectionIndex];
+        if (section.lights.load(std::memory_order_acquire)) {
+            return false;
+        }
+        value = section.value.load(std::memory_order_relaxed);
+        return true;
+    }
+
+    /// @brief Get height of the sky lighted part of the column:
+    /// y of the highest block not passing sky light + 1
+    /// (0 if there is no such block)
+    inline int getHeight(int x, int z) const {
+        return heights[z * CHUNK_W + x];
+    }
+
+    inline void setHeight(int x, int z, int height) {
+        heights[z * CHUNK_W + x] = height;
+    }
+
+    /// @return bytes used by sections data
+    size_t getMemoryUsage() const;
+
+    /// @brief Get light by index (see vox_index)
+    inline light_t get(uint index) const {
+        const auto& section = sections[index / CHUNK_SECTION_VOL];
+        if (auto lights = section.lights.load(std::memory_order_acquire)) {
+            return lights[index % CHUNK_SECTION_VOL];
+        }
+        return section.value.load(std::memory_order_relaxed);
+    }
+
+    /// @brief Set light by index (see vox_index)
+    inline void set(uint index, light_t value) {
+        uint sectionIndex = index / CHUNK_SECTION_VOL;
+        auto& section = sections[sectionIndex];
+        auto lights = section.lights.load(std::memory_order_relaxed);
+        if (lights == nullptr) {
+            if (section.value.load(std::memory_order_relaxed) == value) {
+                return;
+            }
+            lights = allocate(sectionIndex);
+        }
+        lights[index % CHUNK_SECTION_VOL] = value;
+    }
+
     inline unsigned short get(int x, int y, int z) const {
-        return (map[y*CHUNK_D*CHUNK_W+z*CHUNK_W+x]);
+        return get(y*CHUNK_D*CHUNK_W+z*CHUNK_W+x);
     }
 
     inline unsigned char get(int x, int y, int z, int channel) const {
-        return (map[y*CHUNK_D*CHUNK_W+z*CHUNK_W+x] >> (channel << 2)) & 0xF;
+        return (get(x, y, z) >> (channel << 2)) & 0xF;
     }
 
     inline unsigned char getR(int x, int y, int z) const {
-        return map[y*CHUNK_D*CHUNK_W+z*CHUNK_W+x] & 0xF;
+        return get(x, y, z) & 0xF;
     }
 
     inline unsigned char getG(int x, int y, int z) const {
-        return (map[y*CHUNK_D*CHUNK_W+z*CHUNK_W+x] >> 4) & 0xF;
+        return (get(x, y, z) >> 4) & 0xF;
     }
 
     inline unsigned char getB(int x, int y, int z) const {
-        return (map[y*CHUNK_D*CHUNK_W+z*CHUNK_W+x] >> 8) & 0xF;
+        return (get(x, y, z) >> 8) & 0xF;
     }
 
     inline unsigned char getS(int x, int y, int z) const {
-        return (map[y*CHUNK_D*CHUNK_W+z*CHUNK_W+x] >> 12) & 0xF;
+        return (get(x, y, z) >> 12) & 0xF;
     }
 
     inline void setR(int x, int y, int z, int value){
         const int index = y*CHUNK_D*CHUNK_W+z*CHUNK_W+x;
-        map[index] = (map[index] & 0xFFF0) | value;
+        set(index, (get(index) & 0xFFF0) | value);
     }
 
     inline void setG(int x, int y, int z, int value){
         const int index = y*CHUNK_D*CHUNK_W+z*CHUNK_W+x;
-        map[index] = (map[index] & 0xFF0F) | (value << 4);
+        set(index, (get(index) & 0xFF0F) | (value << 4));
     }
 
     inline void setB(int x, int y, int z, int value){
         const int index = y*CHUNK_D*CHUNK_W+z*CHUNK_W+x;
-        map[index] = (map[index] & 0xF0FF) | (value << 8);
+        set(index, (get(index) & 0xF0FF) | (value << 8));
     }
 
     inline void setS(int x, int y, int z, int value){
         const int index = y*CHUNK_D*CHUNK_W+z*CHUNK_W+x;
-        map[index] = (map[index] & 0x0FFF) | (value << 12);
+        set(index, (get(index) & 0x0FFF) | (value << 12));
     }
 
     inline void set(int x, int y, int z, int channel, int value){
         const int index = y*CHUNK_D*CHUNK_W+z*CHUNK_W+x;
-        map[index] = (map[index] & (0xFFFF & (~(0xF << (channel*4))))) | (value << (channel << 2));
-    }
-
-    inline const light_t* getLights() const {
-        return map;
-    }
-
-    inline light_t* getLightsWriteable() {
-        return map;
+        set(index, (get(index) & (0xFFFF & (~(0xF << (channel*4))))) | (value << (channel << 2)));
     }
 
     static constexpr light_t combine(int r, int g, int b, int s) {
@@ -82,6 +152,15 @@ public:
         return (light >> (channel << 2)) & 0xF;
     }
 
+    /// @brief Encode sky lights followed by columns heights
+    /// @return LIGHTMAP_DATA_LEN + LIGHTMAP_HEIGHTS_LEN bytes
     std::unique_ptr<ubyte[]> encode() const;
+
+    /// @brief Decode sky lights
+    /// @param buffer LIGHTMAP_DATA_LEN bytes
     static std::unique_ptr<light_t[]> decode(const ubyte* buffer);
+
+    /// @brief Set columns heights from encoded data
+    /// @param buffer LIGHTMAP_HEIGHTS_LEN bytes following the lights
+    void decodeHeights(const ubyte* buffer);
 };
@@ -1,7 +1,5 @@
 #include "BlocksController.hpp"
 
-#include <set>
-
 #include "content/Content.hpp"
 #include "items/Inventories.hpp"
 #include "items/Inventory.hpp"
@@ -12,6 +10,7 @@
 #include "voxels/Block.hpp"
 #include "voxels/Chunk.hpp"
 #include "voxels/Chunks.hpp"
+#include "voxels/GlobalChunks.hpp"
 #include "voxels/voxel.hpp"
 #include "voxels/blocks_agent.hpp"
 #include "world/Level.hpp"
@@ -38,7 +37,7 @@ void BlocksController::updateSides(int x, int y, int z) {
 }
 
 void BlocksController::updateSides(int x, int y, int z, int w, int h, int d) {
-    voxel* vox = blocks_agent::get(chunks, x, y, z);
+    const voxel* vox = blocks_agent::get(chunks, x, y, z);
     const auto& def = level.content.getIndices()->blocks.require(vox->id);
     const auto& rot = def.rotations.variants[vox->state.rotation];
     const auto& xaxis = rot.axes[0];
@@ -104,7 +103,7 @@ void BlocksController::placeBlock(
 }
 
 void BlocksController::updateBlock(int x, int y, int z) {
-    voxel* vox = blocks_agent::get(chunks, x, y, z);
+    const voxel* vox = blocks_agent::get(chunks, x, y, z);
     if (vox == nullptr) return;
     const auto& def = level.content.getIndices()->blocks.require(vox->id);
     if (def.grounded) {
@@ -154,7 +153,7 @@ void BlocksController::randomTick(
             int bx = random.rand() % CHUNK_W;
             int by = random.rand() % segheight + s * segheight;
             int bz = random.rand() % CHUNK_D;
-            const voxel& vox = chunk.voxels[vox_index(bx, by, bz)];
+            voxel vox = chunk.voxels.get(vox_index(bx, by, bz));
             auto& block = indices->blocks.require(vox.id);
             if (block.rt.funcsset.randupdate) {
                 scripting::random_update_block(
@@ -168,41 +167,39 @@ void BlocksController::randomTick(
     }
 }
 
-void BlocksController::randomTick(int tickid, int parts, uint padding) {
-    auto indices = level.content.getIndices();
-
-    std::set<uint64_t> chunksIterated;
-
-    for (const auto& [pid, player] : *level.players) {
+/// @return true if the chunk is in any player area excluding padding
+static bool is_in_players_areas(
+    const Players& players, int x, int z, uint padding
+) {
+    int pad = static_cast<int>(padding);
+    for (const auto& [_, player] : players) {
         const auto& chunks = *player->chunks;
-        int offsetX = chunks.getOffsetX();
-        int offsetY = chunks.getOffsetY();
-        int width = chunks.getWidth();
-        int height = chunks.getHeight();
-        int segments = 4;
+        int lx = x - chunks.getOffsetX();
+        int lz = z - chunks.getOffsetY();
+        if (lx >= pad && lx < chunks.getWidth() - pad && lz >= pad &&
+            lz < chunks.getHeight() - pad) {
+            return true;
+        }
+    }
+    return false;
+}
 
-        for (uint z = padding; z < height - padding; z++) {
-            for (uint x = padding; x < width - padding; x++) {
-                int index = z * width + x;
-                if ((index + tickid) % parts != 0) {
-                    continue;
-                }
-                auto& chunk = chunks.getChunks()[index];
-                if (chunk == nullptr || !chunk->flags.lighted) {
-                    continue;
-                }
-                union {
-                    int32_t pos[2];
-                    uint64_t key;
-                } posU;
-                posU.pos[0] = x + offsetX;
-                posU.pos[1] = z + offsetY;
-                if (chunksIterated.find(posU.key) != chunksIterated.end()) {
-                    continue;
-                }
-                chunksIterated.insert(posU.key);
-                randomTick(*chunk, segments, indices);
-            }
+void BlocksController::randomTick(int tickid, int parts, uint padding) {
+    auto indices = level.content.getIndices();
+    int segments = 4;
+    uint index = 0;
+    // scripts may unload chunks while ticking, so chunks are looked up
+    // by position before each tick
+    std::vector<glm::ivec2> tickedChunks;
+    chunks.forEachTicketed([&](Chunk& chunk) {
+        if ((index++ + tickid) % parts == 0 && chunk.flags.lighted &&
+            is_in_players_areas(*level.players, chunk.x, chunk.z, padding)) {
+            tickedChunks.emplace_back(chunk.x, chunk.z);
+        }
+    });
+    for (const auto& pos : tickedChunks) {
+        if (auto chunk = chunks.getChunk(pos.x, pos.y)) {
+            randomTick(*chunk, segments, indices);
         }
     }
 }
@@ -219,7 +216,7 @@ int64_t BlocksController::createBlockInventory(int x, int y, int z) {
     auto inv = chunk->getBlockInventory(lx, y, lz);
     if (inv == nullptr) {
         const auto& indices = level.content.getIndices()->blocks;
-        auto& def = indices.require(chunk->voxels[vox_index(lx, y, lz)].id);
+        auto& def = indices.require(chunk->voxels.get(vox_index(lx, y, lz)).id);
         int invsize = def.inventorySize;
         if (invsize == 0) {
             return 0;
@@ -45,10 +45,14 @@ public:
         Player* player, const Block& def, blockstate state, int x, int y, int z
     );
 
+    /// @param padding number of players areas border chunks that are not
+    /// random ticked
     void update(float delta, uint padding);
     void randomTick(
         const Chunk& chunk, int segments, const ContentIndices* indices
     );
+    /// @brief Random tick a part of lighted chunks of players areas
+    /// excluding padding. Chunks shared by several players are ticked once
     void randomTick(int tickid, int parts, uint padding);
     void onBlocksTick(int tickid, int parts);
     int64_t createBlockInventory(int x, int y, int z);
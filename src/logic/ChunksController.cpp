@@ -2,6 +2,7 @@
 
 #include <limits.h>
 #include <memory>
+#include <queue>
 
 #include "content/Content.hpp"
 #include "files/WorldFiles.hpp"
@@ -9,7 +10,9 @@
 #include "lighting/Lighting.hpp"
 #include "maths/voxmaths.hpp"
 #include "util/timeutil.hpp"
+#include "util/WorkerGroup.hpp"
 #include "objects/Player.hpp"
+#include "objects/Players.hpp"
 #include "voxels/Block.hpp"
 #include "voxels/Chunk.hpp"
 #include "voxels/Chunks.hpp"
@@ -20,20 +23,64 @@
 
 const uint MAX_WORK_PER_FRAME = 128;
 const uint MIN_SURROUNDING = 9;
+/// @brief Max number of generating chunks per generator worker
+const uint MAX_PENDING_PER_WORKER = 4;
+/// @brief Max number of chunks lighted at once per lighting worker
+const uint MAX_LIGHTING_PER_WORKER = 2;
+/// @brief Number of missing chunks compared by view direction per
+/// free generator slot
+const uint CANDIDATES_PER_SLOT = 4;
+/// @brief Max number of incomplete cells checked per loadVisible call
+const uint MAX_VISITED_CELLS = 1024;
+/// @brief How much chunks in view direction are preferred to the nearer ones
+const float VIEW_DIRECTION_WEIGHT = 0.5f;
 
-ChunksController::ChunksController(Level& level)
+class GeneratorWorker
+    : public util::Worker<ChunkGenerationJob, ChunkGenerationResult> {
+    const WorldGenerator& generator;
+public:
+    GeneratorWorker(const WorldGenerator& generator) : generator(generator) {
+    }
+
+    ChunkGenerationResult operator()(const ChunkGenerationJob& job) override {
+        std::shared_ptr<voxel[]> voxels(new voxel[CHUNK_VOL]);
+        generator.generate(*job.prototype, voxels.get(), job.x, job.z);
+        return ChunkGenerationResult {job.x, job.z, std::move(voxels)};
+    }
+};
+
+ChunksController::ChunksController(
+    Level& level, int generatorWorkers, int lightingWorkers
+)
     : level(level),
       generator(std::make_unique<WorldGenerator>(
           level.content.generators.require(level.getWorld()->getGenerator()),
           level.content,
           level.getWorld()->getSeed()
+      )),
+      generatorPool(
+          "chunks-generator-pool",
+          [this]() {
+              return std::make_shared<GeneratorWorker>(*generator);
+          },
+          [this](ChunkGenerationResult& result) {
+              processGenerated(result);
+          },
+          generatorWorkers
+      ),
+      lightingWorkers(std::make_unique<util::WorkerGroup>(
+          util::get_workers_count(lightingWorkers) - 1
       )) {}
 
-ChunksController::~ChunksController() = default;
+ChunksController::~ChunksController() {
+    generatorPool.terminate();
+}
 
 void ChunksController::update(
     int64_t maxDuration, int loadDistance, uint padding, Player& player
-) const {
+) {
+    generatorPool.update();
+
     const auto& position = player.getPosition();
     int centerX = floordiv<CHUNK_W>(position.x);
     int centerY = floordiv<CHUNK_D>(position.z);
@@ -43,11 +90,14 @@ void ChunksController::update(
         generator->update(centerX, centerY, loadDistance);
     }
 
+    auto& queue = queues[player.getId()];
+    queue.refresh(*player.chunks, padding);
+
     int64_t mcstotal = 0;
 
     for (uint i = 0; i < MAX_WORK_PER_FRAME; i++) {
         timeutil::Timer timer;
-        if (loadVisible(player, padding)) {
+        if (loadVisible(player, queue)) {
             int64_t mcs = timer.stop();
             if (mcstotal + mcs < maxDuration * 1000) {
                 mcstotal += mcs;
@@ -58,93 +108,173 @@ void ChunksController::update(
     }
 }
 
-bool ChunksController::loadVisible(const Player& player, uint padding) const {
+void ChunksController::invalidateQueues() {
+    for (auto& [_, queue] : queues) {
+        queue.invalidate();
+    }
+}
+
+void ChunksController::cleanQueues() {
+    for (auto it = queues.begin(); it != queues.end();) {
+        auto player = level.players->get(it->first);
+        if (player == nullptr || player->isSuspended()) {
+            it = queues.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+namespace {
+    struct LoadCandidate {
+        glm::ivec2 pos;
+        float priority;
+
+        inline bool operator<(const LoadCandidate& o) const noexcept {
+            return priority > o.priority;
+        }
+    };
+}
+
+bool ChunksController::loadVisible(
+    const Player& player, ChunksLoadQueue& queue
+) {
     const auto& chunks = *player.chunks;
-    int sizeX = chunks.getWidth();
-    int sizeY = chunks.getHeight();
-
-    int nearX = 0;
-    int nearZ = 0;
-    bool assigned = false;
-    int minDistance = ((sizeX - padding * 2) / 2) * ((sizeY - padding * 2) / 2);
-    for (uint z = padding; z < sizeY - padding; z++) {
-        for (uint x = padding; x < sizeX - padding; x++) {
-            int index = z * sizeX + x;
-            auto& chunk = chunks.getChunks()[index];
-            if (chunk != nullptr) {
-                if (chunk->flags.loaded && !chunk->flags.lighted) {
-                    if (buildLights(player, chunk)) {
-                        return true;
-                    }
-                }
-                continue;
-            }
-            int lx = x - sizeX / 2;
-            int lz = z - sizeY / 2;
-            int distance = (lx * lx + lz * lz);
-            if (distance < minDistance) {
-                minDistance = distance;
-                nearX = x;
-                nearZ = z;
-                assigned = true;
+    size_t maxLighting =
+        lightingWorkers->getWorkersCount() * MAX_LIGHTING_PER_WORKER;
+    size_t maxPending =
+        generatorPool.getWorkersCount() * MAX_PENDING_PER_WORKER;
+    size_t slots = 0;
+    if (player.isLoadingChunks() && pending.size() < maxPending) {
+        slots = maxPending - pending.size();
+    }
+    size_t maxCandidates = slots * CANDIDATES_PER_SLOT;
+
+    float yaw = glm::radians(player.getRotation().x);
+    glm::vec2 direction(-glm::sin(yaw), -glm::cos(yaw));
+    int centerX = chunks.getOffsetX() + chunks.getWidth() / 2;
+    int centerZ = chunks.getOffsetY() + chunks.getHeight() / 2;
+
+    std::vector<Chunk*> lightingChunks;
+    std::priority_queue<LoadCandidate> candidates;
+    uint visited = 0;
+    queue.visit(chunks, [&](int x, int z, Chunk* chunk) {
+        if (chunk != nullptr) {
+            if (chunk->flags.loaded && lightingChunks.size() < maxLighting &&
+                isSurrounded(player, *chunk)) {
+                lightingChunks.push_back(chunk);
             }
+        } else if (candidates.size() < maxCandidates &&
+                   pending.find(glm::ivec2(x, z)) == pending.end()) {
+            glm::vec2 offset(x - centerX, z - centerZ);
+            float distance = glm::length(offset);
+            float alignment =
+                distance > 0.0f ? glm::dot(offset / distance, direction) : 0.0f;
+            candidates.push(LoadCandidate {
+                {x, z}, distance * (1.0f - VIEW_DIRECTION_WEIGHT * alignment)
+            });
         }
-    }
+        return ++visited < MAX_VISITED_CELLS &&
+               (lightingChunks.size() < maxLighting ||
+                candidates.size() < maxCandidates);
+    });
 
-    const auto& chunk = chunks.getChunks()[nearZ * sizeX + nearX];
-    if (chunk != nullptr || !assigned || !player.isLoadingChunks()) {
-        return false;
+    if (!lightingChunks.empty()) {
+        buildLights(lightingChunks);
+    }
+    bool created = false;
+    for (size_t i = 0; i < slots && !candidates.empty(); i++) {
+        if (pending.size() >= maxPending) {
+            break;
+        }
+        const auto& pos = candidates.top().pos;
+        createChunk(player, pos.x, pos.y);
+        candidates.pop();
+        created = true;
     }
-    int offsetX = chunks.getOffsetX();
-    int offsetY = chunks.getOffsetY();
-    createChunk(player, nearX + offsetX, nearZ + offsetY);
-    return true;
+    return created || !lightingChunks.empty();
 }
 
-bool ChunksController::buildLights(
-    const Player& player, const std::shared_ptr<Chunk>& chunk
+bool ChunksController::isSurrounded(
+    const Player& player, const Chunk& chunk
 ) const {
     int surrounding = 0;
     for (int oz = -1; oz <= 1; oz++) {
         for (int ox = -1; ox <= 1; ox++) {
-            if (player.chunks->getChunk(chunk->x + ox, chunk->z + oz))
+            if (player.chunks->getChunk(chunk.x + ox, chunk.z + oz))
                 surrounding++;
         }
     }
-    if (surrounding == MIN_SURROUNDING) {
-        if (lighting) {
-            bool lightsCache = chunk->flags.loadedLights;
-            if (!lightsCache) {
-                lighting->buildSkyLight(chunk->x, chunk->z);
-            }
-            lighting->onChunkLoaded(chunk->x, chunk->z, !lightsCache);
-        }
+    return surrounding == MIN_SURROUNDING;
+}
+
+void ChunksController::buildLights(const std::vector<Chunk*>& chunks) {
+    if (lighting) {
+        lighting->buildLights(chunks, *lightingWorkers);
+    }
+    for (auto chunk : chunks) {
         chunk->flags.lighted = true;
-        return true;
     }
-    return false;
 }
 
-void ChunksController::createChunk(const Player& player, int x, int z) const {
+void ChunksController::createChunk(const Player& player, int x, int z) {
     if (!player.isLoadingChunks()) {
-        if (auto chunk = level.chunks->fetch(x, z)) {
+        auto chunk = level.chunks->fetch(x, z);
+        if (chunk && chunk->flags.loaded) {
             player.chunks->putChunk(chunk);
         }
         return;
     }
     auto chunk = level.chunks->create(x, z);
+    if (!chunk->flags.loaded) {
+        auto prototype = generator->prepare(x, z);
+        // voxels will be put to the chunk by processGenerated
+        pending[{x, z}] = chunk;
+        generatorPool.enqueueJob(
+            ChunkGenerationJob {x, z, std::move(prototype)}
+        );
+        return;
+    }
+    finishChunk(*chunk);
     player.chunks->putChunk(chunk);
-    auto& chunkFlags = chunk->flags;
+    showChunk(chunk);
+}
+
+void ChunksController::processGenerated(ChunkGenerationResult& result) {
+    const auto& found = pending.find({result.x, result.z});
+    if (found == pending.end()) {
+        return;
+    }
+    auto chunk = std::move(found->second);
+    pending.erase(found);
+
+    chunk->voxels.write(result.voxels.get(), level.chunks->packVoxels);
+    chunk->flags.unsaved = true;
+    finishChunk(*chunk);
 
-    if (!chunkFlags.loaded) {
-        generator->generate(chunk->voxels, x, z);
-        chunkFlags.unsaved = true;
+    if (!showChunk(chunk)) {
+        // chunk is out of all players areas and not lighted yet, so
+        // there is nothing to save
+        level.chunks->erase(result.x, result.z);
     }
-    chunk->updateHeights();
+}
+
+bool ChunksController::showChunk(const std::shared_ptr<Chunk>& chunk) {
+    bool shown = false;
+    for (const auto& [_, player] : *level.players) {
+        if (!player->isSuspended()) {
+            shown |= player->chunks->putChunk(chunk);
+        }
+    }
+    return shown;
+}
+
+void ChunksController::finishChunk(Chunk& chunk) const {
+    chunk.updateHeights();
 
-    if (!chunkFlags.loadedLights) {
-        Lighting::prebuildSkyLight(*chunk, *level.content.getIndices());
+    if (!chunk.flags.loadedLights) {
+        Lighting::prebuildSkyLight(chunk, *level.content.getIndices());
     }
-    chunkFlags.loaded = true;
-    chunkFlags.ready = true;
+    chunk.flags.loaded = true;
+    chunk.flags.ready = true;
 }
@@ -1,8 +1,17 @@
 #pragma once
 
 #include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/hash.hpp>
 
 #include "typedefs.hpp"
+#include "voxels/voxel.hpp"
+#include "util/ThreadPool.hpp"
+#include "ChunksLoadQueue.hpp"
 
 class Level;
 class Chunk;
@@ -10,27 +19,70 @@ class Chunks;
 class Player;
 class Lighting;
 class WorldGenerator;
+struct ChunkPrototype;
+
+namespace util {
+    class WorkerGroup;
+}
+
+struct ChunkGenerationJob {
+    int x;
+    int z;
+    std::shared_ptr<const ChunkPrototype> prototype;
+};
+
+struct ChunkGenerationResult {
+    int x;
+    int z;
+    std::shared_ptr<voxel[]> voxels;
+};
 
 /// @brief ChunksController manages chunks dynamic loading/unloading
 class ChunksController {
 private:
     Level& level;
     std::unique_ptr<WorldGenerator> generator;
+    /// @brief Chunks waiting for voxels from generator workers
+    std::unordered_map<glm::ivec2, std::shared_ptr<Chunk>> pending;
+    util::ThreadPool<ChunkGenerationJob, ChunkGenerationResult> generatorPool;
+    std::unique_ptr<util::WorkerGroup> lightingWorkers;
+    /// @brief Load queues of players areas
+    std::unordered_map<u64id_t, ChunksLoadQueue> queues;
 
-    /// @brief Process one chunk: load it or calculate lights for it
-    bool loadVisible(const Player& player, uint padding) const;
-    bool buildLights(const Player& player, const std::shared_ptr<Chunk>& chunk) const;
-    void createChunk(const Player& player, int x, int y) const;
+    /// @brief Calculate lights for a batch of chunks and create a batch of
+    /// the nearest missing chunks, preferring ones in view direction
+    bool loadVisible(const Player& player, ChunksLoadQueue& queue);
+    bool isSurrounded(const Player& player, const Chunk& chunk) const;
+    /// @brief Calculate lights for chunks and mark them lighted
+    void buildLights(const std::vector<Chunk*>& chunks);
+    void createChunk(const Player& player, int x, int y);
+    void processGenerated(ChunkGenerationResult& result);
+    /// @brief Put the chunk to areas of all players including it, so
+    /// a chunk shared by players is loaded once
+    /// @return true if the chunk is included by any area
+    bool showChunk(const std::shared_ptr<Chunk>& chunk);
+    void finishChunk(Chunk& chunk) const;
 public:
     std::unique_ptr<Lighting> lighting;
 
-    ChunksController(Level& level);
+    /// @param generatorWorkers max number of chunk generator workers
+    /// (see util::ThreadPool maxWorkers)
+    /// @param lightingWorkers max number of threads calculating lights
+    /// including the main thread (see util::get_workers_count)
+    ChunksController(Level& level, int generatorWorkers, int lightingWorkers);
     ~ChunksController();
 
     /// @param maxDuration milliseconds reserved for chunks loading
     void update(
         int64_t maxDuration, int loadDistance, uint padding, Player& player
-    ) const;
+    );
+
+    /// @brief Reset load queues of all players (see
+    /// ChunksLoadQueue::invalidate)
+    void invalidateQueues();
+
+    /// @brief Remove load queues of removed and suspended players
+    void cleanQueues();
 
     const WorldGenerator* getGenerator() const {
         return generator.get();
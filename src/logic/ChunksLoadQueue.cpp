@@ -0,0 +1,70 @@
+#include "ChunksLoadQueue.hpp"
+
+#include <algorithm>
+
+#include "voxels/Chunk.hpp"
+#include "voxels/Chunks.hpp"
+
+void ChunksLoadQueue::build() {
+    cells.clear();
+    cursor = 0;
+    int sizeX = width - static_cast<int>(padding) * 2;
+    int sizeZ = height - static_cast<int>(padding) * 2;
+    if (sizeX <= 0 || sizeZ <= 0) {
+        return;
+    }
+    cells.reserve(sizeX * sizeZ);
+    for (int z = padding; z < height - static_cast<int>(padding); z++) {
+        for (int x = padding; x < width - static_cast<int>(padding); x++) {
+            cells.emplace_back(x - width / 2, z - height / 2);
+        }
+    }
+    std::stable_sort(
+        cells.begin(),
+        cells.end(),
+        [](const glm::ivec2& a, const glm::ivec2& b) {
+            return a.x * a.x + a.y * a.y < b.x * b.x + b.y * b.y;
+        }
+    );
+}
+
+void ChunksLoadQueue::refresh(const Chunks& chunks, uint padding) {
+    if (chunks.getWidth() != width || chunks.getHeight() != height ||
+        padding != this->padding) {
+        width = chunks.getWidth();
+        height = chunks.getHeight();
+        this->padding = padding;
+        build();
+    }
+    size_t count = chunks.getChunksCount();
+    if (chunks.getOffsetX() != offsetX || chunks.getOffsetY() != offsetZ ||
+        count < chunksCount) {
+        offsetX = chunks.getOffsetX();
+        offsetZ = chunks.getOffsetY();
+        cursor = 0;
+    }
+    chunksCount = count;
+}
+
+void ChunksLoadQueue::visit(const Chunks& chunks, const Visitor& visitor) {
+    const auto& buffer = chunks.getChunks();
+    int centerX = width / 2;
+    int centerZ = height / 2;
+    bool prefix = true;
+    for (size_t i = cursor; i < cells.size(); i++) {
+        const auto& cell = cells[i];
+        int lx = centerX + cell.x;
+        int lz = centerZ + cell.y;
+        const auto& chunk = buffer[lz * width + lx];
+        if (chunk && chunk->flags.lighted) {
+            if (prefix) {
+                cursor = i + 1;
+            }
+            continue;
+        }
+        prefix = false;
+        if (!visitor(lx + offsetX, lz + offsetZ, chunk.get())) {
+            break;
+        }
+    }
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "typedefs.hpp"
+
+class Chunk;
+class Chunks;
+
+/// @brief Order of loading chunks of a player chunks area.
+///
+/// Area cells are visited in order of distance from the area center, which
+/// is computed once for the area size. Complete cells (with a lighted chunk)
+/// at the start of the order are skipped by a cursor, so checking a loaded
+/// area costs nothing until the area is moved or loses chunks, which resets
+/// the cursor
+class ChunksLoadQueue {
+    /// @brief Area cells offsets from the center sorted by distance
+    std::vector<glm::ivec2> cells;
+    /// @brief Index of the first cell that may be incomplete
+    size_t cursor = 0;
+    int width = 0;
+    int height = 0;
+    uint padding = 0;
+    int offsetX = 0;
+    int offsetZ = 0;
+    size_t chunksCount = 0;
+
+    void build();
+public:
+    /// @brief Visitor of incomplete cells
+    /// @param x chunk x
+    /// @param z chunk z
+    /// @param chunk unlighted chunk or nullptr if the chunk is missing
+    /// @return false to stop visiting
+    using Visitor = std::function<bool(int x, int z, Chunk* chunk)>;
+
+    /// @brief Reset the cursor if the area has been moved or resized or
+    /// lost chunks since the last call
+    /// @param padding number of border cells that are not loaded
+    void refresh(const Chunks& chunks, uint padding);
+
+    /// @brief Visit incomplete cells in order of distance,
+    /// moving the cursor past complete ones
+    void visit(const Chunks& chunks, const Visitor& visitor);
+
+    /// @brief Reset the cursor, so complete cells are checked again.
+    /// Must be called when a chunk loses lights
+    void invalidate() {
+        cursor = 0;
+    }
+
+    /// @return number of cells skipped by the cursor
+    size_t getCompleteCount() const {
+        return cursor;
+    }
+};
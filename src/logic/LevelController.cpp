@@ -11,6 +11,7 @@
 #include "objects/Player.hpp"
 #include "physics/Hitbox.hpp"
 #include "voxels/Chunks.hpp"
+#include "voxels/GlobalChunks.hpp"
 #include "scripting/scripting.hpp"
 #include "lighting/Lighting.hpp"
 #include "settings.hpp"
@@ -25,9 +26,17 @@ LevelController::LevelController(
 )
     : settings(engine->getSettings()),
       level(std::move(levelPtr)),
-      chunks(std::make_unique<ChunksController>(*level)),
+      chunks(std::make_unique<ChunksController>(
+          *level,
+          settings.chunks.generatorWorkers.get(),
+          settings.chunks.lightingWorkers.get()
+      )),
       playerTickClock(20, 3) {
-    
+    // chunks are compressed and written by regions I/O thread,
+    // so world saving does not stall ticks
+    level->getWorld()->wfile->getRegions().asyncWrites = true;
+    level->chunks->packVoxels = settings.chunks.paletteStorage.get();
+
     level->events->listen(LevelEventType::CHUNK_PRESENT, [](auto, Chunk* chunk) {
         scripting::on_chunk_present(*chunk, chunk->flags.loaded);
     });
@@ -69,6 +78,7 @@ LevelController::LevelController(
 }
 
 void LevelController::update(float delta, bool pause) {
+    chunks->cleanQueues();
     for (const auto& [_, player] : *level->players) {
         if (player->isSuspended()) {
             continue;
@@ -0,0 +1,299 @@
+#include "WorldPregenerator.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+#include "content/Content.hpp"
+#include "data/dv_util.hpp"
+#include "debug/Logger.hpp"
+#include "files/WorldFiles.hpp"
+#include "files/WorldRegions.hpp"
+#include "files/files.hpp"
+#include "lighting/Lighting.hpp"
+#include "util/WorkerGroup.hpp"
+#include "util/timeutil.hpp"
+#include "voxels/Chunk.hpp"
+#include "voxels/Chunks.hpp"
+#include "voxels/GlobalChunks.hpp"
+#include "world/Level.hpp"
+#include "world/World.hpp"
+#include "world/generator/WorldGenerator.hpp"
+
+namespace fs = std::filesystem;
+
+static debug::Logger logger("pregen");
+
+inline const std::string CHECKPOINT_FILE = "pregen.json";
+
+/// @brief Max band width in chunks (matches region size to keep region
+/// files written by a single band)
+inline constexpr int BAND_WIDTH = REGION_SIZE;
+/// @brief Number of rows processed between checkpoints
+inline constexpr int FLUSH_INTERVAL = REGION_SIZE;
+/// @brief Progress report interval (microseconds)
+inline constexpr int64_t REPORT_INTERVAL = 5'000'000;
+
+WorldPregenerator::WorldPregenerator(
+    Level& level, const glm::ivec4& area, uint workersCount
+)
+    : level(level),
+      generator(std::make_unique<WorldGenerator>(
+          level.content.generators.require(level.getWorld()->getGenerator()),
+          level.content,
+          level.getWorld()->getSeed(),
+          workersCount
+      )),
+      workers(std::make_unique<util::WorkerGroup>(workersCount)),
+      checkpointFile(level.getWorld()->wfile->getFolder() / CHECKPOINT_FILE),
+      area(area),
+      bandX(area.x),
+      row(area.y) {
+    if (area.x > area.z || area.y > area.w) {
+        throw std::invalid_argument("invalid pre-generation area");
+    }
+    loadCheckpoint();
+    if (bandX > area.z) {
+        active = false;
+        return;
+    }
+    logger.info() << "pre-generating area " << area.x << "," << area.y
+                  << " - " << area.z << "," << area.w << " ("
+                  << getWorkTotal() << " chunks) using "
+                  << workers->getWorkersCount() << " workers";
+    startBand();
+}
+
+WorldPregenerator::~WorldPregenerator() = default;
+
+void WorldPregenerator::loadCheckpoint() {
+    if (!fs::exists(checkpointFile)) {
+        return;
+    }
+    auto root = files::read_json(checkpointFile);
+    glm::ivec4 savedArea {};
+    dv::get_vec(root, "area", savedArea);
+    if (savedArea != area) {
+        logger.warning() << "checkpoint area does not match, ignored";
+        return;
+    }
+    root.at("x").get(bandX);
+    root.at("z").get(row);
+    root.at("done").get(chunksDone);
+    logger.info() << "resuming from checkpoint at " << bandX << "," << row;
+}
+
+void WorldPregenerator::writeCheckpoint() const {
+    auto root = dv::object();
+    root["area"] = dv::to_value(area);
+    root["x"] = bandX;
+    root["z"] = row;
+    root["done"] = chunksDone;
+    files::write_json_atomic(checkpointFile, root);
+}
+
+void WorldPregenerator::startBand() {
+    bandWidth = std::min(BAND_WIDTH, area.z - bandX + 1);
+    int width = bandWidth + 2;
+
+    // matrix includes border columns and rows [row-1, row+1]
+    chunks = std::make_unique<Chunks>(
+        width, 3, 0, 0, level.events.get(), *level.content.getIndices()
+    );
+    chunks->setCenter((bandX - 1 + width / 2) * CHUNK_W, row * CHUNK_D);
+    lighting = std::make_unique<Lighting>(level.content, *chunks);
+
+    createRow(row - 1);
+    createRow(row);
+    if (row - 1 < area.y) {
+        return;
+    }
+    // previous row is lighted already when resuming from checkpoint
+    for (int x = bandX - 1; x <= bandX + bandWidth; x++) {
+        auto chunk = chunks->getChunk(x, row - 1);
+        if (chunk && chunk->flags.loadedLights && x >= area.x && x <= area.z) {
+            chunk->flags.lighted = true;
+            chunk->flags.unsaved = true;
+        }
+    }
+    // current row is not saved lighted, so the light spilled into it from
+    // the previous row is spread again
+    for (int x = bandX; x < bandX + bandWidth; x++) {
+        auto chunk = chunks->getChunk(x, row - 1);
+        if (chunk && chunk->flags.lighted) {
+            lighting->onChunkLoaded(x, row - 1, true);
+        }
+    }
+}
+
+void WorldPregenerator::finishBand() {
+    // saves remaining lighted rows
+    chunks->saveAndClear();
+    lighting.reset();
+    chunks.reset();
+
+    bandX += bandWidth;
+    row = area.y;
+    writeRegions();
+
+    if (bandX > area.z) {
+        active = false;
+        fs::remove(checkpointFile);
+        logger.info() << "pre-generation finished: " << chunksGenerated
+                      << " chunks generated";
+        return;
+    }
+    startBand();
+}
+
+void WorldPregenerator::createRow(int z) {
+    int width = bandWidth + 2;
+    generator->update(bandX - 1 + width / 2, z, width / 2 + 1);
+
+    std::vector<std::shared_ptr<Chunk>> rowChunks;
+    std::vector<Chunk*> generating;
+    std::vector<std::shared_ptr<const ChunkPrototype>> prototypes;
+    for (int x = bandX - 1; x <= bandX + bandWidth; x++) {
+        auto chunk = level.chunks->create(x, z);
+        chunks->putChunk(chunk);
+        if (!chunk->flags.loaded) {
+            prototypes.push_back(generator->prepare(x, z));
+            generating.push_back(chunk.get());
+        }
+        rowChunks.push_back(std::move(chunk));
+    }
+    workers->run(generating.size(), [&](size_t index, uint) {
+        auto& chunk = *generating[index];
+        auto voxels = std::make_unique<voxel[]>(CHUNK_VOL);
+        generator->generate(*prototypes[index], voxels.get(), chunk.x, chunk.z);
+        chunk.voxels.write(voxels.get(), level.chunks->packVoxels);
+    });
+    for (auto chunk : generating) {
+        chunk->flags.unsaved = true;
+    }
+    chunksGenerated += generating.size();
+
+    const auto& indices = *level.content.getIndices();
+    for (const auto& chunk : rowChunks) {
+        if (chunk->flags.ready) {
+            continue;
+        }
+        chunk->updateHeights();
+        if (!chunk->flags.loadedLights) {
+            Lighting::prebuildSkyLight(*chunk, indices);
+        }
+        chunk->flags.loaded = true;
+        chunk->flags.ready = true;
+    }
+}
+
+void WorldPregenerator::lightRow(int z) {
+    std::vector<Chunk*> lightingChunks;
+    for (int x = bandX - 1; x <= bandX + bandWidth; x++) {
+        auto chunk = chunks->getChunk(x, z);
+        if (chunk == nullptr || chunk->flags.lighted) {
+            continue;
+        }
+        bool lightsCache = chunk->flags.loadedLights;
+        if (x < bandX || x >= bandX + bandWidth) {
+            // border chunk neighbours are not loaded, but saved lights of
+            // the area chunk are valid and get light spilled from the band
+            if (lightsCache && x >= area.x && x <= area.z) {
+                chunk->flags.lighted = true;
+                chunk->flags.unsaved = true;
+            }
+            continue;
+        }
+        lightingChunks.push_back(chunk);
+    }
+    lighting->buildLights(lightingChunks, *workers);
+    for (auto chunk : lightingChunks) {
+        chunk->flags.lighted = true;
+    }
+}
+
+void WorldPregenerator::flush() {
+    // the last lighted row is still in the matrix
+    for (int x = bandX - 1; x <= bandX + bandWidth; x++) {
+        if (auto chunk = chunks->getChunk(x, row - 1)) {
+            level.chunks->save(chunk);
+        }
+    }
+    writeRegions();
+}
+
+void WorldPregenerator::writeRegions() {
+    auto& regions = level.getWorld()->wfile->getRegions();
+    regions.writeAll();
+    regions.releaseSaved();
+    writeCheckpoint();
+}
+
+void WorldPregenerator::report(int64_t mcs) {
+    reportTime += mcs;
+    if (reportTime < REPORT_INTERVAL && active) {
+        return;
+    }
+    double seconds = std::max(reportTime, static_cast<int64_t>(1)) / 1e6;
+    logger.info() << "pre-generated " << chunksDone << "/" << getWorkTotal()
+                  << " chunks ("
+                  << static_cast<int>((chunksDone - reportedDone) / seconds)
+                  << " chunks/s)";
+    reportTime = 0;
+    reportedDone = chunksDone;
+}
+
+void WorldPregenerator::update() {
+    if (!active) {
+        return;
+    }
+    timeutil::Timer timer;
+
+    createRow(row + 1);
+    lightRow(row);
+    chunksDone += bandWidth;
+    row++;
+
+    if (row > area.w) {
+        finishBand();
+    } else {
+        // the previous row leaves the matrix and gets saved
+        chunks->setCenter(
+            (bandX - 1 + (bandWidth + 2) / 2) * CHUNK_W, row * CHUNK_D
+        );
+        if ((row - area.y) % FLUSH_INTERVAL == 0) {
+            flush();
+        }
+    }
+    report(timer.stop());
+}
+
+void WorldPregenerator::terminate() {
+    if (!active) {
+        return;
+    }
+    chunks->saveAndClear();
+    lighting.reset();
+    chunks.reset();
+    writeRegions();
+    active = false;
+    logger.info() << "pre-generation stopped at " << bandX << "," << row;
+}
+
+bool WorldPregenerator::isActive() const {
+    return active;
+}
+
+void WorldPregenerator::waitForEnd() {
+    while (isActive()) {
+        update();
+    }
+}
+
+uint WorldPregenerator::getWorkTotal() const {
+    return (area.z - area.x + 1) * (area.w - area.y + 1);
+}
+
+uint WorldPregenerator::getWorkDone() const {
+    return chunksDone;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <memory>
+#include <filesystem>
+
+#include <glm/glm.hpp>
+
+#include "typedefs.hpp"
+#include "interfaces/Task.hpp"
+
+class Level;
+class Chunk;
+class Chunks;
+class Lighting;
+class WorldGenerator;
+
+namespace util {
+    class WorkerGroup;
+}
+
+/// @brief Offline world pre-generation task.
+/// Generates, lights and saves every chunk of a rectangular area.
+///
+/// The area is processed in bands of columns, each band row by row, keeping
+/// only three rows of chunks in memory: the next row is generated, the
+/// current one is lighted and the previous one is saved when leaving the
+/// matrix. Already existing chunks are loaded instead of being generated.
+/// Progress is written to a checkpoint file, so an interrupted task
+/// started again with the same area will continue from the last checkpoint.
+class WorldPregenerator : public Task {
+    Level& level;
+    std::unique_ptr<WorldGenerator> generator;
+    std::unique_ptr<util::WorkerGroup> workers;
+    std::unique_ptr<Chunks> chunks;
+    std::unique_ptr<Lighting> lighting;
+    std::filesystem::path checkpointFile;
+
+    /// @brief Area in chunks {minX, minZ, maxX, maxZ} (inclusive)
+    glm::ivec4 area;
+    /// @brief Current band first column
+    int bandX;
+    /// @brief Current band width
+    int bandWidth = 0;
+    /// @brief Next row to be lighted
+    int row;
+    uint chunksDone = 0;
+    uint chunksGenerated = 0;
+    bool active = true;
+
+    /// @brief Processed chunks count at the last progress report
+    uint reportedDone = 0;
+    /// @brief Time since the last progress report (microseconds)
+    int64_t reportTime = 0;
+
+    void loadCheckpoint();
+    void writeCheckpoint() const;
+
+    void startBand();
+    void finishBand();
+
+    /// @brief Load or generate band row chunks including border columns
+    void createRow(int z);
+    /// @brief Light band row chunks having all neighbours present
+    void lightRow(int z);
+    /// @brief Save the last lighted row, write regions and checkpoint
+    void flush();
+    /// @brief Write and unload regions, then write checkpoint
+    void writeRegions();
+
+    void report(int64_t mcs);
+public:
+    /// @param level target level. Chunks must not be loaded by other
+    /// controllers while the task is active
+    /// @param area chunks area {minX, minZ, maxX, maxZ} (inclusive)
+    /// @param workersCount number of additional generator and lighting threads
+    WorldPregenerator(Level& level, const glm::ivec4& area, uint workersCount);
+    ~WorldPregenerator();
+
+    /// @brief Process the next row of the current band
+    void update() override;
+    void terminate() override;
+    bool isActive() const override;
+    void waitForEnd() override;
+    uint getWorkTotal() const override;
+    uint getWorkDone() const override;
+};
@@ -9,9 +9,13 @@
 #include "files/engine_paths.hpp"
 #include "files/files.hpp"
 #include "lighting/Lighting.hpp"
+#include "logic/BlocksController.hpp"
+#include "maths/voxmaths.hpp"
+#include "voxels/Block.hpp"
 #include "voxels/Chunk.hpp"
 #include "voxels/Chunks.hpp"
 #include "voxels/GlobalChunks.hpp"
+#include "voxels/blocks_agent.hpp"
 #include "voxels/compressed_chunks.hpp"
 #include "world/Level.hpp"
 #include "world/World.hpp"
@@ -140,6 +144,7 @@ static void integrate_chunk_client(Chunk& chunk) {
     Lighting& lighting = *chunksController->lighting;
     chunk.flags.loadedLights = false;
     chunk.flags.lighted = false;
+    chunksController->invalidateQueues();
 
     Lighting::prebuildSkyLight(chunk, *indices);
     lighting.onChunkLoaded(x, z, true);
@@ -150,7 +155,7 @@ static void integrate_chunk_client(Chunk& chunk) {
                 continue;
             }
             if (auto other = level->chunks->getChunk(x + lx, z + lz)) {
-                other->flags.modified = true;
+                other->setModified();
                 lighting.onChunkLoaded(x - 1, z, true);
             }
         }
@@ -175,6 +180,68 @@ static int l_set_chunk_data(lua::State* L) {
     return lua::pushboolean(L, true);
 }
 
+static int l_fill(lua::State* L) {
+    glm::ivec3 a(
+        lua::tointeger(L, 1), lua::tointeger(L, 2), lua::tointeger(L, 3)
+    );
+    glm::ivec3 b(
+        lua::tointeger(L, 4), lua::tointeger(L, 5), lua::tointeger(L, 6)
+    );
+    auto id = lua::tointeger(L, 7);
+    auto state = int2blockstate(lua::tointeger(L, 8));
+    bool noupdate = lua::toboolean(L, 9);
+    if (static_cast<size_t>(id) >= indices->blocks.count()) {
+        return lua::pushinteger(L, 0);
+    }
+    const auto& def = indices->blocks.require(id);
+    if (def.rt.extended) {
+        throw std::runtime_error("extended blocks are not supported");
+    }
+    glm::ivec3 min = glm::min(a, b);
+    glm::ivec3 max = glm::max(a, b);
+    min.y = std::max(min.y, 0);
+    max.y = std::min(max.y, CHUNK_H - 1);
+    if (min.y > max.y) {
+        return lua::pushinteger(L, 0);
+    }
+
+    auto& chunks = *level->chunks;
+    Lighting* lighting = nullptr;
+    if (auto chunksController = controller->getChunksController()) {
+        lighting = chunksController->lighting.get();
+    }
+    LightingBatch lightingBatch(lighting);
+    lua::Integer count = 0;
+    for (int z = min.z; z <= max.z; z++) {
+        for (int x = min.x; x <= max.x; x++) {
+            int cx = floordiv<CHUNK_W>(x);
+            int cz = floordiv<CHUNK_D>(z);
+            if (!blocks_agent::get_chunk(chunks, cx, cz)) {
+                continue;
+            }
+            for (int y = min.y; y <= max.y; y++) {
+                blocks_agent::set(chunks, x, y, z, id, state);
+                if (lighting) {
+                    lighting->onBlockSet(x, y, z, id);
+                }
+            }
+            count += max.y - min.y + 1;
+        }
+    }
+    // updated blocks scripts see the solved lights
+    lightingBatch.end();
+    if (!noupdate && count) {
+        for (int y = min.y - 1; y <= max.y + 1; y++) {
+            for (int z = min.z - 1; z <= max.z + 1; z++) {
+                for (int x = min.x - 1; x <= max.x + 1; x++) {
+                    blocks->updateBlock(x, y, z);
+                }
+            }
+        }
+    }
+    return lua::pushinteger(L, count);
+}
+
 static int l_count_chunks(lua::State* L) {
     if (level == nullptr) {
         return 0;
@@ -198,5 +265,6 @@ const luaL_Reg worldlib[] = {
     {"get_chunk_data", lua::wrap<l_get_chunk_data>},
     {"set_chunk_data", lua::wrap<l_set_chunk_data>},
     {"count_chunks", lua::wrap<l_count_chunks>},
+    {"fill", lua::wrap<l_fill>},
     {NULL, NULL}
 };
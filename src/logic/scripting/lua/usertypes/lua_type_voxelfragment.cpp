@@ -3,6 +3,8 @@
 #include "../lua_util.hpp"
 
 #include "world/generator/VoxelFragment.hpp"
+#include "logic/ChunksController.hpp"
+#include "logic/LevelController.hpp"
 #include "util/stringutil.hpp"
 #include "world/Level.hpp"
 
@@ -25,8 +27,15 @@ static int l_place(lua::State* L) {
     if (auto fragment = touserdata<LuaVoxelFragment>(L, 1)) {
         auto offset = tovec3(L, 2);
         int rotation = tointeger(L, 3) & 0b11;
+        Lighting* lighting = nullptr;
+        if (scripting::controller) {
+            if (auto chunksController =
+                    scripting::controller->getChunksController()) {
+                lighting = chunksController->lighting.get();
+            }
+        }
         fragment->getFragment()->place(
-            *scripting::level->chunks, offset, rotation 
+            *scripting::level->chunks, offset, rotation, lighting
         );
     }
     return 0;
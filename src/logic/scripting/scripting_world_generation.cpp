@@ -64,6 +64,10 @@ public:
         }
     }
 
+    std::unique_ptr<GeneratorScript> clone() const override {
+        return scripting::load_generator(def, file, dirPath);
+    }
+
     std::shared_ptr<Heightmap> generateHeightmap(
         const glm::ivec2& offset,
         const glm::ivec2& size,
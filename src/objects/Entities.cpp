@@ -28,6 +28,9 @@ static inline std::string COMP_RIGIDBODY = "rigidbody";
 static inline std::string COMP_SKELETON = "skeleton";
 static inline std::string SAVED_DATA_VARNAME = "SAVED_DATA";
 
+/// @brief Entities index cells size
+static inline constexpr float GRID_CELL_SIZE = 8.0f;
+
 void Transform::refresh() {
     combined = glm::mat4(1.0f);
     combined = glm::translate(combined, pos);
@@ -42,6 +45,17 @@ void Entity::setInterpolatedPosition(const glm::vec3& position) {
     getSkeleton().interpolation.refresh(position);
 }
 
+void Entity::setPosition(const glm::vec3& position) {
+    getTransform().setPos(position);
+    getRigidbody().hitbox.position = position;
+    entities.invalidateGrid();
+}
+
+void Entity::setHitboxSize(const glm::vec3& size) {
+    getRigidbody().hitbox.halfsize = size * 0.5f;
+    entities.invalidateGrid();
+}
+
 glm::vec3 Entity::getInterpolatedPosition() const {
     const auto& skeleton = getSkeleton();
     if (skeleton.interpolation.isEnabled()) {
@@ -72,7 +86,10 @@ void Entity::setRig(const rigging::SkeletonConfig* rigConfig) {
 }
 
 Entities::Entities(Level& level)
-    : level(level), sensorsTickClock(20, 3), updateTickClock(20, 3) {
+    : level(level),
+      sensorsTickClock(20, 3),
+      updateTickClock(20, 3),
+      grid(GRID_CELL_SIZE) {
 }
 
 template <void (*callback)(const Entity&, size_t, entityid_t)>
@@ -151,6 +168,7 @@ entityid_t Entities::spawn(
     auto entity = registry.create();
     entities[id] = entity;
     uids[entity] = id;
+    invalidateGrid();
 
     registry.emplace<EntityId>(entity, static_cast<entityid_t>(id), def);
     const auto& tsf = registry.emplace<Transform>(
@@ -252,30 +270,51 @@ void Entities::loadEntity(const dv::value& map, Entity entity) {
     }
 }
 
+util::SpatialGrid<entt::entity>& Entities::getGrid() {
+    if (gridValid) {
+        return grid;
+    }
+    grid.clear();
+    auto view = registry.view<Transform, Rigidbody>();
+    for (auto [entity, transform, body] : view.each()) {
+        // queries check both transform position and hitbox
+        auto aabb = body.hitbox.getAABB();
+        aabb.addPoint(transform.pos);
+        grid.add(entity, aabb.min(), aabb.max());
+    }
+    gridValid = true;
+    return grid;
+}
+
 std::optional<Entities::RaycastResult> Entities::rayCast(
     glm::vec3 start, glm::vec3 dir, float maxDistance, entityid_t ignore
 ) {
     Ray ray(start, dir);
-    auto view = registry.view<EntityId, Transform, Rigidbody>();
 
     entityid_t foundUID = 0;
     glm::ivec3 foundNormal;
 
-    for (auto [entity, eid, transform, body] : view.each()) {
-        if (eid.uid == ignore) {
-            continue;
-        }
-        auto& hitbox = body.hitbox;
-        glm::ivec3 normal;
-        double distance;
-        if (ray.intersectAABB(
-                glm::vec3(), hitbox.getAABB(), maxDistance, normal, distance
-            ) > RayRelation::None) {
-            foundUID = eid.uid;
-            foundNormal = normal;
-            maxDistance = static_cast<float>(distance);
+    glm::vec3 end = start + dir * maxDistance;
+    getGrid().query(
+        glm::min(start, end),
+        glm::max(start, end),
+        [&](entt::entity entity) {
+            const auto& eid = registry.get<EntityId>(entity);
+            if (eid.uid == ignore) {
+                return;
+            }
+            auto& hitbox = registry.get<Rigidbody>(entity).hitbox;
+            glm::ivec3 normal;
+            double distance;
+            if (ray.intersectAABB(
+                    glm::vec3(), hitbox.getAABB(), maxDistance, normal, distance
+                ) > RayRelation::None) {
+                foundUID = eid.uid;
+                foundNormal = normal;
+                maxDistance = static_cast<float>(distance);
+            }
         }
-    }
+    );
     if (foundUID) {
         return Entities::RaycastResult {foundUID, foundNormal, maxDistance};
     } else {
@@ -399,6 +438,7 @@ void Entities::clean() {
             uids.erase(it->second);
             registry.destroy(it->second);
             it = entities.erase(it);
+            invalidateGrid();
         }
     }
 }
@@ -471,9 +511,13 @@ void Entities::updatePhysics(float delta) {
         float vel = glm::length(prevVel);
         int substeps = static_cast<int>(delta * vel * 20);
         substeps = std::min(100, std::max(2, substeps));
+        // sensors callbacks of the step and the grounded/fall callbacks
+        // may query the grid, so it's rebuilt with the moved hitbox
+        invalidateGrid();
         physics->step(*level.chunks, hitbox, delta, substeps, eid.uid);
         hitbox.linearDamping = hitbox.grounded * 24;
         transform.setPos(hitbox.position);
+        invalidateGrid();
         if (hitbox.grounded && !grounded) {
             scripting::on_entity_grounded(
                 *get(eid.uid), glm::length(prevVel - hitbox.velocity)
@@ -586,45 +630,47 @@ void Entities::render(
 }
 
 bool Entities::hasBlockingInside(AABB aabb) {
-    auto view = registry.view<EntityId, Rigidbody>();
-    for (auto [entity, eid, body] : view.each()) {
+    bool found = false;
+    getGrid().query(aabb.min(), aabb.max(), [&](entt::entity entity) {
+        const auto& eid = registry.get<EntityId>(entity);
+        const auto& body = registry.get<Rigidbody>(entity);
         if (eid.def.blocking && aabb.intersect(body.hitbox.getAABB(), -0.05f)) {
-            return true;
+            found = true;
         }
-    }
-    return false;
+    });
+    return found;
 }
 
 std::vector<Entity> Entities::getAllInside(AABB aabb) {
     std::vector<Entity> collected;
-    auto view = registry.view<Transform>();
-    for (auto [entity, transform] : view.each()) {
-        if (aabb.contains(transform.pos)) {
+    getGrid().query(aabb.min(), aabb.max(), [&](entt::entity entity) {
+        if (aabb.contains(registry.get<Transform>(entity).pos)) {
             const auto& found = uids.find(entity);
             if (found == uids.end()) {
-                continue;
+                return;
             }
             if (auto wrapper = get(found->second)) {
                 collected.push_back(*wrapper);
             }
         }
-    }
+    });
     return collected;
 }
 
 std::vector<Entity> Entities::getAllInRadius(glm::vec3 center, float radius) {
     std::vector<Entity> collected;
-    auto view = registry.view<Transform>();
-    for (auto [entity, transform] : view.each()) {
-        if (glm::distance2(transform.pos, center) <= radius * radius) {
+    glm::vec3 extent(radius);
+    getGrid().query(center - extent, center + extent, [&](entt::entity entity) {
+        const auto& pos = registry.get<Transform>(entity).pos;
+        if (glm::distance2(pos, center) <= radius * radius) {
             const auto& found = uids.find(entity);
             if (found == uids.end()) {
-                continue;
+                return;
             }
             if (auto wrapper = get(found->second)) {
                 collected.push_back(*wrapper);
             }
         }
-    }
+    });
     return collected;
 }
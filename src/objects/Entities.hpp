@@ -9,6 +9,7 @@
 #include "physics/Hitbox.hpp"
 #include "typedefs.hpp"
 #include "util/Clock.hpp"
+#include "util/SpatialGrid.hpp"
 #define GLM_ENABLE_EXPERIMENTAL
 #include <entt/entity/registry.hpp>
 #include <glm/gtx/norm.hpp>
@@ -172,6 +173,12 @@ public:
 
     void setInterpolatedPosition(const glm::vec3& position);
 
+    /// @brief Move the entity transform and hitbox
+    void setPosition(const glm::vec3& position);
+
+    /// @brief Set the entity hitbox size
+    void setHitboxSize(const glm::vec3& size);
+
     glm::vec3 getInterpolatedPosition() const;
 
     void destroy();
@@ -185,6 +192,12 @@ class Entities {
     entityid_t nextID = 1;
     util::Clock sensorsTickClock;
     util::Clock updateTickClock;
+    /// @brief Entities index for range queries and raycasts. Refilled on
+    /// the first query after physics update or entities changes
+    util::SpatialGrid<entt::entity> grid;
+    bool gridValid = false;
+
+    util::SpatialGrid<entt::entity>& getGrid();
 
     void updateSensors(
         Rigidbody& body, const Transform& tsf, std::vector<Sensor*>& sensors
@@ -253,6 +266,14 @@ public:
     std::vector<Entity> getAllInRadius(glm::vec3 center, float radius);
     void despawn(entityid_t id);
     void despawn(std::vector<Entity> entities);
+
+    /// @brief Refill entities index before the next query.
+    /// Called when entities were spawned, removed, moved or resized outside
+    /// of physics update
+    void invalidateGrid() {
+        gridValid = false;
+    }
+
     dv::value serialize(const Entity& entity);
     dv::value serialize(const std::vector<Entity>& entities);
 
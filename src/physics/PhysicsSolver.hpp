@@ -3,6 +3,7 @@
 #include "Hitbox.hpp"
 
 #include "typedefs.hpp"
+#include "util/SpatialGrid.hpp"
 #include "voxels/voxel.hpp"
 
 #include <vector>
@@ -15,6 +16,11 @@ struct Sensor;
 class PhysicsSolver {
     glm::vec3 gravity;
     std::vector<Sensor*> sensors;
+    /// @brief Sensors index by their calculated bounds
+    util::SpatialGrid<Sensor*> sensorsGrid;
+    bool sensorsGridValid = false;
+
+    void refreshSensorsGrid();
 public:
     PhysicsSolver(glm::vec3 gravity);
     void step(
@@ -37,6 +43,7 @@ public:
 
     void setSensors(std::vector<Sensor*> sensors) {
         this->sensors = std::move(sensors);
+        sensorsGridValid = false;
     }
 
     void removeSensor(Sensor* sensor);
@@ -40,6 +40,12 @@ struct ChunksSettings {
     IntegerSetting loadDistance {22, 3, 80};
     /// @brief Buffer zone where chunks are not unloading (chunk is unit)
     IntegerSetting padding {2, 1, 8};
+    /// @brief Limit of chunk generator workers count
+    IntegerSetting generatorWorkers {-2, -4, 32};
+    /// @brief Limit of threads calculating chunks lights
+    IntegerSetting lightingWorkers {-2, -4, 32};
+    /// @brief Store chunks voxels palette-compressed to reduce memory usage
+    FlagSetting paletteStorage {false};
 };
 
 struct CameraSettings {
@@ -67,6 +73,9 @@ struct GraphicsSettings {
     FlagSetting denseRender {true};
     /// @brief Enable chunks frustum culling
     FlagSetting frustumCulling {true};
+    /// @brief Merge faces of full blocks with the same light into larger
+    /// quads (smooth lighted faces are merged only if lights are uniform)
+    FlagSetting greedyMeshing {false};
     /// @brief Skybox texture face resolution
     IntegerSetting skyboxResolution {64 + 32, 64, 128};
     /// @brief Chunk renderer vertices buffer capacity
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace util {
+
+    /// @brief Hash map of 2D integer coordinates with open addressing
+    /// and linear probing, storing entries in a flat array.
+    ///
+    /// Load factor is kept under 0.5, so most lookups read the home slot
+    /// only. Erase shifts the following entries back instead of leaving
+    /// tombstones.
+    /// Inserting may move entries, so pointers to values are valid until
+    /// the next insert or erase
+    template <class T, typename TCoord = int32_t>
+    class FlatMap2D {
+        struct Slot {
+            TCoord x;
+            TCoord y;
+            bool used = false;
+            T value {};
+        };
+        std::vector<Slot> slots;
+        size_t mask = 0;
+        /// @brief 64 - log2 of the slots number
+        unsigned shift = 64;
+        size_t valuesCount = 0;
+
+        /// @brief Fibonacci hashing: high bits of the key multiplied
+        /// by 2^64 / golden ratio
+        inline size_t home(TCoord x, TCoord y) const {
+            uint64_t key = static_cast<uint32_t>(x) |
+                           static_cast<uint64_t>(static_cast<uint32_t>(y)) << 32;
+            return static_cast<size_t>((key * 0x9E3779B97F4A7C15ULL) >> shift);
+        }
+
+        void setCapacity(size_t capacity) {
+            mask = capacity - 1;
+            shift = 64;
+            while (capacity > 1) {
+                capacity >>= 1;
+                shift--;
+            }
+        }
+
+        /// @return index of the slot with the position or the empty
+        /// slot ending its probe sequence
+        inline size_t probe(TCoord x, TCoord y) const {
+            size_t index = home(x, y);
+            while (slots[index].used &&
+                   (slots[index].x != x || slots[index].y != y)) {
+                index = (index + 1) & mask;
+            }
+            return index;
+        }
+
+        void rehash(size_t capacity) {
+            std::vector<Slot> old(capacity);
+            std::swap(old, slots);
+            setCapacity(capacity);
+            for (auto& slot : old) {
+                if (slot.used) {
+                    slots[probe(slot.x, slot.y)] = std::move(slot);
+                }
+            }
+        }
+    public:
+        /// @param capacity initial number of slots (rounded up to a power
+        /// of two)
+        FlatMap2D(size_t capacity = 16) {
+            size_t size = 2;
+            while (size < capacity) {
+                size <<= 1;
+            }
+            slots.resize(size);
+            setCapacity(size);
+        }
+
+        FlatMap2D(const FlatMap2D&) = delete;
+
+        /// @return pointer to the value or nullptr if there is no entry
+        inline T* find(TCoord x, TCoord y) {
+            return const_cast<T*>(std::as_const(*this).find(x, y));
+        }
+
+        inline const T* find(TCoord x, TCoord y) const {
+            size_t index = probe(x, y);
+            if (!slots[index].used) {
+                return nullptr;
+            }
+            return &slots[index].value;
+        }
+
+        /// @brief Get the entry value, inserting a default one if missing
+        T& operator()(TCoord x, TCoord y) {
+            if (auto value = find(x, y)) {
+                return *value;
+            }
+            if ((valuesCount + 1) * 2 > slots.size()) {
+                rehash(slots.size() * 2);
+            }
+            size_t index = probe(x, y);
+            auto& slot = slots[index];
+            slot.x = x;
+            slot.y = y;
+            slot.used = true;
+            valuesCount++;
+            return slot.value;
+        }
+
+        /// @return true if the entry has been erased
+        bool erase(TCoord x, TCoord y) {
+            size_t index = probe(x, y);
+            if (!slots[index].used) {
+                return false;
+            }
+            // move back entries that would become unreachable
+            size_t next = (index + 1) & mask;
+            while (slots[next].used) {
+                size_t nextHome = home(slots[next].x, slots[next].y);
+                if (((next - nextHome) & mask) >= ((next - index) & mask)) {
+                    slots[index] = std::move(slots[next]);
+                    index = next;
+                }
+                next = (next + 1) & mask;
+            }
+            slots[index] = Slot {};
+            valuesCount--;
+            return true;
+        }
+
+        /// @brief Call func(x, y, value) for each entry.
+        /// Entries must not be inserted or erased by the function
+        template <typename Func>
+        void forEach(Func&& func) {
+            for (auto& slot : slots) {
+                if (slot.used) {
+                    func(slot.x, slot.y, slot.value);
+                }
+            }
+        }
+
+        template <typename Func>
+        void forEach(Func&& func) const {
+            for (const auto& slot : slots) {
+                if (slot.used) {
+                    func(slot.x, slot.y, slot.value);
+                }
+            }
+        }
+
+        void clear() {
+            for (auto& slot : slots) {
+                slot = Slot {};
+            }
+            valuesCount = 0;
+        }
+
+        size_t size() const {
+            return valuesCount;
+        }
+
+        size_t capacity() const {
+            return slots.size();
+        }
+    };
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+namespace util {
+    /// @brief FIFO queue stored in a single growable power-of-two array.
+    /// Unlike std::queue (std::deque) elements are contiguous and no memory
+    /// is allocated or freed while the queue size stays within capacity
+    /// @tparam T trivially copyable element type
+    template<typename T>
+    class RingBuffer {
+        std::vector<T> elements;
+        size_t head = 0;
+        size_t count = 0;
+        size_t mask;
+
+        void grow() {
+            std::vector<T> grown(elements.size() * 2);
+            for (size_t i = 0; i < count; i++) {
+                grown[i] = elements[(head + i) & mask];
+            }
+            elements = std::move(grown);
+            head = 0;
+            mask = elements.size() - 1;
+        }
+    public:
+        /// @param capacity initial capacity (rounded up to a power of two)
+        RingBuffer(size_t capacity = 1024) {
+            size_t size = 1;
+            while (size < capacity) {
+                size <<= 1;
+            }
+            elements.resize(size);
+            mask = size - 1;
+        }
+
+        inline void push(const T& value) {
+            if (count == elements.size()) {
+                grow();
+            }
+            elements[(head + count) & mask] = value;
+            count++;
+        }
+
+        /// @brief Remove and return the first element. Queue must not be empty
+        inline T pop() {
+            T value = elements[head];
+            head = (head + 1) & mask;
+            count--;
+            return value;
+        }
+
+        inline const T& front() const {
+            return elements[head];
+        }
+
+        inline bool empty() const {
+            return count == 0;
+        }
+
+        inline size_t size() const {
+            return count;
+        }
+
+        inline size_t capacity() const {
+            return elements.size();
+        }
+
+        inline void clear() {
+            head = 0;
+            count = 0;
+        }
+    };
+}
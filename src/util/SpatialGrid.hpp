@@ -0,0 +1,177 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "FlatMap2D.hpp"
+
+namespace util {
+
+    /// @brief Uniform grid of horizontal (XZ) cells indexing values by their
+    /// bounding boxes, for range queries over many moving objects.
+    ///
+    /// The grid is filled from scratch when values move: clear, add all
+    /// values, then query. References to values are grouped by cells in
+    /// a single array on the first query after adding, so refilling the
+    /// grid does not allocate once it has grown. Values covering too many
+    /// cells are checked by every query instead.
+    template <class T>
+    class SpatialGrid {
+        struct Entry {
+            T value;
+            glm::vec3 min;
+            glm::vec3 max;
+            glm::ivec2 minCell;
+            glm::ivec2 maxCell;
+        };
+        /// @brief Max number of cells referencing a value
+        static inline constexpr int64_t MAX_VALUE_CELLS = 64;
+
+        struct Ref {
+            int x;
+            int z;
+            uint32_t index;
+        };
+        float cellSize;
+        std::vector<Entry> entries;
+        /// @brief Entries references sorted by cells
+        std::vector<Ref> refs;
+        /// @brief Cells ranges of refs
+        FlatMap2D<std::pair<uint32_t, uint32_t>> cells;
+        /// @brief Indices of entries covering more than MAX_VALUE_CELLS
+        std::vector<uint32_t> large;
+        bool built = true;
+
+        inline int cellOf(float coord) const {
+            // limit to prevent integer overflow on infinite boxes
+            return static_cast<int>(
+                std::floor(std::clamp(coord / cellSize, -1e9f, 1e9f))
+            );
+        }
+
+        static inline int64_t countCells(
+            const glm::ivec2& minCell, const glm::ivec2& maxCell
+        ) {
+            return static_cast<int64_t>(maxCell.x - minCell.x + 1) *
+                   (maxCell.y - minCell.y + 1);
+        }
+
+        static inline bool intersects(
+            const Entry& entry, const glm::vec3& min, const glm::vec3& max
+        ) {
+            return entry.min.x <= max.x && entry.max.x >= min.x &&
+                   entry.min.y <= max.y && entry.max.y >= min.y &&
+                   entry.min.z <= max.z && entry.max.z >= min.z;
+        }
+
+        void build() {
+            refs.clear();
+            large.clear();
+            for (uint32_t i = 0; i < entries.size(); i++) {
+                const auto& entry = entries[i];
+                if (countCells(entry.minCell, entry.maxCell) > MAX_VALUE_CELLS) {
+                    large.push_back(i);
+                    continue;
+                }
+                for (int z = entry.minCell.y; z <= entry.maxCell.y; z++) {
+                    for (int x = entry.minCell.x; x <= entry.maxCell.x; x++) {
+                        refs.push_back(Ref {x, z, i});
+                    }
+                }
+            }
+            std::sort(refs.begin(), refs.end(), [](const Ref& a, const Ref& b) {
+                return a.z < b.z || (a.z == b.z && a.x < b.x);
+            });
+            cells.clear();
+            for (uint32_t begin = 0; begin < refs.size();) {
+                uint32_t end = begin + 1;
+                while (end < refs.size() && refs[end].x == refs[begin].x &&
+                       refs[end].z == refs[begin].z) {
+                    end++;
+                }
+                cells(refs[begin].x, refs[begin].z) = {begin, end};
+                begin = end;
+            }
+            built = true;
+        }
+    public:
+        /// @param cellSize cells width and depth
+        explicit SpatialGrid(float cellSize) : cellSize(cellSize) {
+        }
+
+        SpatialGrid(const SpatialGrid&) = delete;
+
+        void clear() {
+            entries.clear();
+            built = false;
+        }
+
+        /// @brief Add value with its bounding box
+        void add(T value, const glm::vec3& min, const glm::vec3& max) {
+            entries.push_back(Entry {
+                std::move(value),
+                min,
+                max,
+                {cellOf(min.x), cellOf(min.z)},
+                {cellOf(max.x), cellOf(max.z)},
+            });
+            built = false;
+        }
+
+        /// @brief Call func(value) once for each value which bounding box
+        /// intersects the box. Values must be checked precisely by
+        /// the function
+        template <typename Func>
+        void query(const glm::vec3& min, const glm::vec3& max, Func&& func) {
+            if (!built) {
+                build();
+            }
+            glm::ivec2 minCell {cellOf(min.x), cellOf(min.z)};
+            glm::ivec2 maxCell {cellOf(max.x), cellOf(max.z)};
+            auto visit = [&](int cx, int cz, std::pair<uint32_t, uint32_t> range) {
+                for (uint32_t i = range.first; i < range.second; i++) {
+                    const auto& entry = entries[refs[i].index];
+                    // value is visited in the first cell shared by the boxes
+                    if (std::max(entry.minCell.x, minCell.x) != cx ||
+                        std::max(entry.minCell.y, minCell.y) != cz) {
+                        continue;
+                    }
+                    if (intersects(entry, min, max)) {
+                        func(entry.value);
+                    }
+                }
+            };
+            for (uint32_t index : large) {
+                if (intersects(entries[index], min, max)) {
+                    func(entries[index].value);
+                }
+            }
+            if (countCells(minCell, maxCell) >
+                static_cast<int64_t>(cells.size())) {
+                cells.forEach([&](int cx, int cz, const auto& range) {
+                    if (cx >= minCell.x && cx <= maxCell.x &&
+                        cz >= minCell.y && cz <= maxCell.y) {
+                        visit(cx, cz, range);
+                    }
+                });
+                return;
+            }
+            for (int cz = minCell.y; cz <= maxCell.y; cz++) {
+                for (int cx = minCell.x; cx <= maxCell.x; cx++) {
+                    if (auto range = cells.find(cx, cz)) {
+                        visit(cx, cz, *range);
+                    }
+                }
+            }
+        }
+
+        size_t size() const {
+            return entries.size();
+        }
+    };
+}
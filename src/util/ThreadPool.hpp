@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include <atomic>
 #include <chrono>
 #include <condition_variable>
@@ -14,6 +15,24 @@
 #include "interfaces/Task.hpp"
 
 namespace util {
+    /// @brief Get number of threads to use
+    /// @param maxWorkers max number of workers. Special values: 0 is
+    /// unlimited, -2 is half of auto count, -4 is quarter.
+    inline uint get_workers_count(int maxWorkers) {
+        uint numThreads = std::thread::hardware_concurrency();
+        switch (maxWorkers) {
+            case 0:
+                return std::max(1U, numThreads);
+            case -2:
+                return std::max(1U, numThreads / 2);
+            case -4:
+                return std::max(1U, numThreads / 4);
+            default:
+                return std::max(
+                    1U, std::min(numThreads, static_cast<uint>(maxWorkers))
+                );
+        }
+    }
 
     template <class J, class T>
     struct ThreadPoolResult {
@@ -120,22 +139,7 @@ namespace util {
             int maxWorkers=UNLIMITED
         )
             : logger(std::move(name)), resultConsumer(resultConsumer) {
-            uint numThreads = std::thread::hardware_concurrency();
-            switch (maxWorkers) {
-                case UNLIMITED:
-                    break;
-                case HALF:
-                    numThreads = std::max(1U, numThreads);
-                    break;
-                case QUARTER:
-                    numThreads = std::max(1U, numThreads / 4);
-                    break;
-                default:
-                    numThreads = std::max(
-                        1U, std::min(numThreads, static_cast<uint>(maxWorkers))
-                    );
-                    break;
-            }
+            uint numThreads = get_workers_count(maxWorkers);
             for (uint i = 0; i < numThreads; i++) {
                 threads.emplace_back(
                     &ThreadPool<T, R>::threadLoop, this, i, workersSupplier()
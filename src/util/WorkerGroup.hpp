@@ -0,0 +1,136 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "typedefs.hpp"
+
+namespace util {
+
+    /// @brief Fixed set of threads executing batches of independent tasks.
+    /// Unlike ThreadPool, run() blocks until the whole batch is done
+    /// and the calling thread takes part as worker 0.
+    class WorkerGroup {
+    public:
+        /// @brief Task function taking task index and worker index
+        using TaskFunc = std::function<void(size_t, uint)>;
+    private:
+        std::vector<std::thread> threads;
+        std::mutex mutex;
+        std::condition_variable startCondition;
+        std::condition_variable doneCondition;
+        const TaskFunc* task = nullptr;
+        size_t tasksCount = 0;
+        std::atomic<size_t> nextTask = 0;
+        uint activeWorkers = 0;
+        uint64_t batchId = 0;
+        bool working = true;
+        std::exception_ptr error = nullptr;
+
+        void process(uint workerIndex) {
+            size_t index;
+            while ((index = nextTask++) < tasksCount) {
+                try {
+                    (*task)(index, workerIndex);
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (error == nullptr) {
+                        error = std::current_exception();
+                    }
+                }
+            }
+        }
+
+        void threadLoop(uint workerIndex) {
+            uint64_t lastBatch = 0;
+            while (true) {
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    startCondition.wait(lock, [this, lastBatch] {
+                        return !working || batchId != lastBatch;
+                    });
+                    if (!working) {
+                        break;
+                    }
+                    lastBatch = batchId;
+                }
+                process(workerIndex);
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (--activeWorkers == 0) {
+                        doneCondition.notify_all();
+                    }
+                }
+            }
+        }
+    public:
+        /// @param threadsCount number of additional threads
+        /// (0 - all tasks are executed in the calling thread)
+        WorkerGroup(uint threadsCount) {
+            for (uint i = 0; i < threadsCount; i++) {
+                threads.emplace_back(&WorkerGroup::threadLoop, this, i + 1);
+            }
+        }
+
+        ~WorkerGroup() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                working = false;
+            }
+            startCondition.notify_all();
+            for (auto& thread : threads) {
+                thread.join();
+            }
+        }
+
+        WorkerGroup(const WorkerGroup&) = delete;
+
+        /// @brief Execute func for each index in [0, count) and wait for
+        /// completion. Not reentrant.
+        /// @param count number of tasks
+        /// @param func task function, must be thread-safe
+        /// @throws rethrows first exception thrown by a task
+        void run(size_t count, const TaskFunc& func) {
+            if (threads.empty() || count <= 1) {
+                for (size_t i = 0; i < count; i++) {
+                    func(i, 0);
+                }
+                return;
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                task = &func;
+                tasksCount = count;
+                nextTask = 0;
+                error = nullptr;
+                activeWorkers = threads.size();
+                batchId++;
+            }
+            startCondition.notify_all();
+            process(0);
+
+            std::exception_ptr batchError;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                doneCondition.wait(lock, [this] {
+                    return activeWorkers == 0;
+                });
+                task = nullptr;
+                batchError = error;
+            }
+            if (batchError) {
+                std::rethrow_exception(batchError);
+            }
+        }
+
+        /// @return total number of workers including the calling thread
+        uint getWorkersCount() const {
+            return threads.size() + 1;
+        }
+    };
+}
@@ -9,6 +9,15 @@
 
 namespace fs = std::filesystem;
 
+static int read_integer(util::ArgsReader& reader) {
+    auto token = reader.next();
+    try {
+        return std::stoi(token);
+    } catch (const std::logic_error&) {
+        throw std::runtime_error("integer expected, got " + token);
+    }
+}
+
 static bool perform_keyword(
     util::ArgsReader& reader, const std::string& keyword, CoreParameters& params
 ) {
@@ -28,6 +37,15 @@ static bool perform_keyword(
         std::cout << " --headless - run in headless mode\n";
         std::cout << " --test <path> - test script file\n";
         std::cout << " --script <path> - main script file\n";
+        std::cout << " --pregen <world> - pre-generate world chunks\n";
+        std::cout << " --pregen-area <x1> <z1> <x2> <z2> - pre-generation "
+                     "area in chunks\n";
+        std::cout << " --pregen-radius <radius> - pre-generation area "
+                     "radius in chunks around 0,0\n";
+        std::cout << " --bench-meshing <world> - run chunks meshing benchmark "
+                     "in the pre-generation area\n";
+        std::cout << " --bench-passes <count> - number of meshing benchmark "
+                     "passes\n";
         std::cout << std::endl;
         return false;
     } else if (keyword == "--version") {
@@ -43,6 +61,23 @@ static bool perform_keyword(
         auto token = reader.next();
         params.testMode = false;
         params.scriptFile = fs::u8path(token);
+    } else if (keyword == "--pregen") {
+        params.headless = true;
+        params.pregenWorld = reader.next();
+    } else if (keyword == "--pregen-area") {
+        glm::ivec4 area;
+        for (int i = 0; i < 4; i++) {
+            area[i] = read_integer(reader);
+        }
+        params.pregenArea = area;
+    } else if (keyword == "--pregen-radius") {
+        int radius = read_integer(reader);
+        params.pregenArea = glm::ivec4(-radius, -radius, radius, radius);
+    } else if (keyword == "--bench-meshing") {
+        params.headless = true;
+        params.benchmarkWorld = reader.next();
+    } else if (keyword == "--bench-passes") {
+        params.benchmarkPasses = read_integer(reader);
     } else {
         throw std::runtime_error("unknown argument " + keyword);
     }
@@ -1,5 +1,6 @@
 #include "Chunk.hpp"
 
+#include <algorithm>
 #include <utility>
 
 #include "content/ContentReport.hpp"
@@ -15,13 +16,23 @@ Chunk::Chunk(int xpos, int zpos) : x(xpos), z(zpos) {
 
 void Chunk::updateHeights() {
     for (uint i = 0; i < CHUNK_VOL; i++) {
-        if (voxels[i].id != 0) {
+        if (i % CHUNK_SECTION_VOL == 0 &&
+            voxels.isEmpty(i / CHUNK_SECTION_VOL)) {
+            i += CHUNK_SECTION_VOL - 1;
+            continue;
+        }
+        if (voxels.get(i).id != 0) {
             bottom = i / (CHUNK_D * CHUNK_W);
             break;
         }
     }
     for (int i = CHUNK_VOL - 1; i >= 0; i--) {
-        if (voxels[i].id != 0) {
+        if ((i + 1) % CHUNK_SECTION_VOL == 0 &&
+            voxels.isEmpty(i / CHUNK_SECTION_VOL)) {
+            i -= CHUNK_SECTION_VOL - 1;
+            continue;
+        }
+        if (voxels.get(i).id != 0) {
             top = i / (CHUNK_D * CHUNK_W) + 1;
             break;
         }
@@ -57,9 +68,9 @@ std::shared_ptr<Inventory> Chunk::getBlockInventory(uint x, uint y, uint z)
 
 std::unique_ptr<Chunk> Chunk::clone() const {
     auto other = std::make_unique<Chunk>(x, z);
-    for (uint i = 0; i < CHUNK_VOL; i++) {
-        other->voxels[i] = voxels[i];
-    }
+    auto buffer = std::make_unique<voxel[]>(CHUNK_VOL);
+    voxels.read(buffer.get());
+    other->voxels.write(buffer.get(), false);
     other->lightmap.set(&lightmap);
     return other;
 }
@@ -78,21 +89,37 @@ std::unique_ptr<Chunk> Chunk::clone() const {
 std::unique_ptr<ubyte[]> Chunk::encode() const {
     auto buffer = std::make_unique<ubyte[]>(CHUNK_DATA_LEN);
     auto dst = reinterpret_cast<uint16_t*>(buffer.get());
-    for (uint i = 0; i < CHUNK_VOL; i++) {
-        dst[i] = dataio::h2le(voxels[i].id);
-        dst[CHUNK_VOL + i] = dataio::h2le(blockstate2int(voxels[i].state));
+    for (uint s = 0; s < CHUNK_SECTIONS; s++) {
+        uint begin = s * CHUNK_SECTION_VOL;
+        voxel vox;
+        if (voxels.getUniform(s, vox)) {
+            std::fill_n(dst + begin, CHUNK_SECTION_VOL, dataio::h2le(vox.id));
+            std::fill_n(
+                dst + CHUNK_VOL + begin,
+                CHUNK_SECTION_VOL,
+                dataio::h2le(blockstate2int(vox.state))
+            );
+            continue;
+        }
+        for (uint i = begin; i < begin + CHUNK_SECTION_VOL; i++) {
+            vox = voxels.get(i);
+            dst[i] = dataio::h2le(vox.id);
+            dst[CHUNK_VOL + i] = dataio::h2le(blockstate2int(vox.state));
+        }
     }
     return buffer;
 }
 
-bool Chunk::decode(const ubyte* data) {
+bool Chunk::decode(const ubyte* data, bool pack) {
     auto src = reinterpret_cast<const uint16_t*>(data);
+    auto buffer = std::make_unique<voxel[]>(CHUNK_VOL);
     for (uint i = 0; i < CHUNK_VOL; i++) {
-        voxel& vox = voxels[i];
+        voxel& vox = buffer[i];
 
         vox.id = dataio::le2h(src[i]);
         vox.state = int2blockstate(dataio::le2h(src[CHUNK_VOL + i]));
     }
+    voxels.write(buffer.get(), pack);
     return true;
 }
 
@@ -2,6 +2,7 @@
 
 #include <stdlib.h>
 
+#include <algorithm>
 #include <memory>
 #include <unordered_map>
 
@@ -10,10 +11,16 @@
 #include "util/SmallHeap.hpp"
 #include "maths/aabb.hpp"
 #include "voxel.hpp"
+#include "ChunkVoxels.hpp"
 
 /// @brief Total bytes number of chunk voxel data
 inline constexpr int CHUNK_DATA_LEN = CHUNK_VOL * 4;
 
+static_assert(CHUNK_SECTIONS <= 32);
+/// @brief Bit mask of all chunk sections
+inline constexpr uint32_t CHUNK_SECTIONS_MASK =
+    static_cast<uint32_t>((1ULL << CHUNK_SECTIONS) - 1);
+
 class ContentReport;
 class Inventory;
 
@@ -26,7 +33,7 @@ class Chunk {
 public:
     int x, z;
     int bottom, top;
-    voxel voxels[CHUNK_VOL] {};
+    ChunkVoxels voxels;
     Lightmap lightmap;
     struct {
         bool modified : 1;
@@ -43,6 +50,11 @@ public:
     ChunkInventoriesMap inventories;
     /// @brief Blocks metadata heap
     BlocksMetadata blocksMetadata;
+    /// @brief Hash of the voxels data stored in regions
+    /// (valid while flags.unsaved is not set)
+    uint32_t voxelsHash = 0;
+    /// @brief Bit mask of sections modified since the chunk was meshed
+    uint32_t modifiedSections = 0;
 
     Chunk(int x, int z);
 
@@ -63,8 +75,28 @@ public:
     /// @return inventory bound to the given block or nullptr
     std::shared_ptr<Inventory> getBlockInventory(uint x, uint y, uint z) const;
 
-    inline void setModifiedAndUnsaved() {
+    /// @brief Mark all sections modified
+    inline void setModified() {
+        flags.modified = true;
+        modifiedSections = CHUNK_SECTIONS_MASK;
+    }
+
+    /// @brief Mark sections modified by change of a block or light at y.
+    /// Faces and ambient occlusion of blocks at y-1..y+1 depend on it
+    inline void setModified(int y) {
         flags.modified = true;
+        uint lo = std::max(y - 1, 0) / CHUNK_SECTION_H;
+        uint hi = std::min(y + 1, CHUNK_H - 1) / CHUNK_SECTION_H;
+        modifiedSections |= (((2ULL << hi) - 1) & ~((1ULL << lo) - 1));
+    }
+
+    inline void setModifiedAndUnsaved() {
+        setModified();
+        flags.unsaved = true;
+    }
+
+    inline void setModifiedAndUnsaved(int y) {
+        setModified(y);
         flags.unsaved = true;
     }
 
@@ -72,8 +104,9 @@ public:
     /// @see /doc/specs/region_voxels_chunk_spec.md
     std::unique_ptr<ubyte[]> encode() const;
 
+    /// @param pack store voxels palette-compressed (see ChunkVoxels)
     /// @return true if all is fine
-    bool decode(const ubyte* data);
+    bool decode(const ubyte* data, bool pack = false);
 
     static void convert(ubyte* data, const ContentReport* report);
 
@@ -0,0 +1,244 @@
+#include "ChunkVoxels.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <optional>
+#include <unordered_map>
+
+static inline uint32_t voxel2int(voxel vox) {
+    uint32_t value;
+    std::memcpy(&value, &vox, sizeof(value));
+    return value;
+}
+
+PalettedVoxels::PalettedVoxels(const voxel* src) {
+    std::vector<voxel> uniqueVoxels;
+    std::unordered_map<uint32_t, uint16_t> paletteMap;
+    auto voxelIndices = std::make_unique<uint16_t[]>(CHUNK_SECTION_VOL);
+
+    // voxels often go in runs, so repeated ones are not looked up
+    uint32_t prevValue = voxel2int(src[0]);
+    uint16_t prevIndex = 0;
+    uniqueVoxels.push_back(src[0]);
+    paletteMap[prevValue] = 0;
+    for (uint i = 0; i < CHUNK_SECTION_VOL; i++) {
+        uint32_t value = voxel2int(src[i]);
+        if (value != prevValue) {
+            const auto& found = paletteMap.find(value);
+            if (found == paletteMap.end()) {
+                prevIndex = uniqueVoxels.size();
+                paletteMap[value] = prevIndex;
+                uniqueVoxels.push_back(src[i]);
+            } else {
+                prevIndex = found->second;
+            }
+            prevValue = value;
+        }
+        voxelIndices[i] = prevIndex;
+    }
+    paletteSize = uniqueVoxels.size();
+    palette = std::make_unique<voxel[]>(paletteSize);
+    std::memcpy(palette.get(), uniqueVoxels.data(), paletteSize * sizeof(voxel));
+
+    bits = 0;
+    while ((1U << bits) < paletteSize) {
+        bits = bits == 0 ? 1 : bits * 2;
+    }
+    wordShift = 0;
+    if (bits == 0) {
+        return;
+    }
+    while ((bits << wordShift) < 64) {
+        wordShift++;
+    }
+    size_t wordsCount = CHUNK_SECTION_VOL >> wordShift;
+    indices = std::make_unique<uint64_t[]>(wordsCount);
+    uint indicesPerWord = 1 << wordShift;
+    for (size_t w = 0; w < wordsCount; w++) {
+        uint64_t word = 0;
+        for (uint j = 0; j < indicesPerWord; j++) {
+            word |= static_cast<uint64_t>(
+                voxelIndices[(w << wordShift) + j]
+            ) << (j * bits);
+        }
+        indices[w] = word;
+    }
+}
+
+void PalettedVoxels::unpack(voxel* dst) const {
+    if (bits == 0) {
+        std::fill_n(dst, CHUNK_SECTION_VOL, palette[0]);
+        return;
+    }
+    uint indicesPerWord = 1 << wordShift;
+    uint64_t mask = (1ULL << bits) - 1;
+    size_t wordsCount = CHUNK_SECTION_VOL >> wordShift;
+    for (size_t w = 0; w < wordsCount; w++) {
+        uint64_t word = indices[w];
+        for (uint j = 0; j < indicesPerWord; j++) {
+            *(dst++) = palette[word & mask];
+            word >>= bits;
+        }
+    }
+}
+
+size_t PalettedVoxels::getMemoryUsage() const {
+    size_t size = sizeof(PalettedVoxels) + paletteSize * sizeof(voxel);
+    if (bits) {
+        size += (CHUNK_SECTION_VOL >> wordShift) * sizeof(uint64_t);
+    }
+    return size;
+}
+
+/// @brief Shared packed section of air
+static const PalettedVoxels& get_air_section() {
+    static const voxel air[CHUNK_SECTION_VOL] {};
+    static const PalettedVoxels section(air);
+    return section;
+}
+
+/// @return first voxel value if all section voxels are the same
+static std::optional<voxel> find_uniform(const voxel* src) {
+    uint32_t value = voxel2int(src[0]);
+    for (uint i = 1; i < CHUNK_SECTION_VOL; i++) {
+        if (voxel2int(src[i]) != value) {
+            return std::nullopt;
+        }
+    }
+    return src[0];
+}
+
+ChunkVoxels::ChunkVoxels() {
+    for (auto& section : sections) {
+        section.packed = &get_air_section();
+    }
+}
+
+void ChunkVoxels::beginRead() const {
+    readers.fetch_add(1);
+    // pairs with the fence in collect: either the reader is counted or
+    // it loads sections replaced before
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+void ChunkVoxels::endRead() const {
+    readers.fetch_sub(1, std::memory_order_release);
+}
+
+void ChunkVoxels::collect() {
+    if (retired.empty()) {
+        return;
+    }
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (readers.load(std::memory_order_acquire) == 0) {
+        retired.clear();
+    }
+}
+
+void ChunkVoxels::setPacked(
+    uint sectionIndex, std::unique_ptr<PalettedVoxels> data
+) {
+    const PalettedVoxels* packed = data ? data.get() : &get_air_section();
+    sections[sectionIndex].packed.store(packed, std::memory_order_release);
+    if (packedData[sectionIndex]) {
+        retired.push_back(std::move(packedData[sectionIndex]));
+    }
+    packedData[sectionIndex] = std::move(data);
+}
+
+voxel* ChunkVoxels::unpack(uint sectionIndex) {
+    auto& section = sections[sectionIndex];
+    auto buffer = std::make_unique<voxel[]>(CHUNK_SECTION_VOL);
+    section.packed.load(std::memory_order_relaxed)->unpack(buffer.get());
+    voxel* flat = buffer.get();
+    flatBuffers[sectionIndex] = std::move(buffer);
+    section.flat.store(flat, std::memory_order_release);
+    // packed data is not used anymore, but readers may still use it
+    if (packedData[sectionIndex]) {
+        retired.push_back(std::move(packedData[sectionIndex]));
+    }
+    collect();
+    return flat;
+}
+
+void ChunkVoxels::read(voxel* dst) const {
+    for (uint i = 0; i < CHUNK_SECTIONS; i++) {
+        readSection(i, dst + i * CHUNK_SECTION_VOL);
+    }
+}
+
+void ChunkVoxels::readSection(uint sectionIndex, voxel* dst) const {
+    const auto& section = sections[sectionIndex];
+    if (auto flat = section.flat.load(std::memory_order_acquire)) {
+        std::memcpy(dst, flat, CHUNK_SECTION_VOL * sizeof(voxel));
+    } else {
+        section.packed.load(std::memory_order_acquire)->unpack(dst);
+    }
+}
+
+void ChunkVoxels::write(const voxel* src, bool pack) {
+    for (uint i = 0; i < CHUNK_SECTIONS; i++) {
+        auto& section = sections[i];
+        const voxel* sectionSrc = src + i * CHUNK_SECTION_VOL;
+        voxel* flat = section.flat.load(std::memory_order_relaxed);
+        if (flat == nullptr) {
+            auto uniform = find_uniform(sectionSrc);
+            if (uniform && voxel2int(*uniform) == 0) {
+                setPacked(i, nullptr);
+                continue;
+            }
+            if (uniform || pack) {
+                setPacked(i, std::make_unique<PalettedVoxels>(sectionSrc));
+                continue;
+            }
+        }
+        if (flat == nullptr) {
+            auto buffer = std::make_unique<voxel[]>(CHUNK_SECTION_VOL);
+            std::memcpy(
+                buffer.get(), sectionSrc, CHUNK_SECTION_VOL * sizeof(voxel)
+            );
+            flat = buffer.get();
+            flatBuffers[i] = std::move(buffer);
+            section.flat.store(flat, std::memory_order_release);
+            continue;
+        }
+        std::memcpy(flat, sectionSrc, CHUNK_SECTION_VOL * sizeof(voxel));
+    }
+    collect();
+}
+
+bool ChunkVoxels::isPacked(uint sectionIndex) const {
+    return sections[sectionIndex].flat.load(std::memory_order_acquire) ==
+           nullptr;
+}
+
+bool ChunkVoxels::getUniform(uint sectionIndex, voxel& vox) const {
+    const auto& section = sections[sectionIndex];
+    if (section.flat.load(std::memory_order_acquire)) {
+        return false;
+    }
+    auto packed = section.packed.load(std::memory_order_acquire);
+    if (!packed->isUniform()) {
+        return false;
+    }
+    vox = packed->get(0);
+    return true;
+}
+
+size_t ChunkVoxels::getMemoryUsage() const {
+    size_t size = 0;
+    for (uint i = 0; i < CHUNK_SECTIONS; i++) {
+        if (flatBuffers[i]) {
+            size += CHUNK_SECTION_VOL * sizeof(voxel);
+        }
+    }
+    for (const auto& packed : packedData) {
+        if (packed) {
+            size += packed->getMemoryUsage();
+        }
+    }
+    for (const auto& packed : retired) {
+        size += packed->getMemoryUsage();
+    }
+    return size;
+}
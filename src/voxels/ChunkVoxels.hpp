@@ -0,0 +1,154 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "constants.hpp"
+#include "typedefs.hpp"
+#include "voxel.hpp"
+
+/// @brief Read-only palette-compressed voxels of a chunk section.
+/// Each voxel is stored as an index in the palette of unique voxels.
+/// Indices are bit-packed into 64-bit words, index size is a power of two
+/// (0 bits if all voxels are the same)
+class PalettedVoxels {
+    std::unique_ptr<voxel[]> palette;
+    std::unique_ptr<uint64_t[]> indices;
+    uint paletteSize;
+    uint bits;
+    /// @brief log2 of number of indices per word
+    uint wordShift;
+public:
+    /// @param src CHUNK_SECTION_VOL voxels
+    PalettedVoxels(const voxel* src);
+    PalettedVoxels(const PalettedVoxels&) = delete;
+
+    inline const voxel& get(uint index) const {
+        if (bits == 0) {
+            return palette[0];
+        }
+        uint64_t word = indices[index >> wordShift];
+        uint shift = (index & ((1 << wordShift) - 1)) * bits;
+        return palette[(word >> shift) & ((1ULL << bits) - 1)];
+    }
+
+    /// @brief Decode all voxels
+    /// @param dst CHUNK_SECTION_VOL voxels
+    void unpack(voxel* dst) const;
+
+    /// @return number of unique voxels
+    uint getPaletteSize() const {
+        return paletteSize;
+    }
+
+    /// @brief Check if all voxels are the same
+    bool isUniform() const {
+        return bits == 0;
+    }
+
+    /// @return bytes used by palette and indices
+    size_t getMemoryUsage() const;
+};
+
+/// @brief Chunk voxels split into CHUNK_SECTIONS sections. Each section is
+/// stored either as a flat array or palette-compressed. Packed section is
+/// unpacked when a writeable voxel is requested. Uniform sections are always
+/// stored packed as a single voxel value.
+///
+/// Voxels may be read by other threads while the chunk is modified
+/// by the main thread. Replaced packed sections are freed by the main
+/// thread when there are no readers (see beginRead)
+class ChunkVoxels {
+    struct Section {
+        /// @brief Flat voxels array (nullptr if section is packed)
+        std::atomic<voxel*> flat {nullptr};
+        /// @brief Packed voxels used if there is no flat array
+        std::atomic<const PalettedVoxels*> packed {nullptr};
+    };
+    Section sections[CHUNK_SECTIONS];
+    std::unique_ptr<voxel[]> flatBuffers[CHUNK_SECTIONS];
+    /// @brief Packed sections (nullptr for shared air section)
+    std::unique_ptr<PalettedVoxels> packedData[CHUNK_SECTIONS];
+    /// @brief Replaced packed sections which may still be in use
+    std::vector<std::unique_ptr<PalettedVoxels>> retired;
+    /// @brief Number of readers of other threads
+    mutable std::atomic<int> readers {0};
+
+    voxel* unpack(uint sectionIndex);
+    /// @brief Replace packed section data (keeping the previous one until
+    /// there are no readers)
+    void setPacked(uint sectionIndex, std::unique_ptr<PalettedVoxels> data);
+    /// @brief Free retired sections if there are no readers
+    void collect();
+public:
+    /// @brief Create voxels filled with air
+    ChunkVoxels();
+    ChunkVoxels(const ChunkVoxels&) = delete;
+
+    /// @brief Get voxel by index (see vox_index). Section is not unpacked,
+    /// the reference is valid until the section is modified
+    inline const voxel& get(uint index) const {
+        const auto& section = sections[index / CHUNK_SECTION_VOL];
+        if (auto flat = section.flat.load(std::memory_order_acquire)) {
+            return flat[index % CHUNK_SECTION_VOL];
+        }
+        return section.packed.load(std::memory_order_acquire)
+            ->get(index % CHUNK_SECTION_VOL);
+    }
+
+    /// @brief Start reading voxels from a thread other than the main one.
+    /// Section data replaced before endRead stays valid
+    void beginRead() const;
+
+    void endRead() const;
+
+    /// @brief Get writeable voxel by index. Section is unpacked if needed.
+    /// Main thread only
+    /// @return pointer valid while the chunk exists
+    inline voxel* getWriteable(uint index) {
+        uint sectionIndex = index / CHUNK_SECTION_VOL;
+        auto flat = sections[sectionIndex].flat.load(std::memory_order_relaxed);
+        if (flat == nullptr) {
+            flat = unpack(sectionIndex);
+        }
+        return flat + index % CHUNK_SECTION_VOL;
+    }
+
+    inline void set(uint index, voxel vox) {
+        *getWriteable(index) = vox;
+    }
+
+    /// @brief Copy all voxels
+    /// @param dst CHUNK_VOL voxels
+    void read(voxel* dst) const;
+
+    /// @brief Copy section voxels
+    /// @param dst CHUNK_SECTION_VOL voxels
+    void readSection(uint sectionIndex, voxel* dst) const;
+
+    /// @brief Replace all voxels. Flat sections are overwritten in place.
+    /// Must not be called while the chunk is accessed by other threads
+    /// @param src CHUNK_VOL voxels
+    /// @param pack store packed sections palette-compressed
+    /// (otherwise they are unpacked unless uniform)
+    void write(const voxel* src, bool pack);
+
+    /// @brief Check if section is palette-compressed
+    bool isPacked(uint sectionIndex) const;
+
+    /// @brief Check if section is stored as a single voxel value.
+    /// Flat sections are not scanned, so false does not mean that
+    /// section voxels differ
+    /// @param vox [out] value of all section voxels
+    bool getUniform(uint sectionIndex, voxel& vox) const;
+
+    /// @brief Check if section is stored as a single air voxel
+    bool isEmpty(uint sectionIndex) const {
+        voxel vox;
+        return getUniform(sectionIndex, vox) && vox.id == BLOCK_AIR;
+    }
+
+    /// @return bytes used by sections data
+    size_t getMemoryUsage() const;
+};
@@ -46,11 +46,11 @@ void Chunks::configure(int32_t x, int32_t z, uint32_t radius) {
     }
 }
 
-voxel* Chunks::get(int32_t x, int32_t y, int32_t z) const {
+const voxel* Chunks::get(int32_t x, int32_t y, int32_t z) const {
     return blocks_agent::get(*this, x, y, z);
 }
 
-voxel& Chunks::require(int32_t x, int32_t y, int32_t z) const {
+const voxel& Chunks::require(int32_t x, int32_t y, int32_t z) const {
     return blocks_agent::require(*this, x, y, z);
 }
 
@@ -58,7 +58,7 @@ const AABB* Chunks::isObstacleAt(float x, float y, float z) const {
     int ix = std::floor(x);
     int iy = std::floor(y);
     int iz = std::floor(z);
-    voxel* v = get(ix, iy, iz);
+    const voxel* v = get(ix, iy, iz);
     if (v == nullptr) {
         if (iy >= CHUNK_H) {
             return nullptr;
@@ -96,7 +96,7 @@ bool Chunks::isReplaceableBlock(int32_t x, int32_t y, int32_t z) {
 }
 
 bool Chunks::isObstacleBlock(int32_t x, int32_t y, int32_t z) {
-    voxel* v = get(x, y, z);
+    const voxel* v = get(x, y, z);
     if (v == nullptr) return false;
     return indices.blocks.require(v->id).obstacle;
 }
@@ -160,6 +160,13 @@ Chunk* Chunks::getChunk(int x, int z) const {
     return nullptr;
 }
 
+std::shared_ptr<Chunk> Chunks::fetch(int32_t x, int32_t z) const {
+    if (auto ptr = areaMap.getIf(x, z)) {
+        return *ptr;
+    }
+    return nullptr;
+}
+
 glm::ivec3 Chunks::seekOrigin(
     const glm::ivec3& srcpos, const Block& def, blockstate state
 ) const {
@@ -203,7 +210,7 @@ void Chunks::set(
     blocks_agent::set(*this, x, y, z, id, state);
 }
 
-voxel* Chunks::rayCast(
+const voxel* Chunks::rayCast(
     const glm::vec3& start,
     const glm::vec3& dir,
     float maxDist,
@@ -251,8 +258,9 @@ glm::vec3 Chunks::rayCastToObstacle(
     float tyMax = (tyDelta < infinity) ? tyDelta * ydist : infinity;
     float tzMax = (tzDelta < infinity) ? tzDelta * zdist : infinity;
 
+    blocks_agent::VoxelCursor<Chunks> cursor(*this);
     while (t <= maxDist) {
-        voxel* voxel = get(ix, iy, iz);
+        const voxel* voxel = blocks_agent::get(cursor, ix, iy, iz);
         if (voxel) {
             const auto& def = indices.blocks.require(voxel->id);
             if (def.obstacle) {
@@ -266,8 +274,9 @@ glm::vec3 Chunks::rayCastToObstacle(
 
                     glm::ivec3 offset {};
                     if (voxel->state.segment) {
-                        offset = seekOrigin({ix, iy, iz}, def, voxel->state) -
-                                 glm::ivec3(ix, iy, iz);
+                        offset = blocks_agent::seek_origin(
+                                     cursor, {ix, iy, iz}, def, voxel->state
+                                 ) - glm::ivec3(ix, iy, iz);
                     }
 
                     for (const auto& box : hitboxes) {
@@ -321,13 +330,23 @@ void Chunks::resize(uint32_t newW, uint32_t newD) {
 }
 
 bool Chunks::putChunk(const std::shared_ptr<Chunk>& chunk) {
-    if (areaMap.set(chunk->x, chunk->z, chunk)) {
-        if (events) {
-            events->trigger(LevelEventType::CHUNK_SHOWN, chunk.get());
-        }
+    auto current = areaMap.getIf(chunk->x, chunk->z);
+    if (current == nullptr) {
+        return false;
+    }
+    if (*current == chunk) {
+        // the chunk ticket is already held
         return true;
     }
-    return false;
+    auto previous = *current;
+    areaMap.set(chunk->x, chunk->z, chunk);
+    if (events) {
+        events->trigger(LevelEventType::CHUNK_SHOWN, chunk.get());
+        if (previous) {
+            events->trigger(LevelEventType::CHUNK_HIDDEN, previous.get());
+        }
+    }
+    return true;
 }
 
 // reduce nesting on next modification
@@ -373,8 +392,8 @@ void Chunks::getVoxels(VoxelsVolume& volume, bool backlight) const {
                     }
                 }
             } else {
-                const voxel* cvoxels = chunk->voxels;
-                const light_t* clights = chunk->lightmap.getLights();
+                const auto& cvoxels = chunk->voxels;
+                const auto& clights = chunk->lightmap;
                 for (int ly = y; ly < y + h; ly++) {
                     for (int lz = std::max(z, cz * CHUNK_D);
                              lz < std::min(z + d, (cz + 1) * CHUNK_D);
@@ -390,8 +409,8 @@ void Chunks::getVoxels(VoxelsVolume& volume, bool backlight) const {
                                 CHUNK_W,
                                 CHUNK_D
                             );
-                            voxels[vidx] = cvoxels[cidx];
-                            light_t light = clights[cidx];
+                            voxels[vidx] = cvoxels.get(cidx);
+                            light_t light = clights.get(cidx);
                             if (backlight) {
                                 const auto block =
                                     indices.blocks.get(voxels[vidx].id);
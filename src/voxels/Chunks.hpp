@@ -52,9 +52,14 @@ public:
 
     void configure(int32_t x, int32_t z, uint32_t radius);
 
+    /// @brief Put the chunk to the area, replacing the previous one
+    /// @return true if the chunk is inside the area
     bool putChunk(const std::shared_ptr<Chunk>& chunk);
 
     Chunk* getChunk(int32_t x, int32_t z) const;
+    /// @brief Main thread only (chunks area is modified by it)
+    /// @return shared pointer to the chunk or nullptr if not loaded
+    std::shared_ptr<Chunk> fetch(int32_t x, int32_t z) const;
     Chunk* getChunkByVoxel(int32_t x, int32_t y, int32_t z) const;
 
     template <typename T>
@@ -64,12 +69,8 @@ public:
         );
     }
 
-    voxel* get(int32_t x, int32_t y, int32_t z) const;
-    voxel& require(int32_t x, int32_t y, int32_t z) const;
-
-    inline voxel* get(const glm::ivec3& pos) {
-        return get(pos.x, pos.y, pos.z);
-    }
+    const voxel* get(int32_t x, int32_t y, int32_t z) const;
+    const voxel& require(int32_t x, int32_t y, int32_t z) const;
 
     inline const voxel* get(const glm::ivec3& pos) const {
         return get(pos.x, pos.y, pos.z);
@@ -102,7 +103,7 @@ public:
 
     void setRotation(int32_t x, int32_t y, int32_t z, uint8_t rotation);
 
-    voxel* rayCast(
+    const voxel* rayCast(
         const glm::vec3& start,
         const glm::vec3& dir,
         float maxLength,
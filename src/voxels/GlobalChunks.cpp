@@ -1,12 +1,14 @@
 #include "GlobalChunks.hpp"
 
 #include <algorithm>
+#include <cassert>
 
 #include "content/Content.hpp"
 #include "coders/json.hpp"
 #include "debug/Logger.hpp"
 #include "files/WorldFiles.hpp"
 #include "items/Inventories.hpp"
+#include "lighting/Lighting.hpp"
 #include "lighting/Lightmap.hpp"
 #include "maths/voxmaths.hpp"
 #include "objects/Entities.hpp"
@@ -22,7 +24,8 @@ static debug::Logger logger("chunks-storage");
 
 GlobalChunks::GlobalChunks(Level& level)
     : level(level), indices(*level.content.getIndices()) {
-    chunksMap.max_load_factor(CHUNKS_MAP_MAX_LOAD_FACTOR);
+    level.getWorld()->wfile->getRegions().lightsContentHash =
+        Lighting::calculateContentHash(indices);
 }
 
 void GlobalChunks::setOnUnload(consumer<Chunk&> onUnload) {
@@ -30,18 +33,19 @@ void GlobalChunks::setOnUnload(consumer<Chunk&> onUnload) {
 }
 
 std::shared_ptr<Chunk> GlobalChunks::fetch(int x, int z) {
-    const auto& found = chunksMap.find(keyfrom(x, z));
-    if (found == chunksMap.end()) {
-        return nullptr;
+    if (auto entry = chunksMap.find(x, z)) {
+        return entry->chunk;
     }
-    return found->second;
+    return nullptr;
 }
 
-static void check_voxels(const ContentIndices& indices, Chunk& chunk) {
+/// @brief Replace unknown blocks with air
+/// @return true if chunk voxels were modified
+static bool check_voxels(const ContentIndices& indices, Chunk& chunk) {
     bool corrupted = false;
     blockid_t defsCount = indices.blocks.count();
     for (size_t i = 0; i < CHUNK_VOL; i++) {
-        blockid_t id = chunk.voxels[i].id;
+        blockid_t id = chunk.voxels.get(i).id;
         if (id >= defsCount) {
             if (!corrupted) {
 #ifdef NDEBUG
@@ -56,13 +60,23 @@ static void check_voxels(const ContentIndices& indices, Chunk& chunk) {
                 abort();
 #endif
             }
-            chunk.voxels[i].id = BLOCK_AIR;
+            chunk.voxels.getWriteable(i)->id = BLOCK_AIR;
         }
     }
+    return corrupted;
 }
 
 void GlobalChunks::erase(int x, int z) {
-    chunksMap.erase(keyfrom(x, z));
+    auto entry = chunksMap.find(x, z);
+    if (entry == nullptr || entry->chunk == nullptr) {
+        return;
+    }
+    chunksCount--;
+    if (entry->tickets > 0) {
+        entry->chunk = nullptr;
+    } else {
+        chunksMap.erase(x, z);
+    }
 }
 
 static inline auto load_inventories(
@@ -74,7 +88,7 @@ static inline auto load_inventories(
     auto iterator = invs.begin();
     while (iterator != invs.end()) {
         uint index = iterator->first;
-        const auto& def = defs.require(chunk.voxels[index].id);
+        const auto& def = defs.require(chunk.voxels.get(index).id);
         if (def.inventorySize == 0) {
             iterator = invs.erase(iterator);
             continue;
@@ -89,13 +103,12 @@ static inline auto load_inventories(
 }
 
 std::shared_ptr<Chunk> GlobalChunks::create(int x, int z) {
-    const auto& found = chunksMap.find(keyfrom(x, z));
-    if (found != chunksMap.end()) {
-        return found->second;
+    if (auto entry = chunksMap.find(x, z); entry && entry->chunk) {
+        return entry->chunk;
     }
 
     auto chunk = std::make_shared<Chunk>(x, z);
-    chunksMap[keyfrom(x, z)] = chunk;
+    putChunk(chunk);
 
     World& world = *level.getWorld();
     auto& regions = world.wfile.get()->getRegions();
@@ -103,8 +116,13 @@ std::shared_ptr<Chunk> GlobalChunks::create(int x, int z) {
     if (auto data = regions.getVoxels(chunk->x, chunk->z)) {
         const auto& indices = *level.content.getIndices();
 
-        chunk->decode(data.get());
-        check_voxels(indices, *chunk);
+        chunk->decode(data.get(), packVoxels);
+        if (check_voxels(indices, *chunk)) {
+            // repaired voxels are saved and lighted again
+            chunk->flags.unsaved = true;
+            data = chunk->encode();
+        }
+        chunk->voxelsHash = WorldRegions::hashVoxels(data.get());
 
         chunk->setBlockInventories(
             load_inventories(regions, *chunk, indices.blocks)
@@ -121,8 +139,11 @@ std::shared_ptr<Chunk> GlobalChunks::create(int x, int z) {
             level.inventories->store(entry.second);
         }
     }
-    if (auto lights = regions.getLights(chunk->x, chunk->z)) {
-        chunk->lightmap.set(lights.get());
+    // stale lights are not loaded, so the chunk is lighted again
+    // by lighting workers when it becomes visible
+    if (regions.getLights(
+            chunk->x, chunk->z, chunk->lightmap, chunk->voxelsHash
+        )) {
         chunk->flags.loadedLights = true;
     }
     chunk->blocksMetadata = regions.getBlocksData(chunk->x, chunk->z);
@@ -132,48 +153,60 @@ std::shared_ptr<Chunk> GlobalChunks::create(int x, int z) {
 }
 
 void GlobalChunks::pinChunk(std::shared_ptr<Chunk> chunk) {
-    pinnedChunks[{chunk->x, chunk->z}] = std::move(chunk);
+    int x = chunk->x;
+    int z = chunk->z;
+    if (fetch(x, z) == nullptr) {
+        putChunk(chunk);
+    }
+    if (pinnedChunks.insert({{x, z}, std::move(chunk)}).second) {
+        addTicket(x, z);
+    }
 }
 
 void GlobalChunks::unpinChunk(int x, int z) {
-    pinnedChunks.erase({x, z});
+    if (pinnedChunks.erase({x, z})) {
+        removeTicket(x, z);
+    }
 }
 
 size_t GlobalChunks::size() const {
-    return chunksMap.size();
+    return chunksCount;
 }
 
-void GlobalChunks::incref(Chunk* chunk) {
-    auto key = reinterpret_cast<ptrdiff_t>(chunk);
-    const auto& found = refCounters.find(key);
-    if (found == refCounters.end()) {
-        refCounters[key] = 1;
-        return;
-    }
-    found->second++;
+void GlobalChunks::addTicket(int x, int z) {
+    chunksMap(x, z).tickets++;
 }
 
-void GlobalChunks::decref(Chunk* chunk) {
-    auto key = reinterpret_cast<ptrdiff_t>(chunk);
-    const auto& found = refCounters.find(key);
-    if (found == refCounters.end()) {
-        abort();
+void GlobalChunks::removeTicket(int x, int z) {
+    auto entry = chunksMap.find(x, z);
+    assert(entry != nullptr && entry->tickets > 0);
+    if (entry == nullptr || entry->tickets == 0) {
+        logger.error() << "chunk " << x << "," << z
+                       << " ticket removed but not added";
+        return;
     }
-    if (--found->second == 0) {
-        union {
-            int pos[2];
-            long long key;
-        } ekey;
-        ekey.pos[0] = chunk->x;
-        ekey.pos[1] = chunk->z;
+    if (--entry->tickets > 0) {
+        return;
+    }
+    // keep the chunk alive while unloading
+    auto chunk = std::move(entry->chunk);
+    chunksMap.erase(x, z);
+    if (chunk == nullptr) {
+        return;
+    }
+    chunksCount--;
+    if (onUnload) {
+        onUnload(*chunk);
+    }
+    save(chunk.get());
+}
 
-        if (onUnload) {
-            onUnload(*chunk);
+void GlobalChunks::forEachTicketed(const consumer<Chunk&>& func) const {
+    chunksMap.forEach([&func](int, int, const Entry& entry) {
+        if (entry.tickets > 0 && entry.chunk && entry.chunk->flags.loaded) {
+            func(*entry.chunk);
         }
-        save(chunk);
-        chunksMap.erase(ekey.key);
-        refCounters.erase(found);
-    }
+    });
 }
 
 void GlobalChunks::save(Chunk* chunk) {
@@ -189,19 +222,23 @@ void GlobalChunks::save(Chunk* chunk) {
     }
     level.getWorld()->wfile->getRegions().put(
         chunk,
-        chunk->flags.entities ? json::to_binary(root, true)
+        chunk->flags.entities ? json::to_binary(root)
                                 : std::vector<ubyte>()
     );
 }
 
 void GlobalChunks::saveAll() {
-    for (const auto& [_, chunk] : chunksMap) {
-        save(chunk.get());
-    }
+    chunksMap.forEach([this](int, int, const Entry& entry) {
+        save(entry.chunk.get());
+    });
 }
 
 void GlobalChunks::putChunk(std::shared_ptr<Chunk> chunk) {
-    chunksMap[keyfrom(chunk->x, chunk->z)] = std::move(chunk);
+    auto& entry = chunksMap(chunk->x, chunk->z);
+    if (entry.chunk == nullptr) {
+        chunksCount++;
+    }
+    entry.chunk = std::move(chunk);
 }
 
 const AABB* GlobalChunks::isObstacleAt(float x, float y, float z) const {
@@ -7,33 +7,35 @@
 #include <glm/glm.hpp>
 #include <glm/gtx/hash.hpp>
 
+#include "Chunk.hpp"
 #include "voxel.hpp"
 #include "delegates.hpp"
+#include "util/FlatMap2D.hpp"
 
-class Chunk;
 class Level;
 struct AABB;
 class ContentIndices;
 
 class GlobalChunks {
-    static inline uint64_t keyfrom(int32_t x, int32_t z) {
-        union {
-            int32_t pos[2];
-            uint64_t key;
-        } ekey;
-        ekey.pos[0] = x;
-        ekey.pos[1] = z;
-        return ekey.key;
-    }
+    struct Entry {
+        /// @brief Loaded chunk (nullptr if there are tickets only)
+        std::shared_ptr<Chunk> chunk;
+        /// @brief Number of players areas and pins keeping the chunk
+        /// loaded. Chunk is unloaded when its last ticket is removed
+        int tickets = 0;
+    };
 
     Level& level;
     const ContentIndices& indices;
-    std::unordered_map<uint64_t, std::shared_ptr<Chunk>> chunksMap;
+    util::FlatMap2D<Entry> chunksMap;
+    size_t chunksCount = 0;
     std::unordered_map<glm::ivec2, std::shared_ptr<Chunk>> pinnedChunks;
-    std::unordered_map<ptrdiff_t, int> refCounters;
 
     consumer<Chunk&> onUnload;
 public:
+    /// @brief Store loaded and generated chunks voxels palette-compressed
+    bool packVoxels = false;
+
     GlobalChunks(Level& level);
     ~GlobalChunks() = default;
 
@@ -42,13 +44,21 @@ public:
     std::shared_ptr<Chunk> fetch(int x, int z);
     std::shared_ptr<Chunk> create(int x, int z);
 
+    /// @brief Keep the chunk loaded until unpinned
     void pinChunk(std::shared_ptr<Chunk> chunk);
     void unpinChunk(int x, int z);
 
     size_t size() const;
 
-    void incref(Chunk* chunk);
-    void decref(Chunk* chunk);
+    /// @brief Add a ticket keeping the chunk loaded
+    void addTicket(int x, int z);
+    /// @brief Remove a ticket, unloading the chunk if it was the last one
+    void removeTicket(int x, int z);
+
+    /// @brief Call the function once for each loaded chunk having tickets,
+    /// no matter how many players areas include it.
+    /// Chunks must not be loaded or unloaded by the function
+    void forEachTicketed(const consumer<Chunk&>& func) const;
 
     void erase(int x, int z);
 
@@ -59,12 +69,15 @@ public:
 
     const AABB* isObstacleAt(float x, float y, float z) const;
 
+    /// @return loaded chunk or nullptr. Chunks waiting for the generator
+    /// are not returned, so they are not modified and missing chunks
+    /// are still obstacles
     inline Chunk* getChunk(int cx, int cz) const {
-        const auto& found = chunksMap.find(keyfrom(cx, cz));
-        if (found == chunksMap.end()) {
-            return nullptr;
+        if (auto entry = chunksMap.find(cx, cz);
+            entry && entry->chunk && entry->chunk->flags.loaded) {
+            return entry->chunk.get();
         }
-        return found->second.get();
+        return nullptr;
     }
 
     const ContentIndices& getContentIndices() const {
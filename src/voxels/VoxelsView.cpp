@@ -0,0 +1,35 @@
+#include "VoxelsView.hpp"
+
+#include "Chunks.hpp"
+
+ChunksArea VoxelsView::pin(const Chunks& chunks, int cx, int cz) {
+    ChunksArea area;
+    for (int i = 0; i < 9; i++) {
+        area[i] = chunks.fetch(cx + i % 3 - 1, cz + i / 3 - 1);
+    }
+    return area;
+}
+
+void VoxelsView::set(
+    const ChunksArea& area, const Block* const* blockDefs, bool backlight
+) {
+    release();
+    this->backlight = backlight;
+    this->blockDefs = blockDefs;
+    x = (area[4]->x - 1) * CHUNK_W;
+    z = (area[4]->z - 1) * CHUNK_D;
+    for (int i = 0; i < 9; i++) {
+        if ((chunks[i] = area[i].get())) {
+            chunks[i]->voxels.beginRead();
+        }
+    }
+}
+
+void VoxelsView::release() {
+    for (int i = 0; i < 9; i++) {
+        if (chunks[i]) {
+            chunks[i]->voxels.endRead();
+            chunks[i] = nullptr;
+        }
+    }
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <memory>
+
+#include "constants.hpp"
+#include "typedefs.hpp"
+#include "Block.hpp"
+#include "Chunk.hpp"
+
+class Chunks;
+
+/// @brief Chunk and its eight neighbours by rows from (cx - 1, cz - 1).
+/// Not loaded chunks are nullptr
+using ChunksArea = std::array<std::shared_ptr<const Chunk>, 9>;
+
+/// @brief Read-only view of voxels and lights of a chunk and its eight
+/// neighbours. Unlike VoxelsVolume, chunks data is read in place instead of
+/// being copied. Chunks are pinned by the view user, so they may be
+/// unloaded by the main thread while the view is used by other threads
+class VoxelsView {
+    const Chunk* chunks[9] {};
+    /// @brief Position of the first voxel of the 3x3 chunks area
+    int x = 0, z = 0;
+    const Block* const* blockDefs = nullptr;
+    bool backlight = false;
+
+    /// @brief Get view chunk containing the voxel
+    /// @param index [out] voxel index in the chunk (see vox_index)
+    inline const Chunk* find(int bx, int by, int bz, uint& index) const {
+        uint lx = bx - x;
+        uint lz = bz - z;
+        if (by < 0 || by >= CHUNK_H || lx >= CHUNK_W * 3 ||
+            lz >= CHUNK_D * 3) {
+            return nullptr;
+        }
+        index = vox_index(lx % CHUNK_W, by, lz % CHUNK_D);
+        return chunks[(lz / CHUNK_D) * 3 + lx / CHUNK_W];
+    }
+public:
+    VoxelsView() = default;
+    VoxelsView(const VoxelsView&) = delete;
+
+    /// @brief Pin the chunk and its loaded neighbours. Main thread only
+    static ChunksArea pin(const Chunks& chunks, int cx, int cz);
+
+    /// @brief Set the view chunks. They must stay pinned until release.
+    /// Voxels data replaced meanwhile is kept until release too
+    /// @param area pinned chunks area (central chunk must be loaded)
+    /// @param blockDefs block definitions by ids
+    /// @param backlight apply backlight to lights of light passing blocks
+    void set(
+        const ChunksArea& area, const Block* const* blockDefs, bool backlight
+    );
+
+    /// @brief Clear the view chunks
+    void release();
+
+    /// @return block id or BLOCK_VOID if the chunk is not loaded
+    inline blockid_t pickBlockId(int bx, int by, int bz) const {
+        uint index;
+        if (auto chunk = find(bx, by, bz, index)) {
+            return chunk->voxels.get(index).id;
+        }
+        return BLOCK_VOID;
+    }
+
+    /// @return voxel light or 0 if the chunk is not loaded
+    inline light_t pickLight(int bx, int by, int bz) const {
+        uint index;
+        auto chunk = find(bx, by, bz, index);
+        if (chunk == nullptr) {
+            return 0;
+        }
+        light_t light = chunk->lightmap.get(index);
+        if (backlight &&
+            blockDefs[chunk->voxels.get(index).id]->lightPassing) {
+            light = Lightmap::combine(
+                std::min(15, Lightmap::extract(light, 0) + 1),
+                std::min(15, Lightmap::extract(light, 1) + 1),
+                std::min(15, Lightmap::extract(light, 2) + 1),
+                Lightmap::extract(light, 3)
+            );
+        }
+        return light;
+    }
+};
@@ -6,6 +6,35 @@
 
 using namespace blocks_agent;
 
+/// @brief Update sky lighted part height of the column after block is set
+static inline void update_sky_height(
+    const ContentIndices& indices,
+    Chunk& chunk,
+    int lx,
+    int y,
+    int lz,
+    const Block& def
+) {
+    auto& lightmap = chunk.lightmap;
+    int height = lightmap.getHeight(lx, lz);
+    if (!def.skyLightPassing) {
+        if (y >= height) {
+            lightmap.setHeight(lx, lz, y + 1);
+        }
+        return;
+    }
+    if (y + 1 != height) {
+        return;
+    }
+    const auto* blockDefs = indices.blocks.getDefs();
+    while (y > 0 &&
+           blockDefs[chunk.voxels.get(vox_index(lx, y - 1, lz)).id]
+               ->skyLightPassing) {
+        y--;
+    }
+    lightmap.setHeight(lx, lz, y);
+}
+
 template <class Storage>
 static inline void set_block(
     Storage& chunks,
@@ -30,7 +59,7 @@ static inline void set_block(
     size_t index = vox_index(lx, y, lz);
 
     // block finalization
-    voxel& vox = chunk->voxels[(y * CHUNK_D + lz) * CHUNK_W + lx];
+    voxel& vox = *chunk->voxels.getWriteable(index);
     const auto& prevdef = indices.blocks.require(vox.id);
     if (prevdef.inventorySize != 0) {
         chunk->removeBlockInventory(lx, y, lz);
@@ -50,7 +79,8 @@ static inline void set_block(
     const auto& newdef = indices.blocks.require(id);
     vox.id = id;
     vox.state = state;
-    chunk->setModifiedAndUnsaved();
+    chunk->setModifiedAndUnsaved(y);
+    update_sky_height(indices, *chunk, lx, y, lz, newdef);
     if (!state.segment && newdef.rt.extended) {
         repair_segments(chunks, newdef, state, x, y, z);
     }
@@ -63,16 +93,16 @@ static inline void set_block(
         chunk->updateHeights();
 
     if (lx == 0 && (chunk = get_chunk(chunks, cx - 1, cz))) {
-        chunk->flags.modified = true;
+        chunk->setModified(y);
     }
     if (lz == 0 && (chunk = get_chunk(chunks, cx, cz - 1))) {
-        chunk->flags.modified = true;
+        chunk->setModified(y);
     }
     if (lx == CHUNK_W - 1 && (chunk = get_chunk(chunks, cx + 1, cz))) {
-        chunk->flags.modified = true;
+        chunk->setModified(y);
     }
     if (lz == CHUNK_D - 1 && (chunk = get_chunk(chunks, cx, cz + 1))) {
-        chunk->flags.modified = true;
+        chunk->setModified(y);
     }
 }
 
@@ -99,7 +129,7 @@ void blocks_agent::set(
 }
 
 template <class Storage>
-static inline voxel* raycast_blocks(
+static inline const voxel* raycast_blocks(
     const Storage& chunks,
     const glm::vec3& start,
     const glm::vec3& dir,
@@ -110,6 +140,7 @@ static inline voxel* raycast_blocks(
     std::set<blockid_t> filter
 ) {
     const auto& blocks = chunks.getContentIndices().blocks;
+    VoxelCursor<Storage> cursor(chunks);
     float px = start.x;
     float py = start.y;
     float pz = start.z;
@@ -144,7 +175,7 @@ static inline voxel* raycast_blocks(
     int steppedIndex = -1;
 
     while (t <= maxDist) {
-        voxel* voxel = get(chunks, ix, iy, iz);
+        const voxel* voxel = get(cursor, ix, iy, iz);
         if (voxel == nullptr) {
             return nullptr;
         }
@@ -171,7 +202,7 @@ static inline voxel* raycast_blocks(
 
                 glm::vec3 offset {};
                 if (voxel->state.segment) {
-                    offset = seek_origin(chunks, iend, def, voxel->state) - iend;
+                    offset = seek_origin(cursor, iend, def, voxel->state) - iend;
                 }
 
                 for (auto box : hitboxes) {
@@ -240,7 +271,7 @@ static inline voxel* raycast_blocks(
     return nullptr;
 }
 
-voxel* blocks_agent::raycast(
+const voxel* blocks_agent::raycast(
     const Chunks& chunks,
     const glm::vec3& start,
     const glm::vec3& dir,
@@ -253,7 +284,7 @@ voxel* blocks_agent::raycast(
     return raycast_blocks(chunks, start, dir, maxDist, end, norm, iend, filter);
 }
 
-voxel* blocks_agent::raycast(
+const voxel* blocks_agent::raycast(
     const GlobalChunks& chunks,
     const glm::vec3& start,
     const glm::vec3& dir,
@@ -313,8 +344,8 @@ inline void get_voxels_impl(
                     }
                 }
             } else {
-                const voxel* cvoxels = chunk->voxels;
-                const light_t* clights = chunk->lightmap.getLights();
+                const auto& cvoxels = chunk->voxels;
+                const auto& clights = chunk->lightmap;
                 for (int ly = y; ly < y + h; ly++) {
                     for (int lz = std::max(z, cz * CHUNK_D);
                              lz < std::min(z + d, (cz + 1) * CHUNK_D);
@@ -330,8 +361,8 @@ inline void get_voxels_impl(
                                 CHUNK_W,
                                 CHUNK_D
                             );
-                            voxels[vidx] = cvoxels[cidx];
-                            light_t light = clights[cidx];
+                            voxels[vidx] = cvoxels.get(cidx);
+                            light_t light = clights.get(cidx);
                             if (backlight) {
                                 const auto block = blocks.get(voxels[vidx].id);
                                 if (block && block->lightPassing) {
@@ -14,6 +14,7 @@
 #include "maths/voxmaths.hpp"
 
 #include <set>
+#include <limits>
 #include <stdint.h>
 #include <stdexcept>
 #include <glm/glm.hpp>
@@ -33,8 +34,68 @@ inline Chunk* get_chunk(const Storage& chunks, int cx, int cz) {
     return chunks.getChunk(cx, cz);
 }
 
+/// @brief Chunks storage wrapper remembering the last resolved chunk.
+/// Neighbouring voxel accesses almost always hit the same chunk, so the
+/// storage is looked up only when crossing chunk borders.
+/// Cursor may be passed as Storage to the read-only templates
+/// (get, is_obstacle_at, seek_origin...).
+/// Cursor is not thread-safe and must not be kept while chunks may be
+/// unloaded, so it's created on stack for a single operation.
+/// @tparam Storage chunks storage class
+template<class Storage>
+class VoxelCursor {
+    const Storage& chunks;
+    mutable Chunk* chunk = nullptr;
+    mutable int cx = std::numeric_limits<int>::min();
+    mutable int cz = std::numeric_limits<int>::min();
+public:
+    explicit VoxelCursor(const Storage& chunks) : chunks(chunks) {
+    }
+
+    /// @return chunk or nullptr if does not exists
+    inline Chunk* getChunk(int cx, int cz) const {
+        if (cx != this->cx || cz != this->cz) {
+            chunk = get_chunk(chunks, cx, cz);
+            this->cx = cx;
+            this->cz = cz;
+        }
+        return chunk;
+    }
+
+    const ContentIndices& getContentIndices() const {
+        return chunks.getContentIndices();
+    }
+};
+
 /// @brief Get voxel at specified position.
 /// Returns nullptr if voxel does not exists. 
+/// Packed chunk sections are not unpacked, the pointer is valid until
+/// the voxel is modified (see get_writeable)
+/// @tparam Storage chunks storage class
+/// @param chunks chunks storage
+/// @param x position X
+/// @param y position Y
+/// @param z position Z
+/// @return voxel pointer or nullptr
+template<class Storage>
+inline const voxel* get(const Storage& chunks, int32_t x, int32_t y, int32_t z) {
+    if (y < 0 || y >= CHUNK_H) {
+        return nullptr;
+    }
+    int cx = floordiv<CHUNK_W>(x);
+    int cz = floordiv<CHUNK_D>(z);
+    Chunk* chunk = get_chunk(chunks, cx, cz);
+    if (chunk == nullptr) {
+        return nullptr;
+    }
+    int lx = x - cx * CHUNK_W;
+    int lz = z - cz * CHUNK_D;
+    return &chunk->voxels.get((y * CHUNK_D + lz) * CHUNK_W + lx);
+}
+
+/// @brief Get writeable voxel at specified position.
+/// Returns nullptr if voxel does not exists. 
+/// Packed chunk section is unpacked, so it must not be used for reading
 /// @tparam Storage chunks storage class
 /// @param chunks chunks storage
 /// @param x position X
@@ -42,7 +103,9 @@ inline Chunk* get_chunk(const Storage& chunks, int cx, int cz) {
 /// @param z position Z
 /// @return voxel pointer or nullptr
 template<class Storage>
-inline voxel* get(const Storage& chunks, int32_t x, int32_t y, int32_t z) {
+inline voxel* get_writeable(
+    const Storage& chunks, int32_t x, int32_t y, int32_t z
+) {
     if (y < 0 || y >= CHUNK_H) {
         return nullptr;
     }
@@ -54,7 +117,7 @@ inline voxel* get(const Storage& chunks, int32_t x, int32_t y, int32_t z) {
     }
     int lx = x - cx * CHUNK_W;
     int lz = z - cz * CHUNK_D;
-    return &chunk->voxels[(y * CHUNK_D + lz) * CHUNK_W + lx];
+    return chunk->voxels.getWriteable((y * CHUNK_D + lz) * CHUNK_W + lx);
 }
 
 /// @brief Get voxel at specified position.
@@ -66,7 +129,9 @@ inline voxel* get(const Storage& chunks, int32_t x, int32_t y, int32_t z) {
 /// @param z position Z
 /// @return voxel reference
 template<class Storage>
-inline voxel& require(const Storage& chunks, int32_t x, int32_t y, int32_t z) {
+inline const voxel& require(
+    const Storage& chunks, int32_t x, int32_t y, int32_t z
+) {
     auto vox = get(chunks, x, y, z);
     if (vox == nullptr) {
         throw std::runtime_error("voxel does not exist");
@@ -328,12 +393,13 @@ inline void set_rotation_extended(
                 if (vox->id != def.rt.id) {
                     set(chunks, pos.x, pos.y, pos.z, def.rt.id, segState);
                 } else {
-                    vox->state = segState;
+                    get_writeable(chunks, pos.x, pos.y, pos.z)->state =
+                        segState;
                     int cx = floordiv<CHUNK_W>(pos.x);
                     int cz = floordiv<CHUNK_D>(pos.z);
                     auto chunk = get_chunk(chunks, cx, cz);
                     assert(chunk != nullptr);
-                    chunk->setModifiedAndUnsaved();
+                    chunk->setModifiedAndUnsaved(pos.y);
                     segmentBlocks.emplace_back(pos);
                 }
             }
@@ -384,12 +450,12 @@ inline void set_rotation(
         vox = get(chunks, origin.x, origin.y, origin.z);
         set_rotation_extended(chunks, def, vox->state, origin, index);
     } else {
-        vox->state.rotation = index;
+        get_writeable(chunks, x, y, z)->state.rotation = index;
         int cx = floordiv<CHUNK_W>(x);
         int cz = floordiv<CHUNK_D>(z);
         auto chunk = get_chunk(chunks, cx, cz);
         assert(chunk != nullptr);
-        chunk->setModifiedAndUnsaved();
+        chunk->setModifiedAndUnsaved(y);
     }
 }
 
@@ -403,7 +469,7 @@ inline void set_rotation(
 /// @param iend [out] ray end integer position (voxel position + normal)
 /// @param filter filtered ids
 /// @return voxel pointer or nullptr
-voxel* raycast(
+const voxel* raycast(
     const Chunks& chunks,
     const glm::vec3& start,
     const glm::vec3& dir,
@@ -424,7 +490,7 @@ voxel* raycast(
 /// @param iend [out] ray end integer position (voxel position + normal)
 /// @param filter filtered ids
 /// @return voxel pointer or nullptr
-voxel* raycast(
+const voxel* raycast(
     const GlobalChunks& chunks,
     const glm::vec3& start,
     const glm::vec3& dir,
@@ -444,7 +510,7 @@ inline const AABB* is_obstacle_at(const Storage& chunks, float x, float y, float
     int ix = std::floor(x);
     int iy = std::floor(y);
     int iz = std::floor(z);
-    voxel* v = get(chunks, ix, iy, iz);
+    const voxel* v = get(chunks, ix, iy, iz);
     if (v == nullptr) {
         if (iy >= CHUNK_H) {
             return nullptr;
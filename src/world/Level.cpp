@@ -52,11 +52,12 @@ Level::Level(
         entities->setNextID(worldInfo.nextEntityId);
     }
 
+    // players areas hold tickets of the chunks they include
     events->listen(LevelEventType::CHUNK_SHOWN, [this](LevelEventType, Chunk* chunk) {
-        chunks->incref(chunk);
+        chunks->addTicket(chunk->x, chunk->z);
     });
     events->listen(LevelEventType::CHUNK_HIDDEN, [this](LevelEventType, Chunk* chunk) {
-        chunks->decref(chunk);
+        chunks->removeTicket(chunk->x, chunk->z);
     });
     chunks->setOnUnload([this](Chunk& chunk) {
         events->trigger(LevelEventType::CHUNK_UNLOAD, &chunk);
@@ -46,7 +46,7 @@ void World::updateTimers(float delta) {
     info.totalTime += delta;
 }
 
-void World::writeResources(const Content& content) {
+dv::value World::serializeResources() const {
     auto root = dv::object();
     for (size_t typeIndex = 0; typeIndex < RESOURCE_TYPES_COUNT; typeIndex++) {
         auto typeName = to_string(static_cast<ResourceType>(typeIndex));
@@ -61,18 +61,17 @@ void World::writeResources(const Content& content) {
             }
         }
     }
-    files::write_json(wfile->getResourcesFile(), root);
+    return root;
 }
 
 void World::write(Level* level) {
     level->chunks->saveAll();
     info.nextEntityId = level->entities->peekNextID();
-    wfile->write(this, &content);
-
-    auto playerFile = level->players->serialize();
-    files::write_json(wfile->getPlayerFile(), playerFile);
 
-    writeResources(content);
+    std::vector<std::pair<fs::path, dv::value>> files;
+    files.emplace_back(wfile->getPlayerFile(), level->players->serialize());
+    files.emplace_back(wfile->getResourcesFile(), serializeResources());
+    wfile->write(this, &content, std::move(files));
 }
 
 std::unique_ptr<Level> World::create(
@@ -59,7 +59,7 @@ class World {
     const Content& content;
     std::vector<ContentPack> packs;
 
-    void writeResources(const Content& content);
+    dv::value serializeResources() const;
 public:
     std::shared_ptr<WorldFiles> wfile;
 
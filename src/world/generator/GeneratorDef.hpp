@@ -128,6 +128,10 @@ public:
 
     virtual void initialize(uint64_t seed) = 0;
 
+    /// @brief Create an independent script instance with its own state.
+    /// Created instance must be initialized before use
+    virtual std::unique_ptr<GeneratorScript> clone() const = 0;
+
     /// @brief Generate a heightmap with values in range 0..1
     /// @param offset position of the heightmap in the world
     /// @param size size of the heightmap
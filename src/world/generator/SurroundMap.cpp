@@ -14,6 +14,16 @@ SurroundMap::SurroundMap(int maxLevelRadius, int8_t maxLevel)
 void SurroundMap::setLevelCallback(int8_t level, LevelCallback callback) {
     auto& wrapper = levelCallbacks.at(level - 1);
     wrapper.callback = callback;
+    wrapper.batchCallback = nullptr;
+    wrapper.active = callback != nullptr;
+}
+
+void SurroundMap::setLevelBatchCallback(
+    int8_t level, LevelBatchCallback callback
+) {
+    auto& wrapper = levelCallbacks.at(level - 1);
+    wrapper.callback = nullptr;
+    wrapper.batchCallback = callback;
     wrapper.active = callback != nullptr;
 }
 
@@ -23,6 +33,7 @@ void SurroundMap::setOutCallback(util::AreaMap2D<int8_t>::OutCallback callback)
 
 void SurroundMap::upgrade(int x, int y, int8_t level) {
     auto& callback = levelCallbacks[level - 1];
+    std::vector<glm::ivec2> points;
     int size = maxLevel - level + 1;
     for (int ly = -size+1; ly < size; ly++) {
         for (int lx = -size+1; lx < size; lx++) {
@@ -36,11 +47,19 @@ void SurroundMap::upgrade(int x, int y, int8_t level) {
                 continue;
             }
             areaMap.set(posX, posY, level);
-            if (callback.active) {
+            if (!callback.active) {
+                continue;
+            }
+            if (callback.batchCallback) {
+                points.emplace_back(posX, posY);
+            } else {
                 callback.callback(posX, posY);
             }
         }
     }
+    if (!points.empty()) {
+        callback.batchCallback(points);
+    }
 }
 
 void SurroundMap::resize(int maxLevelRadius) {
@@ -12,8 +12,11 @@
 class SurroundMap {
 public:
     using LevelCallback = std::function<void(int, int)>;
+    using LevelBatchCallback =
+        std::function<void(const std::vector<glm::ivec2>&)>;
     struct LevelCallbackWrapper {
         LevelCallback callback;
+        LevelBatchCallback batchCallback;
         bool active = false;
     };
 private:
@@ -28,6 +31,10 @@ public:
     /// @brief Callback called on point level increments
     void setLevelCallback(int8_t level, LevelCallback callback);
 
+    /// @brief Callback called once per upgrade with all points reached
+    /// the level (replaces per-point callback)
+    void setLevelBatchCallback(int8_t level, LevelBatchCallback callback);
+
     /// @brief Callback called when non-zero value moves out of area
     void setOutCallback(util::AreaMap2D<int8_t>::OutCallback callback);   
     
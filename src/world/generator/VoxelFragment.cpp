@@ -6,6 +6,8 @@
 
 #include "data/dv_util.hpp"
 #include "content/Content.hpp"
+#include "lighting/Lighting.hpp"
+#include "maths/voxmaths.hpp"
 #include "voxels/Chunks.hpp"
 #include "voxels/Block.hpp"
 #include "voxels/GlobalChunks.hpp"
@@ -171,9 +173,13 @@ void VoxelFragment::prepare(const Content& content) {
 }
 
 void VoxelFragment::place(
-    GlobalChunks& chunks, const glm::ivec3& offset, ubyte rotation
+    GlobalChunks& chunks,
+    const glm::ivec3& offset,
+    ubyte rotation,
+    Lighting* lighting
 ) {
     auto& structVoxels = getRuntimeVoxels();
+    LightingBatch lightingBatch(lighting);
     for (int y = 0; y < size.y; y++) {
         int sy = y + offset.y;
         if (sy < 0 || sy >= CHUNK_H) {
@@ -185,10 +191,17 @@ void VoxelFragment::place(
                 int sx = x + offset.x;
                 const auto& structVoxel = 
                     structVoxels[vox_index(x, y, z, size.x, size.z)];
-                if (structVoxel.id) {
-                    blocks_agent::set(
-                        chunks, sx, sy, sz, structVoxel.id, structVoxel.state
-                    );
+                if (structVoxel.id == 0) {
+                    continue;
+                }
+                blocks_agent::set(
+                    chunks, sx, sy, sz, structVoxel.id, structVoxel.state
+                );
+                if (lighting && chunks.getChunk(
+                                    floordiv<CHUNK_W>(sx),
+                                    floordiv<CHUNK_D>(sz)
+                                )) {
+                    lighting->onBlockSet(sx, sy, sz, structVoxel.id);
                 }
             }
         }
@@ -11,6 +11,7 @@ inline constexpr int STRUCTURE_FORMAT_VERSION = 1;
 class Level;
 class Content;
 class GlobalChunks;
+class Lighting;
 
 class VoxelFragment : public Serializable {
     glm::ivec3 size;
@@ -45,7 +46,14 @@ public:
     /// @brief Place fragment to the world
     /// @param offset target location
     /// @param rotation rotation index
-    void place(GlobalChunks& chunks, const glm::ivec3& offset, ubyte rotation);
+    /// @param lighting lighting to update (nullable). Lights of all placed
+    /// blocks are solved in a single batch
+    void place(
+        GlobalChunks& chunks,
+        const glm::ivec3& offset,
+        ubyte rotation,
+        Lighting* lighting = nullptr
+    );
 
     /// @brief Create structure copy rotated 90 deg. clockwise
     std::unique_ptr<VoxelFragment> rotated(const Content& content) const;
@@ -11,6 +11,7 @@
 #include "VoxelFragment.hpp"
 #include "util/timeutil.hpp"
 #include "util/listutil.hpp"
+#include "util/WorkerGroup.hpp"
 #include "maths/voxmaths.hpp"
 #include "maths/util.hpp"
 #include "debug/Logger.hpp"
@@ -24,7 +25,10 @@ static inline constexpr uint MAX_PARAMETERS = 4;
 static inline constexpr uint BASIC_PROTOTYPE_LAYERS = 5;
 
 WorldGenerator::WorldGenerator(
-    const GeneratorDef& def, const Content& content, uint64_t seed
+    const GeneratorDef& def,
+    const Content& content,
+    uint64_t seed,
+    uint workers
 )
     : def(def), 
       content(content), 
@@ -32,6 +36,15 @@ WorldGenerator::WorldGenerator(
       surroundMap(0, BASIC_PROTOTYPE_LAYERS + def.wideStructsChunksRadius * 2)
 {
     def.script->initialize(seed);
+    for (uint i = 0; i < workers; i++) {
+        auto script = def.script->clone();
+        script->initialize(seed);
+        workerScripts.push_back(std::move(script));
+    }
+    if (workers) {
+        this->workers = std::make_unique<util::WorkerGroup>(workers);
+        logger.info() << "prototypes generation workers: " << workers + 1;
+    }
 
     uint levels = BASIC_PROTOTYPE_LAYERS + def.wideStructsChunksRadius * 2;
 
@@ -55,12 +68,21 @@ WorldGenerator::WorldGenerator(
     [this](int const x, int const z) {
         generateStructuresWide(requirePrototype(x, z), x, z);
     });
-    surroundMap.setLevelCallback(levels-3, [this](int const x, int const z) {
-        generateBiomes(requirePrototype(x, z), x, z);
-    });
-    surroundMap.setLevelCallback(levels-2, [this](int const x, int const z) {
-        generateHeightmap(requirePrototype(x, z), x, z);
-    });
+    if (this->workers) {
+        surroundMap.setLevelBatchCallback(levels-3, [this](const auto& points) {
+            generateParallel(points, &WorldGenerator::generateBiomes);
+        });
+        surroundMap.setLevelBatchCallback(levels-2, [this](const auto& points) {
+            generateParallel(points, &WorldGenerator::generateHeightmap);
+        });
+    } else {
+        surroundMap.setLevelCallback(levels-3, [this](int const x, int const z) {
+            generateBiomes(*this->def.script, requirePrototype(x, z), x, z);
+        });
+        surroundMap.setLevelCallback(levels-2, [this](int const x, int const z) {
+            generateHeightmap(*this->def.script, requirePrototype(x, z), x, z);
+        });
+    }
     surroundMap.setLevelCallback(levels-1, [this](int const x, int const z) {
         generateStructures(requirePrototype(x, z), x, z);
     });
@@ -84,6 +106,28 @@ ChunkPrototype& WorldGenerator::requirePrototype(int x, int z) {
     return *found->second;
 }
 
+GeneratorScript& WorldGenerator::getScript(uint worker) {
+    if (worker == 0) {
+        return *def.script;
+    }
+    return *workerScripts.at(worker - 1);
+}
+
+void WorldGenerator::generateParallel(
+    const std::vector<glm::ivec2>& points,
+    void (WorldGenerator::*stage)(GeneratorScript&, ChunkPrototype&, int, int)
+) {
+    // prototypes map must not be accessed from workers
+    std::vector<ChunkPrototype*> targets(points.size());
+    for (size_t i = 0; i < points.size(); i++) {
+        targets[i] = &requirePrototype(points[i].x, points[i].y);
+    }
+    workers->run(points.size(), [&](size_t index, uint worker) {
+        const auto& point = points[index];
+        (this->*stage)(getScript(worker), *targets[index], point.x, point.y);
+    });
+}
+
 static inline void generate_pole(
     const BlocksLayers& layers,
     int top, int bottom,
@@ -291,13 +335,13 @@ void WorldGenerator::generateStructures(
 }
 
 void WorldGenerator::generateBiomes(
-    ChunkPrototype& prototype, int chunkX, int chunkZ
+    GeneratorScript& script, ChunkPrototype& prototype, int chunkX, int chunkZ
 ) {
     if (prototype.level >= ChunkPrototypeLevel::BIOMES) {
         return;
     }
     uint bpd = def.biomesBPD;
-    auto biomeParams = def.script->generateParameterMaps(
+    auto biomeParams = script.generateParameterMaps(
         {floordiv(chunkX * CHUNK_W, bpd), floordiv(chunkZ * CHUNK_D, bpd)},
         {floordiv(CHUNK_W, bpd)+1, floordiv(CHUNK_D, bpd)+1},
         bpd
@@ -332,13 +376,13 @@ void WorldGenerator::generateBiomes(
 }
 
 void WorldGenerator::generateHeightmap(
-    ChunkPrototype& prototype, int chunkX, int chunkZ
+    GeneratorScript& script, ChunkPrototype& prototype, int chunkX, int chunkZ
 ) {
     if (prototype.level >= ChunkPrototypeLevel::HEIGHTMAP) {
         return;
     }
     uint bpd = def.heightsBPD;
-    prototype.heightmap = def.script->generateHeightmap(
+    prototype.heightmap = script.generateHeightmap(
         {floordiv(chunkX * CHUNK_W, bpd), floordiv(chunkZ * CHUNK_D, bpd)},
         {floordiv(CHUNK_W, bpd)+1, floordiv(CHUNK_D, bpd)+1},
         bpd,
@@ -366,7 +410,7 @@ void WorldGenerator::generatePlants(
     int chunkX,
     int chunkZ,
     const Biome** biomes
-) {
+) const {
     const auto& indices = content.getIndices()->blocks;
     util::PseudoRandom plantsRand;
     plantsRand.setSeed(chunkX, chunkZ);
@@ -403,7 +447,7 @@ void WorldGenerator::generateLand(
     int chunkX,
     int chunkZ,
     const Biome** biomes
-) {
+) const {
     uint seaLevel = def.seaLevel;
     for (uint z = 0; z < CHUNK_D; z++) {
         for (uint x = 0; x < CHUNK_W; x++) {
@@ -424,7 +468,33 @@ void WorldGenerator::generateLand(
 void WorldGenerator::generate(voxel* voxels, int chunkX, int chunkZ) {
     surroundMap.completeAt(chunkX, chunkZ);
 
+    generate(requirePrototype(chunkX, chunkZ), voxels, chunkX, chunkZ);
+}
+
+std::shared_ptr<const ChunkPrototype> WorldGenerator::prepare(
+    int chunkX, int chunkZ
+) {
+    surroundMap.completeAt(chunkX, chunkZ);
+
     const auto& prototype = requirePrototype(chunkX, chunkZ);
+    auto snapshot = std::make_shared<ChunkPrototype>();
+    snapshot->level = prototype.level;
+    snapshot->biomes = std::make_unique<const Biome*[]>(CHUNK_W * CHUNK_D);
+    std::copy(
+        prototype.biomes.get(),
+        prototype.biomes.get() + CHUNK_W * CHUNK_D,
+        snapshot->biomes.get()
+    );
+    // heightmap is not modified after the HEIGHTMAP level reached
+    snapshot->heightmap = prototype.heightmap;
+    // placements may still be appended by lines from neighbour chunks
+    snapshot->placements = prototype.placements;
+    return snapshot;
+}
+
+void WorldGenerator::generate(
+    const ChunkPrototype& prototype, voxel* voxels, int chunkX, int chunkZ
+) const {
     const auto values = prototype.heightmap->getValues();
 
     uint seaLevel = def.seaLevel;
@@ -465,7 +535,7 @@ void WorldGenerator::generate(voxel* voxels, int chunkX, int chunkZ) {
 
 void WorldGenerator::generatePlacements(
     const ChunkPrototype& prototype, voxel* voxels, int chunkX, int chunkZ
-) {
+) const {
     auto placements = prototype.placements;
     std::stable_sort(
         placements.begin(),
@@ -489,7 +559,7 @@ void WorldGenerator::generateStructure(
     const StructurePlacement& placement,
     voxel* voxels, 
     int chunkX, int chunkZ
-) {
+) const {
     if (placement.structure < 0 || placement.structure >= def.structures.size()) {
         logger.error() << "invalid structure index " << placement.structure;
         return;
@@ -530,7 +600,7 @@ void WorldGenerator::generateLine(
     const LinePlacement& line,
     voxel* voxels, 
     int chunkX, int chunkZ
-) {
+) const {
     const auto& indices = content.getIndices()->blocks;
 
     int cgx = chunkX * CHUNK_W;
@@ -14,10 +14,15 @@
 
 class Content;
 struct GeneratorDef;
+class GeneratorScript;
 class Heightmap;
 struct Biome;
 class VoxelFragment;
 
+namespace util {
+    class WorkerGroup;
+}
+
 enum class ChunkPrototypeLevel {
     VOID=0, WIDE_STRUCTS, BIOMES, HEIGHTMAP, STRUCTURES
 };
@@ -57,6 +62,11 @@ class WorldGenerator {
     std::unordered_map<glm::ivec2, std::unique_ptr<ChunkPrototype>> prototypes;
     /// @brief Chunk prototypes loading surround map
     SurroundMap surroundMap;
+    /// @brief Threads used for parallel prototype stages (may be nullptr)
+    std::unique_ptr<util::WorkerGroup> workers;
+    /// @brief Generator script instances for workers 1..N
+    /// (worker 0 uses def.script)
+    std::vector<std::unique_ptr<GeneratorScript>> workerScripts;
 
     /// @brief Generate chunk prototype (see ChunkPrototype)
     /// @param x chunk position X divided by CHUNK_W
@@ -69,9 +79,23 @@ class WorldGenerator {
 
     void generateStructures(ChunkPrototype& prototype, int x, int z);
 
-    void generateBiomes(ChunkPrototype& prototype, int x, int z);
+    void generateBiomes(
+        GeneratorScript& script, ChunkPrototype& prototype, int x, int z
+    );
+
+    void generateHeightmap(
+        GeneratorScript& script, ChunkPrototype& prototype, int x, int z
+    );
+
+    /// @brief Run prototype stage for all points using workers
+    void generateParallel(
+        const std::vector<glm::ivec2>& points,
+        void (WorldGenerator::*stage)(
+            GeneratorScript&, ChunkPrototype&, int, int
+        )
+    );
 
-    void generateHeightmap(ChunkPrototype& prototype, int x, int z);
+    GeneratorScript& getScript(uint worker);
 
     void placeStructure(
         const StructurePlacement& placement, int priority, 
@@ -82,19 +106,19 @@ class WorldGenerator {
 
     void generatePlacements(
         const ChunkPrototype& prototype, voxel* voxels, int x, int z
-    );
+    ) const;
     void generateLine(
         const ChunkPrototype& prototype, 
         const LinePlacement& placement,
         voxel* voxels, 
         int x, int z
-    );
+    ) const;
     void generateStructure(
         const ChunkPrototype& prototype, 
         const StructurePlacement& placement,
         voxel* voxels, 
         int x, int z
-    );
+    ) const;
     void generatePlants(
         const ChunkPrototype& prototype,
         float* values,
@@ -102,7 +126,7 @@ class WorldGenerator {
         int x,
         int z,
         const Biome** biomes
-    );
+    ) const;
     void generateLand(
         const ChunkPrototype& prototype,
         float* values,
@@ -110,7 +134,7 @@ class WorldGenerator {
         int x,
         int z,
         const Biome** biomes
-    );
+    ) const;
 
     void placeStructures(
         const std::vector<Placement>& placements,
@@ -118,10 +142,14 @@ class WorldGenerator {
         int x, int z
     );
 public:
+    /// @param workers number of additional threads generating biomes and
+    /// heightmaps of prototypes concurrently, each having own generator
+    /// script instance (0 - serial generation)
     WorldGenerator(
         const GeneratorDef& def,
         const Content& content,
-        uint64_t seed
+        uint64_t seed,
+        uint workers = 0
     );
     ~WorldGenerator();
 
@@ -133,5 +161,23 @@ public:
     /// @param z chunk position Y divided by CHUNK_D
     void generate(voxel* voxels, int x, int z);
 
+    /// @brief Complete chunk prototype and make a snapshot of it, safe to use
+    /// after the prototype is removed from the generator.
+    /// Must be called from the thread owning the generator.
+    /// @param x chunk position X divided by CHUNK_W
+    /// @param z chunk position Y divided by CHUNK_D
+    /// @return completed prototype copy
+    std::shared_ptr<const ChunkPrototype> prepare(int x, int z);
+
+    /// @brief Generate complete chunk voxels using prepared prototype.
+    /// Does not modify generator state, so may be called from worker threads
+    /// @param prototype prototype returned by prepare(x, z)
+    /// @param voxels destinatiopn chunk voxels buffer
+    /// @param x chunk position X divided by CHUNK_W
+    /// @param z chunk position Y divided by CHUNK_D
+    void generate(
+        const ChunkPrototype& prototype, voxel* voxels, int x, int z
+    ) const;
+
     WorldGenDebugInfo createDebugInfo() const;
 };
@@ -0,0 +1,189 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "typedefs.hpp"
+#include "coders/lz.hpp"
+#include "coders/compression.hpp"
+#include "util/timeutil.hpp"
+
+using compression::Method;
+
+/// @brief Generate voxels-like data: 16-bit ids and states of terrain
+static std::vector<ubyte> make_terrain(size_t width, size_t height) {
+    const size_t volume = width * height * width;
+    std::vector<uint16_t> voxels(volume * 2);
+    srand(1);
+    for (size_t z = 0; z < width; z++) {
+        for (size_t x = 0; x < width; x++) {
+            int surface = 60 + static_cast<int>(
+                8 * std::sin(x * 0.3) + 6 * std::cos(z * 0.25)
+            );
+            for (int y = 0; y < static_cast<int>(height); y++) {
+                size_t index = (y * width + z) * width + x;
+                uint16_t id = 0;
+                if (y < surface - 4) {
+                    id = rand() % 40 == 0 ? 20 + rand() % 5 : 3;
+                } else if (y < surface) {
+                    id = 4;
+                } else if (y == surface) {
+                    id = 5;
+                } else if (y < 64) {
+                    id = 9;
+                }
+                voxels[index] = id;
+                if (y == surface + 1 && rand() % 10 == 0) {
+                    voxels[index] = 30;
+                    voxels[volume + index] = rand() % 4;
+                }
+            }
+        }
+    }
+    std::vector<ubyte> bytes(voxels.size() * 2);
+    std::memcpy(bytes.data(), voxels.data(), bytes.size());
+    return bytes;
+}
+
+static void test_round_trip(const std::vector<ubyte>& src, Method method) {
+    size_t length;
+    auto compressed =
+        compression::compress(src.data(), src.size(), length, method);
+    auto decompressed = compression::decompress(
+        compressed.get(), length, src.size(), method
+    );
+    EXPECT_EQ(std::memcmp(decompressed.get(), src.data(), src.size()), 0);
+}
+
+TEST(compression, RoundTrip) {
+    auto terrain = make_terrain(16, 64);
+    std::vector<ubyte> noise(10'000);
+    for (auto& value : noise) {
+        value = rand();
+    }
+    std::vector<ubyte> tiny {1, 2, 3, 4};
+    for (auto method : {
+             Method::EXTRLE8,
+             Method::EXTRLE16,
+             Method::GZIP,
+             Method::LZ,
+             Method::EXTRLE16_LZ,
+             Method::LZ_BJSON}) {
+        test_round_trip(terrain, method);
+        test_round_trip(noise, method);
+        test_round_trip(tiny, method);
+    }
+}
+
+TEST(compression, LZDictionary) {
+    const char* dict = "inventory slots count id item timer";
+    const char* text = "slots: [count: 1, id: 5], item: [id: 7, timer: 0.5]";
+    const auto src = reinterpret_cast<const ubyte*>(text);
+    size_t length = std::strlen(text);
+
+    std::vector<ubyte> encoded(lz::compress_bound(length));
+    size_t encodedLength = lz::encode(src, length, encoded.data());
+    size_t dictEncodedLength = lz::encode(
+        src,
+        length,
+        encoded.data(),
+        reinterpret_cast<const ubyte*>(dict),
+        std::strlen(dict)
+    );
+    EXPECT_LT(dictEncodedLength, encodedLength);
+
+    std::vector<ubyte> decoded(length);
+    EXPECT_EQ(
+        lz::decode(
+            encoded.data(),
+            dictEncodedLength,
+            decoded.data(),
+            decoded.size(),
+            reinterpret_cast<const ubyte*>(dict),
+            std::strlen(dict)
+        ),
+        length
+    );
+    EXPECT_EQ(std::memcmp(decoded.data(), text, length), 0);
+}
+
+TEST(compression, LZCorrupted) {
+    auto terrain = make_terrain(16, 32);
+    std::vector<ubyte> encoded(lz::compress_bound(terrain.size()));
+    size_t length = lz::encode(terrain.data(), terrain.size(), encoded.data());
+    std::vector<ubyte> decoded(terrain.size());
+
+    // destination buffer is too small
+    EXPECT_THROW(
+        lz::decode(encoded.data(), length, decoded.data(), decoded.size() / 2),
+        std::runtime_error
+    );
+    // match refers to data before the start
+    const ubyte invalid[] {0x10, 'a', 0x05, 0x00};
+    EXPECT_THROW(
+        lz::decode(invalid, sizeof(invalid), decoded.data(), decoded.size()),
+        std::runtime_error
+    );
+    EXPECT_THROW(
+        compression::decompress(
+            encoded.data(), length / 2, terrain.size(), Method::LZ
+        ),
+        std::runtime_error
+    );
+}
+
+/// @brief Compare methods on terrain-like chunk data.
+/// Run with --gtest_also_run_disabled_tests, results are reported as test
+/// properties: compressed size and the best of rounds encode/decode time
+TEST(compression, DISABLED_Benchmark) {
+    auto terrain = make_terrain(16, 256);
+    const int rounds = 5;
+    const int iterations = 20;
+    const std::pair<Method, const char*> methods[] {
+        {Method::EXTRLE16, "extrle16"},
+        {Method::GZIP, "gzip"},
+        {Method::LZ, "lz"},
+        {Method::EXTRLE16_LZ, "extrle16_lz"},
+    };
+    for (const auto& [method, name] : methods) {
+        size_t length;
+        auto compressed = compression::compress(
+            terrain.data(), terrain.size(), length, method
+        );
+        auto decompressed = compression::decompress(
+            compressed.get(), length, terrain.size(), method
+        );
+        ASSERT_EQ(
+            std::memcmp(decompressed.get(), terrain.data(), terrain.size()), 0
+        );
+
+        int64_t encodeNs = INT64_MAX;
+        int64_t decodeNs = INT64_MAX;
+        for (int round = 0; round < rounds; round++) {
+            timeutil::Timer encodeTimer;
+            for (int i = 0; i < iterations; i++) {
+                compression::compress(
+                    terrain.data(), terrain.size(), length, method
+                );
+            }
+            encodeNs =
+                std::min(encodeNs, encodeTimer.stop() * 1000 / iterations);
+
+            timeutil::Timer decodeTimer;
+            for (int i = 0; i < iterations; i++) {
+                compression::decompress(
+                    compressed.get(), length, terrain.size(), method
+                );
+            }
+            decodeNs =
+                std::min(decodeNs, decodeTimer.stop() * 1000 / iterations);
+        }
+        std::string prefix = name;
+        RecordProperty(prefix + "_bytes", std::to_string(length));
+        RecordProperty(prefix + "_encode_ns", std::to_string(encodeNs));
+        RecordProperty(prefix + "_decode_ns", std::to_string(decodeNs));
+    }
+}
@@ -1,7 +1,14 @@
 #include <gtest/gtest.h>
 
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
 #include "typedefs.hpp"
+#include "constants.hpp"
 #include "coders/rle.hpp"
+#include "util/timeutil.hpp"
 
 static void test_encode_decode(
     size_t(*encodefunc)(const ubyte*, size_t, ubyte*),
@@ -48,3 +55,134 @@ TEST(ExtRLE16, EncodeDecode) {
     test_encode_decode(extrle::encode16, extrle::decode16, 13);
     test_encode_decode(extrle::encode16, extrle::decode16, 90123);
 }
+
+/// @brief Scalar extRLE16 encoder used as the output reference
+static std::vector<ubyte> reference_encode16(const std::vector<uint16_t>& src) {
+    std::vector<ubyte> dst;
+    auto put_run = [&dst](uint16_t c, uint counter) {
+        if (counter >= 0x40) {
+            dst.push_back(0x80 | ((c > 255) << 6) | (counter & 0x3F));
+            dst.push_back(counter >> 6);
+        } else {
+            dst.push_back(counter | ((c > 255) << 6));
+        }
+        dst.push_back(c & 0xFF);
+        if (c > 255) {
+            dst.push_back(c >> 8);
+        }
+    };
+    uint counter = 0;
+    uint16_t c = src[0];
+    for (size_t i = 1; i < src.size(); i++) {
+        if (src[i] != c || counter == extrle::max_sequence16) {
+            put_run(c, counter);
+            c = src[i];
+            counter = 0;
+        } else {
+            counter++;
+        }
+    }
+    put_run(c, counter);
+    return dst;
+}
+
+static std::vector<uint16_t> make_runs(
+    size_t length, int dencity, uint16_t maxValue
+) {
+    std::vector<uint16_t> values(length);
+    uint16_t next = rand() % maxValue;
+    for (auto& value : values) {
+        value = next;
+        if (rand() % dencity == 0) {
+            next = rand() % maxValue;
+        }
+    }
+    return values;
+}
+
+TEST(ExtRLE16, SimdKernels) {
+    std::vector<std::vector<uint16_t>> inputs {
+        make_runs(50'000, 1, 3),
+        make_runs(50'000, 13, 300),
+        make_runs(50'000, 90123, 0xFFFF),
+        std::vector<uint16_t>(100'000, 7),
+        std::vector<uint16_t>(1, 1000),
+    };
+    for (auto simd : {
+             extrle::Simd::NONE, extrle::Simd::SSE2, extrle::Simd::AVX2}) {
+        if (!extrle::set_simd(simd)) {
+            continue;
+        }
+        for (const auto& input : inputs) {
+            auto src = reinterpret_cast<const ubyte*>(input.data());
+            size_t srclen = input.size() * 2;
+            auto expected = reference_encode16(input);
+
+            std::vector<ubyte> encoded(srclen * 2);
+            size_t encodedSize = extrle::encode16(src, srclen, encoded.data());
+            ASSERT_EQ(encodedSize, expected.size());
+            EXPECT_EQ(
+                std::memcmp(encoded.data(), expected.data(), encodedSize), 0
+            );
+
+            std::vector<ubyte> decoded(srclen);
+            EXPECT_EQ(
+                extrle::decode16(encoded.data(), encodedSize, decoded.data()),
+                srclen
+            );
+            EXPECT_EQ(std::memcmp(decoded.data(), src, srclen), 0);
+        }
+    }
+    extrle::set_simd(extrle::get_supported_simd());
+}
+
+/// @brief Compare extRLE16 kernels on chunk-sized data of long runs.
+/// Run with --gtest_also_run_disabled_tests, the best of rounds
+/// encode/decode times are reported as test properties
+TEST(ExtRLE16, DISABLED_Benchmark) {
+    auto input = make_runs(CHUNK_VOL * 2, 40, 300);
+    auto src = reinterpret_cast<const ubyte*>(input.data());
+    size_t srclen = input.size() * 2;
+    std::vector<ubyte> encoded(srclen * 2);
+    std::vector<ubyte> decoded(srclen);
+    const int rounds = 5;
+    const int iterations = 50;
+    const std::pair<extrle::Simd, const char*> kernels[] {
+        {extrle::Simd::NONE, "scalar"},
+        {extrle::Simd::SSE2, "sse2"},
+        {extrle::Simd::AVX2, "avx2"},
+    };
+    for (const auto& [simd, name] : kernels) {
+        if (!extrle::set_simd(simd)) {
+            continue;
+        }
+        size_t encodedSize = extrle::encode16(src, srclen, encoded.data());
+        ASSERT_EQ(
+            extrle::decode16(encoded.data(), encodedSize, decoded.data()),
+            srclen
+        );
+        ASSERT_EQ(std::memcmp(decoded.data(), src, srclen), 0);
+
+        int64_t encodeNs = INT64_MAX;
+        int64_t decodeNs = INT64_MAX;
+        for (int round = 0; round < rounds; round++) {
+            timeutil::Timer encodeTimer;
+            for (int i = 0; i < iterations; i++) {
+                extrle::encode16(src, srclen, encoded.data());
+            }
+            encodeNs =
+                std::min(encodeNs, encodeTimer.stop() * 1000 / iterations);
+
+            timeutil::Timer decodeTimer;
+            for (int i = 0; i < iterations; i++) {
+                extrle::decode16(encoded.data(), encodedSize, decoded.data());
+            }
+            decodeNs =
+                std::min(decodeNs, decodeTimer.stop() * 1000 / iterations);
+        }
+        std::string prefix = name;
+        RecordProperty(prefix + "_encode_ns", std::to_string(encodeNs));
+        RecordProperty(prefix + "_decode_ns", std::to_string(decodeNs));
+    }
+    extrle::set_simd(extrle::get_supported_simd());
+}
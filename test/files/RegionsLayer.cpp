@@ -0,0 +1,314 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+#include "constants.hpp"
+#include "files/WorldRegions.hpp"
+#include "util/data_io.hpp"
+
+static fs::path prepare_folder(const std::string& name) {
+    auto folder = fs::temp_directory_path() / fs::u8path(name);
+    fs::remove_all(folder);
+    fs::create_directories(folder);
+    return folder;
+}
+
+static uint32_t test_data_size(int x, int z, int revision = 0) {
+    return 16 + std::abs(x * 31 + z * 17 + revision * 97) % 200;
+}
+
+static std::unique_ptr<ubyte[]> make_test_data(
+    int x, int z, int revision = 0
+) {
+    uint32_t size = test_data_size(x, z, revision);
+    auto data = std::make_unique<ubyte[]>(size);
+    for (uint32_t i = 0; i < size; i++) {
+        data[i] = static_cast<ubyte>(x * 7 + z * 13 + revision * 5 + i);
+    }
+    return data;
+}
+
+static void put_test_chunk(
+    RegionsLayer& layer, int x, int z, int revision = 0
+) {
+    int regionX, regionZ, localX, localZ;
+    calc_reg_coords(x, z, regionX, regionZ, localX, localZ);
+    uint32_t size = test_data_size(x, z, revision);
+    auto region = layer.getOrCreateRegion(regionX, regionZ);
+    region->put(localX, localZ, make_test_data(x, z, revision), size, size);
+    region->setUnsaved(true);
+}
+
+static bool check_test_data(
+    const ChunkDataView& view, int x, int z, int revision = 0
+) {
+    if (!view || view.size != test_data_size(x, z, revision)) {
+        return false;
+    }
+    auto expected = make_test_data(x, z, revision);
+    return std::memcmp(view.data, expected.get(), view.size) == 0;
+}
+
+static bool check_test_chunk(
+    RegionsLayer& layer, int x, int z, int revision = 0
+) {
+    return check_test_data(layer.getData(x, z), x, z, revision);
+}
+
+TEST(RegionsLayer, WriteRead) {
+    RegionsLayer layer;
+    layer.folder = prepare_folder("voxelcore_test_regions_rw");
+
+    for (int z = -2; z < 3; z++) {
+        for (int x = -2; x < 3; x++) {
+            put_test_chunk(layer, x, z);
+        }
+    }
+    layer.writeAll();
+    layer.releaseSaved();
+
+    for (int z = -2; z < 3; z++) {
+        for (int x = -2; x < 3; x++) {
+            EXPECT_TRUE(check_test_chunk(layer, x, z));
+        }
+    }
+    EXPECT_FALSE(layer.getData(5, 5));
+
+    // chunks not present in memory must be kept on rewrite
+    put_test_chunk(layer, 7, 7);
+    layer.writeAll();
+    layer.releaseSaved();
+    EXPECT_TRUE(check_test_chunk(layer, 7, 7));
+    EXPECT_TRUE(check_test_chunk(layer, 1, 1));
+}
+
+TEST(RegionsLayer, ConcurrentRead) {
+    RegionsLayer layer;
+    layer.folder = prepare_folder("voxelcore_test_regions_mt");
+
+    // more regions than open files cache capacity
+    const int regionsCount = MAX_OPEN_REGION_FILES + 8;
+    for (int i = 0; i < regionsCount; i++) {
+        for (int j = 0; j < 4; j++) {
+            put_test_chunk(layer, i * REGION_SIZE + j, j);
+        }
+    }
+    layer.writeAll();
+    layer.releaseSaved();
+
+    std::atomic<int> failures = 0;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&layer, &failures, t]() {
+            for (int n = 0; n < 10; n++) {
+                for (int i = 0; i < regionsCount; i++) {
+                    int region = (i + t * 7) % regionsCount;
+                    for (int j = 0; j < 4; j++) {
+                        int x = region * REGION_SIZE + j;
+                        if (!check_test_chunk(layer, x, j)) {
+                            failures++;
+                        }
+                    }
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(failures, 0);
+}
+
+TEST(RegionsLayer, IncrementalWrite) {
+    RegionsLayer layer;
+    layer.folder = prepare_folder("voxelcore_test_regions_inc");
+    auto filename = layer.getRegionFilePath(0, 0);
+
+    for (int z = 0; z < 5; z++) {
+        for (int x = 0; x < 5; x++) {
+            put_test_chunk(layer, x, z);
+        }
+    }
+    layer.writeAll();
+    layer.releaseSaved();
+    auto initialSize = fs::file_size(filename);
+
+    // no unused sectors, so updated chunk is appended
+    put_test_chunk(layer, 0, 0, 1);
+    layer.writeAll();
+    layer.releaseSaved();
+    auto grownSize = fs::file_size(filename);
+    EXPECT_GT(grownSize, initialSize);
+    EXPECT_LE(grownSize, initialSize + REGION_SECTOR_SIZE * 2);
+
+    // sector used by the first chunk version is reused
+    put_test_chunk(layer, 0, 0, 2);
+    layer.writeAll();
+    layer.releaseSaved();
+    EXPECT_EQ(fs::file_size(filename), grownSize);
+    EXPECT_TRUE(check_test_chunk(layer, 0, 0, 2));
+
+    // chunk data referenced by a view must not be overwritten
+    auto view = layer.getData(1, 1);
+    for (int revision = 1; revision < 4; revision++) {
+        put_test_chunk(layer, 1, 1, revision);
+        put_test_chunk(layer, 2, 2, revision);
+        layer.writeAll();
+        layer.releaseSaved();
+    }
+    EXPECT_TRUE(check_test_data(view, 1, 1));
+    EXPECT_TRUE(check_test_chunk(layer, 1, 1, 3));
+    EXPECT_TRUE(check_test_chunk(layer, 2, 2, 3));
+    EXPECT_TRUE(check_test_chunk(layer, 4, 4));
+}
+
+TEST(RegionsLayer, LegacyFormat) {
+    RegionsLayer layer;
+    layer.folder = prepare_folder("voxelcore_test_regions_legacy");
+    auto filename = layer.getRegionFilePath(0, 0);
+
+    // format 3: chunk records followed by the offsets table
+    {
+        std::ofstream file(filename, std::ios::binary);
+        char header[REGION_HEADER_SIZE] = ".VOXREG";
+        header[8] = 3;
+        file.write(header, REGION_HEADER_SIZE);
+
+        uint32_t offsets[REGION_CHUNKS_COUNT] {};
+        uint32_t offset = REGION_HEADER_SIZE;
+        for (int x = 0; x < 2; x++) {
+            uint32_t size = test_data_size(x, 0);
+            auto data = make_test_data(x, 0);
+            uint32_t sizes[2] {dataio::h2le(size), dataio::h2le(size)};
+            file.write(reinterpret_cast<const char*>(sizes), 8);
+            file.write(reinterpret_cast<const char*>(data.get()), size);
+            offsets[x] = dataio::h2le(offset);
+            offset += 8 + size;
+        }
+        file.write(reinterpret_cast<const char*>(offsets), sizeof(offsets));
+    }
+    EXPECT_TRUE(check_test_chunk(layer, 0, 0));
+    EXPECT_TRUE(check_test_chunk(layer, 1, 0));
+
+    put_test_chunk(layer, 2, 0);
+    layer.writeAll();
+    layer.releaseSaved();
+    EXPECT_EQ(layer.getRegFile({0, 0})->version, REGION_FORMAT_VERSION);
+    for (int x = 0; x < 3; x++) {
+        EXPECT_TRUE(check_test_chunk(layer, x, 0));
+    }
+}
+
+TEST(RegionsLayer, Compaction) {
+    RegionsLayer layer;
+    layer.folder = prepare_folder("voxelcore_test_regions_compact");
+    auto filename = layer.getRegionFilePath(0, 0);
+
+    for (int x = 0; x < 4; x++) {
+        put_test_chunk(layer, x, 0);
+    }
+    layer.writeAll();
+    layer.releaseSaved();
+
+    // open handle prevents unused sectors reuse
+    auto handle = layer.getRegFile({0, 0});
+    int revision = 0;
+    while (layer.fragmentedRegions.empty()) {
+        ASSERT_LT(revision, 1000);
+        put_test_chunk(layer, 0, 0, ++revision);
+        layer.writeAll();
+        layer.releaseSaved();
+    }
+    EXPECT_EQ(layer.fragmentedRegions[0], glm::ivec2(0, 0));
+    handle.reset();
+
+    layer.compactRegion(0, 0);
+    EXPECT_EQ(
+        fs::file_size(filename),
+        REGION_DATA_OFFSET + REGION_SECTOR_SIZE * 3 + 8 +
+            test_data_size(3, 0)
+    );
+    EXPECT_TRUE(check_test_chunk(layer, 0, 0, revision));
+    for (int x = 1; x < 4; x++) {
+        EXPECT_TRUE(check_test_chunk(layer, x, 0));
+    }
+}
+
+TEST(RegionsLayer, RewriteWhileRead) {
+    RegionsLayer layer;
+    layer.folder = prepare_folder("voxelcore_test_regions_rewrite_read");
+    auto filename = layer.getRegionFilePath(0, 0);
+
+    for (int x = 0; x < 2; x++) {
+        put_test_chunk(layer, x, 0);
+    }
+    layer.writeAll();
+    layer.releaseSaved();
+
+    // view keeps the replaced file mapped, it is released while replacing
+    auto view = layer.getData(0, 0);
+    std::thread reader([&view]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        view = {};
+    });
+    layer.compactRegion(0, 0);
+    reader.join();
+    EXPECT_FALSE(fs::exists(filename.string() + ".tmp"));
+
+    // offsets table is sector-aligned
+    {
+        std::ifstream file(filename, std::ios::binary);
+        file.seekg(REGION_TABLE_OFFSET);
+        uint32_t offset;
+        file.read(reinterpret_cast<char*>(&offset), 4);
+        EXPECT_EQ(dataio::le2h(offset), REGION_DATA_OFFSET);
+    }
+    for (int x = 0; x < 2; x++) {
+        EXPECT_TRUE(check_test_chunk(layer, x, 0));
+    }
+}
+
+TEST(RegionsLayer, CompressionChange) {
+    RegionsLayer layer;
+    layer.folder = prepare_folder("voxelcore_test_regions_compression");
+
+    for (int x = 0; x < 3; x++) {
+        put_test_chunk(layer, x, 0);
+    }
+    layer.writeAll();
+    layer.releaseSaved();
+
+    // written chunks are converted when the file is rewritten
+    layer.compression = compression::Method::LZ;
+    uint32_t srcSize = test_data_size(3, 0);
+    auto data = make_test_data(3, 0);
+    size_t size;
+    auto compressed = compression::compress(
+        data.get(), srcSize, size, compression::Method::LZ
+    );
+    auto region = layer.getOrCreateRegion(0, 0);
+    region->put(3, 0, std::move(compressed), size, srcSize);
+    region->setUnsaved(true);
+    layer.writeAll();
+    layer.releaseSaved();
+
+    auto file = layer.getRegFile({0, 0});
+    EXPECT_EQ(file->compression, compression::Method::LZ);
+    for (int x = 0; x < 4; x++) {
+        auto view = layer.getData(x, 0);
+        ASSERT_TRUE(view);
+        EXPECT_EQ(view.compression, compression::Method::LZ);
+        auto decompressed = compression::decompress(
+            view.data, view.size, view.srcSize, view.compression
+        );
+        auto expected = make_test_data(x, 0);
+        EXPECT_EQ(
+            std::memcmp(decompressed.get(), expected.get(), view.srcSize), 0
+        );
+    }
+}
@@ -0,0 +1,109 @@
+#include <gtest/gtest.h>
+
+#include <cstring>
+
+#include "constants.hpp"
+#include "files/WorldRegions.hpp"
+#include "maths/voxmaths.hpp"
+
+static fs::path prepare_folder(const std::string& name) {
+    auto folder = fs::temp_directory_path() / fs::u8path(name);
+    fs::remove_all(folder);
+    fs::create_directories(folder);
+    return folder;
+}
+
+static std::unique_ptr<ubyte[]> make_voxels(int x, int z, int revision) {
+    auto data = std::make_unique<ubyte[]>(CHUNK_DATA_LEN);
+    for (size_t i = 0; i < CHUNK_DATA_LEN; i++) {
+        data[i] = static_cast<ubyte>((i / 64 + x * 3 + z * 5 + revision) % 7);
+    }
+    return data;
+}
+
+static bool check_voxels(WorldRegions& regions, int x, int z, int revision) {
+    auto data = regions.getVoxels(x, z);
+    if (data == nullptr) {
+        return false;
+    }
+    auto expected = make_voxels(x, z, revision);
+    return std::memcmp(data.get(), expected.get(), CHUNK_DATA_LEN) == 0;
+}
+
+TEST(WorldRegions, AsyncWrites) {
+    auto folder = prepare_folder("voxelcore_test_async_writes");
+    {
+        WorldRegions regions(folder);
+        regions.asyncWrites = true;
+        for (int x = -2; x < 40; x++) {
+            regions.put(
+                x, 1, REGION_LAYER_VOXELS, make_voxels(x, 1, 0), CHUNK_DATA_LEN
+            );
+        }
+        // pending chunks are available before written
+        EXPECT_TRUE(check_voxels(regions, 5, 1, 0));
+        bool regionWritten = false;
+        regions.writeAll([&regions, &regionWritten]() {
+            regionWritten = fs::exists(
+                regions.getRegionFilePath(REGION_LAYER_VOXELS, -1, 0)
+            );
+        });
+
+        // chunks put while writing are kept pending
+        regions.put(
+            5, 1, REGION_LAYER_VOXELS, make_voxels(5, 1, 1), CHUNK_DATA_LEN
+        );
+        EXPECT_TRUE(check_voxels(regions, 5, 1, 1));
+        regions.waitForWrites();
+        EXPECT_TRUE(fs::exists(
+            regions.getRegionFilePath(REGION_LAYER_VOXELS, -1, 0)
+        ));
+        // called after the regions are written
+        EXPECT_TRUE(regionWritten);
+        EXPECT_TRUE(check_voxels(regions, 5, 1, 1));
+
+        // written on destruction
+        regions.put(
+            6, 1, REGION_LAYER_VOXELS, make_voxels(6, 1, 1), CHUNK_DATA_LEN
+        );
+    }
+    WorldRegions regions(folder);
+    EXPECT_TRUE(check_voxels(regions, 5, 1, 1));
+    EXPECT_TRUE(check_voxels(regions, 6, 1, 1));
+    EXPECT_TRUE(check_voxels(regions, -2, 1, 0));
+    EXPECT_TRUE(check_voxels(regions, 39, 1, 0));
+    EXPECT_FALSE(regions.getVoxels(0, 0));
+}
+
+TEST(WorldRegions, LightsValidation) {
+    auto folder = prepare_folder("voxelcore_test_lights_validation");
+    WorldRegions regions(folder);
+    regions.lightsContentHash = 42;
+
+    Chunk chunk(3, 4);
+    chunk.voxels.set(vox_index(1, 2, 3), voxel {5, {}});
+    chunk.lightmap.fill(Lightmap::combine(0, 0, 0, 15));
+    chunk.lightmap.setS(1, 2, 3, 7);
+    chunk.lightmap.setHeight(1, 3, 3);
+    chunk.flags.lighted = true;
+    chunk.flags.unsaved = true;
+    regions.put(&chunk, {});
+
+    auto data = regions.getVoxels(3, 4);
+    ASSERT_TRUE(data);
+    uint32_t voxelsHash = WorldRegions::hashVoxels(data.get());
+    EXPECT_EQ(voxelsHash, chunk.voxelsHash);
+
+    Lightmap lightmap;
+    EXPECT_TRUE(regions.getLights(3, 4, lightmap, voxelsHash));
+    EXPECT_EQ(lightmap.getS(1, 2, 3), 7);
+    EXPECT_EQ(lightmap.getS(1, 3, 3), 15);
+    EXPECT_EQ(lightmap.getHeight(1, 3), 3);
+
+    // voxels changed after the lights were saved
+    EXPECT_FALSE(regions.getLights(3, 4, lightmap, voxelsHash + 1));
+
+    // content changed
+    regions.lightsContentHash = 43;
+    EXPECT_FALSE(regions.getLights(3, 4, lightmap, voxelsHash));
+}
@@ -0,0 +1,65 @@
+#include <gtest/gtest.h>
+
+#include <memory>
+
+#include "lighting/Lightmap.hpp"
+
+TEST(Lightmap, Sections) {
+    Lightmap lightmap;
+    EXPECT_EQ(lightmap.getMemoryUsage(), 0);
+
+    lightmap.fill(Lightmap::combine(0, 0, 0, 15));
+    lightmap.setR(1, 2, 3, 14);
+    lightmap.setS(1, 2, 3, 15);
+    EXPECT_EQ(lightmap.getR(1, 2, 3), 14);
+    EXPECT_EQ(lightmap.getS(1, 2, 3), 15);
+    EXPECT_EQ(lightmap.getS(5, 100, 5), 15);
+    EXPECT_EQ(lightmap.getMemoryUsage(), CHUNK_SECTION_VOL * sizeof(light_t));
+
+    light_t value;
+    EXPECT_FALSE(lightmap.getUniform(0, value));
+    EXPECT_TRUE(lightmap.getUniform(1, value));
+    EXPECT_EQ(value, Lightmap::combine(0, 0, 0, 15));
+
+    // allocated section is filled in place
+    lightmap.fill(0);
+    EXPECT_EQ(lightmap.get(1, 2, 3), 0);
+    EXPECT_FALSE(lightmap.getUniform(0, value));
+}
+
+TEST(Lightmap, EncodeDecode) {
+    auto lights = std::make_unique<light_t[]>(CHUNK_VOL);
+    for (uint i = 0; i < CHUNK_VOL; i++) {
+        uint y = i / (CHUNK_W * CHUNK_D);
+        lights[i] = Lightmap::combine(0, 0, 0, y > 64 ? 15 : rand() % 16);
+    }
+    Lightmap lightmap;
+    lightmap.set(lights.get());
+    EXPECT_EQ(lightmap.getMemoryUsage(), 5 * CHUNK_SECTION_VOL * sizeof(light_t));
+
+    auto decoded = Lightmap::decode(lightmap.encode().get());
+    auto copy = std::make_unique<light_t[]>(CHUNK_VOL);
+    lightmap.read(copy.get());
+    for (uint i = 0; i < CHUNK_VOL; i++) {
+        EXPECT_EQ(decoded[i], lights[i]);
+        EXPECT_EQ(copy[i], lights[i]);
+    }
+}
+
+TEST(Lightmap, Heights) {
+    Lightmap lightmap;
+    EXPECT_EQ(lightmap.getHeight(5, 5), 0);
+    lightmap.setHeight(3, 4, 70);
+    lightmap.setHeight(0, 0, CHUNK_H);
+
+    Lightmap decoded;
+    auto data = lightmap.encode();
+    decoded.decodeHeights(data.get() + LIGHTMAP_DATA_LEN);
+    for (int z = 0; z < CHUNK_D; z++) {
+        for (int x = 0; x < CHUNK_W; x++) {
+            EXPECT_EQ(decoded.getHeight(x, z), lightmap.getHeight(x, z));
+        }
+    }
+    EXPECT_EQ(decoded.getHeight(3, 4), 70);
+    EXPECT_EQ(decoded.getHeight(0, 0), CHUNK_H);
+}
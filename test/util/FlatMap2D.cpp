@@ -0,0 +1,141 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "util/FlatMap2D.hpp"
+#include "util/timeutil.hpp"
+
+TEST(FlatMap2D, InsertFindErase) {
+    util::FlatMap2D<int> map;
+    for (int z = -20; z < 20; z++) {
+        for (int x = -20; x < 20; x++) {
+            map(x, z) = x * 100 + z;
+        }
+    }
+    EXPECT_EQ(map.size(), 40 * 40);
+    for (int z = -20; z < 20; z++) {
+        for (int x = -20; x < 20; x++) {
+            auto value = map.find(x, z);
+            ASSERT_NE(value, nullptr);
+            EXPECT_EQ(*value, x * 100 + z);
+        }
+    }
+    EXPECT_EQ(map.find(20, 0), nullptr);
+
+    for (int z = -20; z < 20; z++) {
+        for (int x = -20; x < 20; x += 2) {
+            EXPECT_TRUE(map.erase(x, z));
+        }
+    }
+    EXPECT_FALSE(map.erase(-20, -20));
+    EXPECT_EQ(map.size(), 20 * 40);
+    for (int z = -20; z < 20; z++) {
+        for (int x = -20; x < 20; x++) {
+            auto value = map.find(x, z);
+            if (x % 2 == 0) {
+                EXPECT_EQ(value, nullptr);
+            } else {
+                ASSERT_NE(value, nullptr);
+                EXPECT_EQ(*value, x * 100 + z);
+            }
+        }
+    }
+}
+
+TEST(FlatMap2D, RandomOperations) {
+    util::FlatMap2D<int> map;
+    std::unordered_map<int64_t, int> reference;
+    std::mt19937 random(42);
+    std::uniform_int_distribution<int> coord(-64, 64);
+    for (int i = 0; i < 100000; i++) {
+        int x = coord(random);
+        int z = coord(random);
+        int64_t key = (static_cast<int64_t>(x) << 32) ^ (z & 0xFFFFFFFF);
+        if (random() % 3 == 0) {
+            EXPECT_EQ(map.erase(x, z), reference.erase(key) > 0);
+        } else {
+            map(x, z) = i;
+            reference[key] = i;
+        }
+    }
+    EXPECT_EQ(map.size(), reference.size());
+    size_t count = 0;
+    map.forEach([&](int x, int z, int value) {
+        int64_t key = (static_cast<int64_t>(x) << 32) ^ (z & 0xFFFFFFFF);
+        EXPECT_EQ(reference.at(key), value);
+        count++;
+    });
+    EXPECT_EQ(count, reference.size());
+}
+
+static int64_t keyfrom(int x, int z) {
+    return (static_cast<int64_t>(x) << 32) ^ (z & 0xFFFFFFFF);
+}
+
+/// @brief Compare chunk lookup cost with unordered_map for block access
+/// patterns. Run with --gtest_also_run_disabled_tests, the best of rounds
+/// time per lookup is reported as test properties
+TEST(FlatMap2D, DISABLED_Benchmark) {
+    const int radius = 32;
+    std::unordered_map<int64_t, int> hashMap;
+    hashMap.max_load_factor(0.1f);
+    util::FlatMap2D<int> flatMap;
+    for (int z = -radius; z < radius; z++) {
+        for (int x = -radius; x < radius; x++) {
+            hashMap[keyfrom(x, z)] = x + z;
+            flatMap(x, z) = x + z;
+        }
+    }
+    std::mt19937 random(42);
+    std::uniform_int_distribution<int> coord(-radius, radius - 1);
+
+    // chunk positions of block lookups:
+    // physics - hitboxes checking the same chunk many times in a row,
+    // lighting - propagation over a chunk and its neighbours,
+    // block_get - scripts reading blocks scattered over the area
+    std::vector<std::pair<const char*, std::vector<std::pair<int, int>>>>
+        patterns {{"physics", {}}, {"lighting", {}}, {"block_get", {}}};
+    const int lookups = 1 << 22;
+    for (int i = 0; i < lookups; i++) {
+        int x = coord(random) / 4;
+        int z = coord(random) / 4;
+        patterns[0].second.emplace_back(i / 64 % 8, i / 512 % 8);
+        patterns[1].second.emplace_back(x % 3 - 1, z % 3 - 1);
+        patterns[2].second.emplace_back(coord(random), coord(random));
+    }
+    const int rounds = 3;
+    for (const auto& [name, positions] : patterns) {
+        int64_t hashMapMcs = INT64_MAX;
+        int64_t flatMapMcs = INT64_MAX;
+        for (int round = 0; round < rounds; round++) {
+            int64_t checksum = 0;
+            timeutil::Timer hashMapTimer;
+            for (const auto& [x, z] : positions) {
+                auto found = hashMap.find(keyfrom(x, z));
+                checksum += found != hashMap.end() ? found->second : 0;
+            }
+            hashMapMcs = std::min(hashMapMcs, hashMapTimer.stop());
+
+            timeutil::Timer flatMapTimer;
+            for (const auto& [x, z] : positions) {
+                auto found = flatMap.find(x, z);
+                checksum -= found ? *found : 0;
+            }
+            flatMapMcs = std::min(flatMapMcs, flatMapTimer.stop());
+            EXPECT_EQ(checksum, 0);
+        }
+        std::string prefix = name;
+        RecordProperty(
+            prefix + "_unordered_map_ps",
+            std::to_string(hashMapMcs * 1000000 / lookups)
+        );
+        RecordProperty(
+            prefix + "_flat_map_ps",
+            std::to_string(flatMapMcs * 1000000 / lookups)
+        );
+    }
+}
@@ -0,0 +1,29 @@
+#include <gtest/gtest.h>
+
+#include "util/RingBuffer.hpp"
+
+TEST(RingBuffer, PushPop) {
+    util::RingBuffer<int> buffer(4);
+    EXPECT_TRUE(buffer.empty());
+    EXPECT_EQ(buffer.capacity(), 4);
+
+    int next = 0;
+    int expected = 0;
+    // wrap around head and grow while not empty
+    for (int i = 0; i < 3; i++) {
+        buffer.push(next++);
+    }
+    for (int i = 0; i < 2; i++) {
+        EXPECT_EQ(buffer.pop(), expected++);
+    }
+    for (int i = 0; i < 20; i++) {
+        buffer.push(next++);
+    }
+    EXPECT_EQ(buffer.size(), 21);
+    EXPECT_EQ(buffer.capacity(), 32);
+    EXPECT_EQ(buffer.front(), expected);
+    while (!buffer.empty()) {
+        EXPECT_EQ(buffer.pop(), expected++);
+    }
+    EXPECT_EQ(expected, next);
+}
@@ -0,0 +1,48 @@
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+#include "util/SpatialGrid.hpp"
+
+TEST(SpatialGrid, QueryMatchesBruteForce) {
+    util::SpatialGrid<int> grid(8.0f);
+    std::mt19937 random(42);
+    std::uniform_real_distribution<float> coord(-100.0f, 100.0f);
+    std::uniform_real_distribution<float> size(0.0f, 4.0f);
+
+    std::vector<std::pair<glm::vec3, glm::vec3>> boxes;
+    for (int pass = 0; pass < 2; pass++) {
+        // grid is refilled as values move
+        grid.clear();
+        boxes.clear();
+        for (int i = 0; i < 1000; i++) {
+            glm::vec3 min(coord(random), coord(random), coord(random));
+            // some values cover many cells
+            float scale = i % 100 == 0 ? 30.0f : 1.0f;
+            glm::vec3 max = min + glm::vec3(size(random), size(random),
+                                            size(random)) * scale;
+            boxes.emplace_back(min, max);
+            grid.add(i, min, max);
+        }
+        EXPECT_EQ(grid.size(), boxes.size());
+
+        for (int q = 0; q < 200; q++) {
+            glm::vec3 min(coord(random), coord(random), coord(random));
+            float scale = q % 20 == 0 ? 100.0f : 5.0f;
+            glm::vec3 max = min + glm::vec3(size(random), size(random),
+                                            size(random)) * scale;
+            std::vector<int> visits(boxes.size());
+            grid.query(min, max, [&](int value) {
+                visits[value]++;
+            });
+            for (size_t i = 0; i < boxes.size(); i++) {
+                const auto& [a, b] = boxes[i];
+                bool expected = a.x <= max.x && b.x >= min.x &&
+                                a.y <= max.y && b.y >= min.y &&
+                                a.z <= max.z && b.z >= min.z;
+                ASSERT_EQ(visits[i], expected ? 1 : 0);
+            }
+        }
+    }
+}
@@ -0,0 +1,50 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+#include "util/WorkerGroup.hpp"
+
+using namespace util;
+
+TEST(WorkerGroup, RunsEveryTaskOnce) {
+    WorkerGroup group(3);
+    EXPECT_EQ(group.getWorkersCount(), 4);
+
+    std::vector<std::atomic<int>> counters(1000);
+    for (int batch = 0; batch < 10; batch++) {
+        group.run(counters.size(), [&counters](size_t index, uint worker) {
+            EXPECT_LT(worker, 4);
+            counters[index]++;
+        });
+    }
+    for (const auto& counter : counters) {
+        EXPECT_EQ(counter, 10);
+    }
+}
+
+TEST(WorkerGroup, NoThreads) {
+    WorkerGroup group(0);
+    int sum = 0;
+    group.run(10, [&sum](size_t index, uint worker) {
+        EXPECT_EQ(worker, 0);
+        sum += index;
+    });
+    EXPECT_EQ(sum, 45);
+}
+
+TEST(WorkerGroup, RethrowsTaskError) {
+    WorkerGroup group(2);
+    EXPECT_THROW(
+        group.run(100, [](size_t index, uint) {
+            if (index == 42) {
+                throw std::runtime_error("task failed");
+            }
+        }),
+        std::runtime_error
+    );
+    std::atomic<int> done = 0;
+    group.run(100, [&done](size_t, uint) { done++; });
+    EXPECT_EQ(done, 100);
+}
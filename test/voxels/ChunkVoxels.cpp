@@ -0,0 +1,125 @@
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <memory>
+
+#include "voxels/ChunkVoxels.hpp"
+
+/// @brief Generate terrain-like voxels: stone, dirt, grass, some ores
+static std::unique_ptr<voxel[]> make_terrain() {
+    auto voxels = std::make_unique<voxel[]>(CHUNK_VOL);
+    srand(1);
+    for (uint y = 0; y < CHUNK_H; y++) {
+        for (uint z = 0; z < CHUNK_D; z++) {
+            for (uint x = 0; x < CHUNK_W; x++) {
+                int surface = 60 + (x + z) % 7;
+                voxel& vox = voxels[vox_index(x, y, z)];
+                if (y < surface - 4) {
+                    vox.id = rand() % 40 == 0 ? 20 + rand() % 5 : 3;
+                } else if (y < surface) {
+                    vox.id = 4;
+                } else if (y == surface) {
+                    vox.id = 5;
+                } else if (y == surface + 1 && rand() % 10 == 0) {
+                    vox.id = 30;
+                    vox.state.rotation = rand() % 4;
+                }
+            }
+        }
+    }
+    return voxels;
+}
+
+static bool equals(voxel a, voxel b) {
+    return a.id == b.id && blockstate2int(a.state) == blockstate2int(b.state);
+}
+
+TEST(ChunkVoxels, PackedRoundTrip) {
+    auto terrain = make_terrain();
+    ChunkVoxels voxels;
+    voxels.write(terrain.get(), true);
+
+    auto unpacked = std::make_unique<voxel[]>(CHUNK_VOL);
+    voxels.read(unpacked.get());
+    for (uint i = 0; i < CHUNK_VOL; i++) {
+        EXPECT_TRUE(equals(voxels.get(i), terrain[i]));
+        EXPECT_TRUE(equals(unpacked[i], terrain[i]));
+    }
+    for (uint i = 0; i < CHUNK_SECTIONS; i++) {
+        EXPECT_TRUE(voxels.isPacked(i));
+    }
+    EXPECT_LT(voxels.getMemoryUsage(), CHUNK_VOL * sizeof(voxel) / 4);
+}
+
+TEST(ChunkVoxels, WriteableUnpacks) {
+    auto terrain = make_terrain();
+    ChunkVoxels voxels;
+    voxels.write(terrain.get(), true);
+
+    uint index = vox_index(3, 100, 5);
+    voxel* vox = voxels.getWriteable(index);
+    EXPECT_FALSE(voxels.isPacked(index / CHUNK_SECTION_VOL));
+    EXPECT_TRUE(voxels.isPacked(0));
+    vox->id = 42;
+    EXPECT_EQ(voxels.get(index).id, 42);
+
+    // flat section is overwritten in place
+    voxels.write(terrain.get(), true);
+    EXPECT_EQ(vox->id, terrain[index].id);
+    EXPECT_FALSE(voxels.isPacked(index / CHUNK_SECTION_VOL));
+
+    terrain[index].id = 43;
+    voxels.write(terrain.get(), true);
+    EXPECT_EQ(voxels.get(index).id, 43);
+}
+
+TEST(ChunkVoxels, Air) {
+    ChunkVoxels voxels;
+    for (uint i = 0; i < CHUNK_VOL; i++) {
+        EXPECT_EQ(voxels.get(i).id, 0);
+    }
+    EXPECT_EQ(voxels.getMemoryUsage(), 0);
+
+    // uniform sections are stored as a single value even if not packing
+    auto terrain = make_terrain();
+    voxels.write(terrain.get(), false);
+    for (uint i = 0; i < CHUNK_SECTIONS; i++) {
+        bool empty = i * CHUNK_SECTION_H > 70;
+        EXPECT_EQ(voxels.isEmpty(i), empty);
+        EXPECT_EQ(voxels.isPacked(i), empty);
+    }
+    voxel vox;
+    EXPECT_FALSE(voxels.getUniform(0, vox));
+
+    for (uint i = 0; i < CHUNK_SECTION_VOL; i++) {
+        terrain[i] = {3, {}};
+    }
+    ChunkVoxels solid;
+    solid.write(terrain.get(), false);
+    EXPECT_TRUE(solid.getUniform(0, vox));
+    EXPECT_EQ(vox.id, 3);
+    EXPECT_FALSE(solid.isEmpty(0));
+}
+
+TEST(ChunkVoxels, ReplacedSectionsFreed) {
+    auto terrain = make_terrain();
+    ChunkVoxels voxels;
+    voxels.write(terrain.get(), true);
+    size_t usage = voxels.getMemoryUsage();
+    for (int i = 0; i < 10; i++) {
+        voxels.write(terrain.get(), true);
+    }
+    EXPECT_EQ(voxels.getMemoryUsage(), usage);
+
+    // replaced sections are kept while read by other threads
+    voxels.beginRead();
+    voxels.write(terrain.get(), true);
+    voxels.write(terrain.get(), true);
+    EXPECT_EQ(voxels.getMemoryUsage(), usage * 3);
+    for (uint i = 0; i < CHUNK_VOL; i++) {
+        EXPECT_TRUE(equals(voxels.get(i), terrain[i]));
+    }
+    voxels.endRead();
+    voxels.write(terrain.get(), true);
+    EXPECT_EQ(voxels.getMemoryUsage(), usage);
+}
@@ -0,0 +1,149 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "util/FlatMap2D.hpp"
+#include "util/timeutil.hpp"
+#include "voxels/blocks_agent.hpp"
+
+/// @brief Minimal chunks storage for blocks_agent templates
+class TestChunks {
+    util::FlatMap2D<std::unique_ptr<Chunk>> chunks;
+public:
+    TestChunks(int radius) {
+        srand(1);
+        for (int cz = -radius; cz < radius; cz++) {
+            for (int cx = -radius; cx < radius; cx++) {
+                auto chunk = std::make_unique<Chunk>(cx, cz);
+                for (uint i = 0; i < CHUNK_VOL; i++) {
+                    chunk->voxels.getWriteable(i)->id = rand() % 16;
+                }
+                chunks(cx, cz) = std::move(chunk);
+            }
+        }
+    }
+
+    void putChunk(std::unique_ptr<Chunk> chunk) {
+        int cx = chunk->x;
+        int cz = chunk->z;
+        chunks(cx, cz) = std::move(chunk);
+    }
+
+    Chunk* getChunk(int cx, int cz) const {
+        if (auto chunk = chunks.find(cx, cz)) {
+            return chunk->get();
+        }
+        return nullptr;
+    }
+};
+
+TEST(VoxelCursor, SameAsStorage) {
+    TestChunks chunks(4);
+    blocks_agent::VoxelCursor cursor(chunks);
+    std::mt19937 random(42);
+    std::uniform_int_distribution<int> coord(-CHUNK_W * 5, CHUNK_W * 5);
+    for (int i = 0; i < 100000; i++) {
+        int x = coord(random);
+        int y = coord(random) + CHUNK_H / 2;
+        int z = coord(random);
+        // walk a few voxels from the position to hit the cached chunk
+        for (int j = 0; j < 4; j++, x++) {
+            EXPECT_EQ(
+                blocks_agent::get(cursor, x, y, z),
+                blocks_agent::get(chunks, x, y, z)
+            );
+        }
+    }
+}
+
+TEST(VoxelCursor, ReadKeepsPacked) {
+    TestChunks chunks(1);
+    auto src = std::make_unique<voxel[]>(CHUNK_VOL);
+    chunks.getChunk(0, 0)->voxels.read(src.get());
+    auto packed = std::make_unique<Chunk>(0, 0);
+    packed->voxels.write(src.get(), true);
+    auto chunk = packed.get();
+    chunks.putChunk(std::move(packed));
+
+    blocks_agent::VoxelCursor cursor(chunks);
+    for (int y = 0; y < CHUNK_H; y++) {
+        for (int z = 0; z < CHUNK_D; z++) {
+            for (int x = 0; x < CHUNK_W; x++) {
+                auto vox = blocks_agent::get(cursor, x, y, z);
+                ASSERT_NE(vox, nullptr);
+                ASSERT_EQ(vox->id, src[vox_index(x, y, z)].id);
+            }
+        }
+    }
+    for (uint i = 0; i < CHUNK_SECTIONS; i++) {
+        EXPECT_TRUE(chunk->voxels.isPacked(i));
+    }
+}
+
+/// @brief Sum ids of voxels in a box around the position,
+/// as hitboxes and blocks areas checks do
+template <class Storage>
+static int64_t scan_box(const Storage& storage, const glm::ivec3& pos, int r) {
+    int64_t sum = 0;
+    for (int y = pos.y - r; y <= pos.y + r; y++) {
+        for (int z = pos.z - r; z <= pos.z + r; z++) {
+            for (int x = pos.x - r; x <= pos.x + r; x++) {
+                if (auto vox = blocks_agent::get(storage, x, y, z)) {
+                    sum += vox->id;
+                }
+            }
+        }
+    }
+    return sum;
+}
+
+/// @brief Compare voxel access throughput of the storage and a cursor.
+/// Run with --gtest_also_run_disabled_tests, the best of rounds voxels per
+/// second are reported as test properties
+TEST(VoxelCursor, DISABLED_Benchmark) {
+    TestChunks chunks(8);
+    const int radius = 2;
+    const int boxes = 200000;
+    const int rounds = 3;
+
+    std::mt19937 random(42);
+    std::uniform_int_distribution<int> coord(-CHUNK_W * 6, CHUNK_W * 6);
+    std::uniform_int_distribution<int> height(radius, CHUNK_H - radius - 1);
+    std::vector<glm::ivec3> positions;
+    for (int i = 0; i < boxes; i++) {
+        positions.emplace_back(coord(random), height(random), coord(random));
+    }
+    int64_t storageMcs = INT64_MAX;
+    int64_t cursorMcs = INT64_MAX;
+    for (int round = 0; round < rounds; round++) {
+        int64_t checksum = 0;
+        timeutil::Timer storageTimer;
+        for (const auto& pos : positions) {
+            checksum += scan_box(chunks, pos, radius);
+        }
+        storageMcs = std::min(storageMcs, storageTimer.stop());
+
+        timeutil::Timer cursorTimer;
+        for (const auto& pos : positions) {
+            // cursor is created for each operation
+            blocks_agent::VoxelCursor cursor(chunks);
+            checksum -= scan_box(cursor, pos, radius);
+        }
+        cursorMcs = std::min(cursorMcs, cursorTimer.stop());
+        EXPECT_EQ(checksum, 0);
+    }
+    int64_t accesses = boxes * (radius * 2 + 1) * (radius * 2 + 1) *
+                       (radius * 2 + 1);
+    RecordProperty(
+        "storage_voxels_per_second",
+        std::to_string(accesses * 1000000 / std::max<int64_t>(storageMcs, 1))
+    );
+    RecordProperty(
+        "cursor_voxels_per_second",
+        std::to_string(accesses * 1000000 / std::max<int64_t>(cursorMcs, 1))
+    );
+}
@@ -31,6 +31,31 @@ TEST(SurroundMap, InitTest) {
     EXPECT_EQ(affected, maxLevel * 2 - 1);
 }
 
+TEST(SurroundMap, BatchCallbackTest) {
+    int8_t maxLevel = 5;
+
+    SurroundMap map(50, maxLevel);
+    int calls = 0;
+    size_t affected = 0;
+
+    map.setLevelBatchCallback(1, [&](const auto& points) {
+        calls++;
+        affected += points.size();
+    });
+    map.setCenter(0, 0);
+    map.completeAt(0, 0);
+    EXPECT_EQ(calls, 1);
+    EXPECT_EQ(affected, (maxLevel * 2 - 1) * (maxLevel * 2 - 1));
+
+    map.completeAt(0, 0);
+    EXPECT_EQ(calls, 1);
+
+    affected = 0;
+    map.completeAt(1, 0);
+    EXPECT_EQ(calls, 2);
+    EXPECT_EQ(affected, maxLevel * 2 - 1);
+}
+
 #define VISUAL_TEST
 #ifdef VISUAL_TEST
 